@@ -0,0 +1,118 @@
+// Copyright 2025 <github.com/razaqq>
+#pragma once
+
+#include "Client/DatabaseManager.hpp"
+#include "Client/MatchStatistics.hpp"
+
+#include "Core/Defer.hpp"
+#include "Core/Metrics.hpp"
+#include "Core/ThreadPool.hpp"
+
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace PotatoAlert::Client {
+
+// a query running on the database workers, once it is cancelled its callback is not called anymore
+class DatabaseTask
+{
+public:
+	DatabaseTask() = default;
+
+	void Cancel() const
+	{
+		if (m_cancelled)
+			m_cancelled->store(true, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] bool IsCancelled() const
+	{
+		return m_cancelled && m_cancelled->load(std::memory_order_relaxed);
+	}
+
+private:
+	friend class AsyncDatabaseManager;
+
+	explicit DatabaseTask(std::shared_ptr<std::atomic_bool> cancelled) : m_cancelled(std::move(cancelled)) {}
+
+	std::shared_ptr<std::atomic_bool> m_cancelled;
+};
+
+// runs the queries of the DatabaseManager on worker threads, so the gui thread never waits for sqlite
+// the results are queued back to the gui thread and dropped if the context object was destroyed in the meantime
+class AsyncDatabaseManager
+{
+public:
+	template<typename T>
+	using Callback = std::function<void(SqlResult<T>)>;
+
+	explicit AsyncDatabaseManager(const DatabaseManager& dbm, size_t threadCount = 2) : m_dbm(dbm), m_threadPool(threadCount) {}
+
+	AsyncDatabaseManager(const AsyncDatabaseManager&) = delete;
+	AsyncDatabaseManager(AsyncDatabaseManager&&) = delete;
+	AsyncDatabaseManager& operator=(const AsyncDatabaseManager&) = delete;
+	AsyncDatabaseManager& operator=(AsyncDatabaseManager&&) = delete;
+
+	// loads the whole list in pages, cancelling stops it between two pages
+	DatabaseTask GetMatchListAsync(MatchListFilter filter, QObject* context, Callback<std::vector<MatchListEntry>> callback);
+	DatabaseTask SearchMatchesAsync(std::string query, size_t limit, QObject* context, Callback<std::vector<MatchListEntry>> callback);
+	DatabaseTask GetMatchJsonAsync(uint32_t id, QObject* context, Callback<std::optional<std::string>> callback);
+	DatabaseTask GetReplaySummaryAsync(uint32_t id, QObject* context, Callback<std::optional<ReplaySummary>> callback);
+	DatabaseTask GetMatchStatisticsAsync(StatisticsGrouping grouping, QObject* context, Callback<std::vector<MatchStatistics>> callback);
+	DatabaseTask DeleteMatchesAsync(std::vector<uint32_t> ids, QObject* context, Callback<void> callback);
+	// adds the match unless one with the same hash exists, the callback only gets the match if it was added
+	DatabaseTask AddMatchAsync(Match match, QObject* context, Callback<std::optional<Match>> callback);
+
+private:
+	template<typename T>
+	DatabaseTask Run(QObject* context, std::function<SqlResult<T>(const DatabaseTask&)> query, Callback<T> callback)
+	{
+		DatabaseTask task(std::make_shared<std::atomic_bool>(false));
+
+		PA_METRIC_GAUGE_ADD("db.async_in_flight", 1);
+
+		// the context is only checked on the gui thread, where it is destroyed
+		m_threadPool.Enqueue([task, context = QPointer<QObject>(context), query = std::move(query), callback = std::move(callback)]()
+		{
+			PA_DEFER
+			{
+				PA_METRIC_GAUGE_ADD("db.async_in_flight", -1);
+			};
+
+			if (task.IsCancelled())
+				return;
+
+			SqlResult<T> result = query(task);
+
+			QCoreApplication* app = QCoreApplication::instance();
+			if (task.IsCancelled() || !app)
+				return;
+
+			QMetaObject::invokeMethod(app, [task, context, callback, result = std::move(result)]() mutable
+			{
+				if (!task.IsCancelled() && context)
+					callback(std::move(result));
+			}, Qt::QueuedConnection);
+		});
+
+		return task;
+	}
+
+	const DatabaseManager& m_dbm;
+	Core::ThreadPool m_threadPool;
+	static constexpr size_t MatchListPageSize = 1000;
+};
+
+}  // namespace PotatoAlert::Client
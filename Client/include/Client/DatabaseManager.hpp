@@ -1,6 +1,8 @@
 // Copyright 2022 <github.com/razaqq>
 #pragma once
 
+#include "Client/MatchStatistics.hpp"
+
 #include "Core/Format.hpp"
 #include "Core/Result.hpp"
 #include "Core/Sqlite.hpp"
@@ -8,16 +10,28 @@
 
 #include "ReplayParser/ReplayParser.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <expected>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <thread>
+#include <vector>
 
 
 using PotatoAlert::Core::Result;
+using PotatoAlert::ReplayParser::MatchOutcome;
 using PotatoAlert::ReplayParser::ReplaySummary;
 
 namespace PotatoAlert::Client {
 
-#define MATCH_FIELDS(X)                      \
+#define MATCH_INFO_FIELDS(X)                 \
 	X(std::string, Hash, TEXT UNIQUE)        \
 	X(std::string, ReplayName, TEXT)         \
 	X(std::string, Date, TEXT)               \
@@ -29,11 +43,28 @@ namespace PotatoAlert::Client {
 	X(std::string, MatchGroup, TEXT)         \
 	X(std::string, StatsMode, TEXT)          \
 	X(std::string, Player, TEXT)             \
-	X(std::string, Region, TEXT)             \
-	X(std::string, Json, TEXT)               \
-	X(std::string, ArenaInfo, TEXT)          \
-	X(bool, Analyzed, INTEGER DEFAULT FALSE) \
-	X(ReplaySummary, ReplaySummary, TEXT)
+	X(std::string, Region, TEXT)
+
+// the full server response and arena info, these make up most of the size of a match
+// they are stored zlib compressed and only decompressed when a full match is read
+#define MATCH_BLOB_FIELDS(X)                 \
+	X(std::string, Json, BLOB)               \
+	X(std::string, ArenaInfo, BLOB)
+
+#define MATCH_STATE_FIELDS(X)                \
+	X(bool, Analyzed, INTEGER DEFAULT FALSE)
+
+// the replay summary is stored in typed columns of the match, its achievements and ribbons in the replayAwards table
+// the names are the ones of the ReplaySummary members, they are only set if the match was analyzed
+#define MATCH_SUMMARY_FIELDS(X)              \
+	X(MatchOutcome, Outcome, INTEGER)        \
+	X(float, DamageDealt, REAL)              \
+	X(float, DamageTaken, REAL)              \
+	X(float, DamageSpotting, REAL)           \
+	X(float, DamagePotential, REAL)
+
+#define MATCH_FIELDS(X) MATCH_INFO_FIELDS(X) MATCH_BLOB_FIELDS(X) MATCH_STATE_FIELDS(X)
+#define MATCH_LIST_FIELDS(X) MATCH_INFO_FIELDS(X) MATCH_STATE_FIELDS(X)
 
 #define SCHEMAINFO_FIELDS(X) \
 	X(std::string, Version, TEXT)
@@ -44,6 +75,38 @@ struct Match
 {
 	uint32_t Id;
 	MATCH_FIELDS(DECL_STRUCT)
+	ReplaySummary ReplaySummary;
+};
+
+// a match without the blob fields, which is all the match history needs to display it
+// the replay summary has no achievements and ribbons, they are loaded with GetReplaySummary
+struct MatchListEntry
+{
+	uint32_t Id;
+	MATCH_LIST_FIELDS(DECL_STRUCT)
+	ReplaySummary ReplaySummary;
+
+	static MatchListEntry FromMatch(const Match& match);
+};
+
+// the position of the last entry of a page, the next page starts right after it
+struct MatchListCursor
+{
+	std::string Date;
+	uint32_t Id;
+};
+
+// empty lists do not filter, otherwise the value has to be one of the list entries
+struct MatchListFilter
+{
+	std::vector<std::string> Ships;
+	std::vector<std::string> Maps;
+	std::vector<std::string> MatchGroups;
+	std::vector<std::string> StatsModes;
+	std::vector<std::string> Players;
+	std::vector<std::string> Regions;
+	std::optional<std::string> DateFrom;  // inclusive, YYYY-MM-DD HH:MM:SS
+	std::optional<std::string> DateTo;    // inclusive, YYYY-MM-DD HH:MM:SS
 };
 
 struct SchemaInfo
@@ -52,8 +115,25 @@ struct SchemaInfo
 	SCHEMAINFO_FIELDS(DECL_STRUCT)
 };
 
+// the size of a table including its indices
+struct TableSize
+{
+	std::string Name;
+	uint64_t Size;
+};
+
+struct DatabaseStatistics
+{
+	uint64_t PageSize;
+	uint64_t PageCount;
+	uint64_t FreelistCount;  // unused pages, which are given back to the file system by the maintenance
+	std::optional<bool> QuickCheckPassed;  // empty until the check after startup ran
+	std::vector<TableSize> Tables;  // largest first
+};
+
 struct NonAnalyzedMatch
 {
+	uint32_t Id;
 	std::string Hash;
 	std::string ReplayName;
 };
@@ -64,23 +144,39 @@ using SqlResult = Result<T, SqlError>;
 #define PA_SQL_ERROR(...) (::std::unexpected(::PotatoAlert::Client::SqlError(fmt::format(__VA_ARGS__))))
 
 
+// all writes are serialized on a writer thread, which batches concurrent writes into a single transaction
+// reads use a pool of read-only connections, which in WAL mode never block on the writer
+// once the writer is idle it runs the database maintenance in small steps
 class DatabaseManager
 {
 public:
 	explicit DatabaseManager(Core::SQLite& db);
 	~DatabaseManager();
 
+	DatabaseManager(const DatabaseManager&) = delete;
+	DatabaseManager(DatabaseManager&&) = delete;
+	DatabaseManager& operator=(const DatabaseManager&) = delete;
+	DatabaseManager& operator=(DatabaseManager&&) = delete;
+
 	SqlResult<void> CreateTables() const;
 	SqlResult<void> MigrateTables() const;
 
 	// adds the match to db and set the id
 	[[nodiscard]] SqlResult<void> AddMatch(Match& match) const;
+	// the bulk operations run in a single transaction and either apply to all matches or to none
+	[[nodiscard]] SqlResult<void> AddMatches(std::span<Match> matches) const;
 	[[nodiscard]] SqlResult<std::optional<Match>> GetMatch(uint32_t id) const;
 	[[nodiscard]] SqlResult<std::optional<Match>> GetMatch(std::string_view hash) const;
 	[[nodiscard]] SqlResult<std::vector<Match>> GetMatches() const;
+	// newest matches first, pass the cursor of the last entry to get the next page
+	[[nodiscard]] SqlResult<std::vector<MatchListEntry>> GetMatchList(const MatchListFilter& filter, size_t limit, const std::optional<MatchListCursor>& after = std::nullopt) const;
+	[[nodiscard]] SqlResult<size_t> GetMatchCount(const MatchListFilter& filter) const;
+	// matches where every word of the query is a player name, clan, ship or map word, newest first
+	// words ending with a '*' match everything starting with them
+	[[nodiscard]] SqlResult<std::vector<MatchListEntry>> SearchMatches(std::string_view query, size_t limit, const std::optional<MatchListCursor>& after = std::nullopt) const;
 	[[nodiscard]] SqlResult<void> DeleteMatch(uint32_t id) const;
 	[[nodiscard]] SqlResult<void> DeleteMatch(std::string_view hash) const;
-	[[nodiscard]] SqlResult<void> DeleteMatches(std::span<uint32_t> ids) const;
+	[[nodiscard]] SqlResult<void> DeleteMatches(std::span<const uint32_t> ids) const;
 	[[nodiscard]] SqlResult<void> UpdateMatch(uint32_t id, const Match& match) const;
 	[[nodiscard]] SqlResult<void> UpdateMatch(std::string_view hash, const Match& match) const;
 	[[nodiscard]] SqlResult<void> SetMatchNonAnalyzed(uint32_t id) const;
@@ -89,15 +185,111 @@ public:
 	[[nodiscard]] SqlResult<std::optional<Match>> GetLatestMatch() const;
 	[[nodiscard]] SqlResult<std::optional<std::string>> GetMatchJson(uint32_t id) const;
 	[[nodiscard]] SqlResult<std::optional<std::string>> GetMatchJson(std::string_view hash) const;
+	[[nodiscard]] SqlResult<std::optional<ReplaySummary>> GetReplaySummary(uint32_t id) const;
 	[[nodiscard]] SqlResult<void> SetMatchReplaySummary(uint32_t id, const ReplaySummary& replaySummary) const;
 	[[nodiscard]] SqlResult<void> SetMatchReplaySummary(std::string_view hash, const ReplaySummary& replaySummary) const;
+	// the matches are looked up by the hash of each summary
+	[[nodiscard]] SqlResult<void> SetMatchReplaySummaries(std::span<const ReplaySummary> replaySummaries) const;
 	[[nodiscard]] SqlResult<bool> MatchExists(uint32_t id) const;
 	[[nodiscard]] SqlResult<bool> MatchExists(std::string_view hash) const;
+	// the statistics are kept up to date on every write, reading them only depends on the number of groups
+	[[nodiscard]] SqlResult<std::vector<MatchStatistics>> GetMatchStatistics(StatisticsGrouping grouping) const;
+	[[nodiscard]] SqlResult<std::vector<AwardStatistics>> GetAwardStatistics(StatisticsGrouping grouping, std::string_view key) const;
+	[[nodiscard]] SqlResult<DatabaseStatistics> GetDatabaseStatistics() const;
 
 private:
-	static constexpr Version m_currentVersion = Version(1, 0);
+	// a connection from the reader pool, which is returned to the pool on destruction
+	// if there is no pool, the writer connection is locked for as long as the reader exists
+	class Reader
+	{
+	public:
+		Reader(const DatabaseManager& dbm, Core::SQLite db) : m_dbm(&dbm), m_db(std::move(db)) {}
+		Reader(const Core::SQLite& shared, std::recursive_mutex& mutex) : m_fallback(&shared), m_lock(mutex) {}
+		~Reader();
+
+		Reader(const Reader&) = delete;
+		Reader(Reader&&) = delete;
+		Reader& operator=(const Reader&) = delete;
+		Reader& operator=(Reader&&) = delete;
+
+		const Core::SQLite* operator->() const
+		{
+			return m_fallback ? m_fallback : &m_db;
+		}
+
+		const Core::SQLite& operator*() const
+		{
+			return *operator->();
+		}
+
+	private:
+		const DatabaseManager* m_dbm = nullptr;
+		Core::SQLite m_db;
+		const Core::SQLite* m_fallback = nullptr;
+		std::unique_lock<std::recursive_mutex> m_lock;
+	};
+
+	struct WriteJob
+	{
+		std::function<SqlResult<void>()> Func;
+		std::promise<SqlResult<void>> Result;
+	};
+
+	enum class QuickCheck : uint8_t
+	{
+		Pending,
+		Passed,
+		Failed,
+	};
+
+	static constexpr Version m_currentVersion = Version(1, 4);
+	static constexpr size_t MaxWriteBatchSize = 256;
+	// maintenance only starts after the writer was idle for a while and pauses between steps for new writes
+	static constexpr std::chrono::seconds MaintenanceIdleDelay{ 30 };
+	static constexpr std::chrono::milliseconds MaintenanceStepDelay{ 100 };
+	static constexpr std::chrono::minutes MaintenanceInterval{ 10 };
+	static constexpr std::chrono::hours OptimizeInterval{ 1 };
+	static constexpr uint32_t IncrementalVacuumPages = 256;
 	Core::SQLite& m_db;
+	// in-memory and temporary databases cannot be opened by the readers, they share the writer connection
+	const bool m_sharedConnection;
 	static constexpr std::string_view matchTable = "matches";
+
+	// held by the writer thread while it uses the connection and by readers of a shared connection
+	mutable std::recursive_mutex m_connectionMutex;
+
+	mutable std::mutex m_readerMutex;
+	mutable std::vector<Core::SQLite> m_readers;
+
+	mutable std::mutex m_writeMutex;
+	mutable std::condition_variable m_writeCondition;
+	mutable std::deque<WriteJob> m_writeQueue;
+	bool m_stopWriter = false;
+	std::thread m_writer;
+
+	// only used by the writer thread
+	std::chrono::steady_clock::time_point m_nextMaintenance;
+	std::chrono::steady_clock::time_point m_nextOptimize;
+	bool m_rebuildPending = false;
+	std::atomic<QuickCheck> m_quickCheck = QuickCheck::Pending;
+
+	[[nodiscard]] Reader AcquireReader() const;
+	// runs func on the writer thread inside of a transaction and waits for it to be committed
+	SqlResult<void> Write(std::function<SqlResult<void>()> func) const;
+	// runs func inside of a savepoint, which is rolled back if func fails
+	SqlResult<void> Savepoint(const std::function<SqlResult<void>()>& func) const;
+	void RunWriter();
+	// runs a single maintenance step on the writer connection, returns true if there is more work left
+	bool RunMaintenance();
+	void RunQuickCheck();
+
+	// switches the database to incremental auto vacuum, returns true if an existing database still has to be rebuilt
+	static SqlResult<bool> EnableIncrementalVacuum(const Core::SQLite& db);
+
+	// creates the statistics tables and the triggers which update them on writes to matches and replayAwards
+	static SqlResult<void> CreateStatisticsTables(const Core::SQLite& db);
+	// recomputes the statistics tables from the matches, has to run inside of a write
+	static SqlResult<void> RebuildStatistics(const Core::SQLite& db);
 };
 
 }  // namespace PotatoAlert::Client
@@ -0,0 +1,60 @@
+// Copyright 2025 <github.com/razaqq>
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+
+namespace PotatoAlert::Client {
+
+// the kind of award in the replayAwards table
+enum class AwardKind : int32_t
+{
+	Achievement = 0,
+	Ribbon = 1,
+};
+
+// the column the statistics are grouped by, All has a single group with an empty key
+enum class StatisticsGrouping : int32_t
+{
+	All = 0,
+	Ship = 1,
+	Map = 2,
+	MatchGroup = 3,
+};
+
+// sums over all matches of a group, the replay summary values only include analyzed matches
+struct MatchStatistics
+{
+	std::string Key;
+	uint32_t Matches;
+	uint32_t Analyzed;
+	uint32_t Wins;
+	uint32_t Losses;
+	uint32_t Draws;
+	double DamageDealt;
+	double DamageTaken;
+	double DamageSpotting;
+	double DamagePotential;
+
+	[[nodiscard]] double WinRate() const
+	{
+		return Analyzed ? 100.0 * Wins / Analyzed : 0.0;
+	}
+
+	// the average of a sum over the analyzed matches, e.g. PerGame(DamageDealt)
+	[[nodiscard]] double PerGame(double value) const
+	{
+		return Analyzed ? value / Analyzed : 0.0;
+	}
+};
+
+// the total count of an achievement or ribbon over the analyzed matches of a group
+struct AwardStatistics
+{
+	AwardKind Kind;
+	int64_t Type;  // the AchievementType or RibbonType
+	uint64_t Count;
+};
+
+}  // namespace PotatoAlert::Client
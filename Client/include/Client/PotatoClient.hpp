@@ -18,6 +18,7 @@
 #include <QString>
 #include <QNetworkReply>
 
+#include <chrono>
 #include <filesystem>
 #include <optional>
 #include <string>
@@ -76,6 +77,7 @@ private:
 	const ServiceProvider& m_services;
 	Core::DirectoryWatcher m_watcher;
 	std::string m_lastArenaInfoHash;
+	std::chrono::steady_clock::time_point m_requestTime;
 	std::vector<GameDirectory> m_gameInfos;
 	ReplayAnalyzer& m_replayAnalyzer;
 	std::optional<SysInfo> m_sysInfo;
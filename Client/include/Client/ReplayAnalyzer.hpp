@@ -3,6 +3,7 @@
 
 #include "Client/ServiceProvider.hpp"
 
+#include "Core/CancellationToken.hpp"
 #include "Core/ThreadPool.hpp"
 
 #include "ReplayParser/ReplayParser.hpp"
@@ -13,8 +14,10 @@
 
 #include <chrono>
 #include <filesystem>
+#include <span>
 #include <unordered_set>
 #include <string>
+#include <vector>
 
 
 namespace fs = std::filesystem;
@@ -40,16 +43,23 @@ public:
 		qRegisterMetaType<ReplaySummary>("ReplaySummary");
 	}
 
+	// the replays of the directory are analyzed after the ones of new matches
 	void AnalyzeDirectory(const std::filesystem::path& directory);
+	// same priority as a directory, e.g. for the replays that were written while we were closed
+	void AnalyzeReplays(const std::vector<std::filesystem::path>& files);
+	// stops analyzing the directories at the next replay, e.g. when the game directories changed
+	void CancelDirectoryAnalysis();
 	void OnFileChanged(const std::filesystem::path& file);
 	bool HasGameFiles(Version gameVersion) const;
 	static GameFileUnpack::UnpackResult<void> UnpackGameFiles(const std::filesystem::path& dst, const std::filesystem::path& pkgPath, const std::filesystem::path& idxPath);
 
 private:
 	void AnalyzeReplay(const std::filesystem::path& path, std::chrono::seconds readDelay = std::chrono::seconds(0));
+	void StoreSummaries(std::span<const uint32_t> ids, std::span<const ReplaySummary> summaries) const;
 
 	const ServiceProvider& m_services;
 	Core::ThreadPool m_threadPool;
+	Core::CancellationToken m_directoryCancellation;
 	std::unordered_map<std::filesystem::path::string_type, std::future<void>> m_futures;
 	fs::path m_gameFilePath;
 
@@ -7,7 +7,9 @@
 #include <QLabel>
 #include <QTableWidgetItem>
 
+#include <memory>
 #include <optional>
+#include <string>
 #include <variant>
 #include <vector>
 
@@ -118,9 +120,38 @@ struct MatchParseOptions
 	float FontScaling;
 };
 
-Core::JsonResult<StatsParseResult> ParseMatch(const rapidjson::Value& j, const MatchContext& matchContext, MatchParseOptions&& parseOptions) noexcept;
+// the result of a server reply, it is read into the structs of the parser in the same pass as the rest of the reply
+// the json text is captured alongside for the match history, a missing or null result leaves it without a match
+class ServerMatch
+{
+public:
+	ServerMatch();
+	ServerMatch(ServerMatch&&) noexcept;
+	ServerMatch& operator=(ServerMatch&&) noexcept;
+	~ServerMatch();
+
+	[[nodiscard]] bool HasMatch() const;
+
+	std::string Json;
+
+private:
+	struct Data;
+	std::unique_ptr<Data> m_data;
+
+	friend struct Core::JsonSax<ServerMatch>;
+	friend Core::JsonResult<StatsParseResult> ParseMatch(ServerMatch& match, const MatchContext& matchContext, MatchParseOptions&& parseOptions) noexcept;
+};
+
 Core::JsonResult<StatsParseResult> ParseMatch(const std::string& raw, const MatchContext& matchContext, MatchParseOptions&& parseOptions) noexcept;
+// the values are moved out of the match, only its json text is left
+Core::JsonResult<StatsParseResult> ParseMatch(ServerMatch& match, const MatchContext& matchContext, MatchParseOptions&& parseOptions) noexcept;
 
 }  // namespace StatsParser
 
 }  // namespace PotatoAlert::Client
+
+template<>
+struct PotatoAlert::Core::JsonSax<PotatoAlert::Client::StatsParser::ServerMatch>
+{
+	static Sax::Sink SinkFor(Client::StatsParser::ServerMatch& match);
+};
@@ -0,0 +1,107 @@
+// Copyright 2025 <github.com/razaqq>
+
+#include "Client/AsyncDatabaseManager.hpp"
+#include "Client/DatabaseManager.hpp"
+
+#include "Core/Instrumentor.hpp"
+#include "Core/Result.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+using PotatoAlert::Client::AsyncDatabaseManager;
+using PotatoAlert::Client::DatabaseTask;
+using PotatoAlert::Client::Match;
+using PotatoAlert::Client::MatchListCursor;
+using PotatoAlert::Client::MatchListEntry;
+using PotatoAlert::Client::MatchListFilter;
+using PotatoAlert::Client::MatchStatistics;
+using PotatoAlert::Client::SqlResult;
+using PotatoAlert::Client::StatisticsGrouping;
+
+DatabaseTask AsyncDatabaseManager::GetMatchListAsync(MatchListFilter filter, QObject* context, Callback<std::vector<MatchListEntry>> callback)
+{
+	return Run<std::vector<MatchListEntry>>(context, [this, filter = std::move(filter)](const DatabaseTask& task) -> SqlResult<std::vector<MatchListEntry>>
+	{
+		PA_PROFILE_SCOPE("GetMatchListAsync");
+
+		std::vector<MatchListEntry> matches;
+		std::optional<MatchListCursor> cursor;
+		while (!task.IsCancelled())
+		{
+			PA_TRY(page, m_dbm.GetMatchList(filter, MatchListPageSize, cursor));
+
+			if (page.empty())
+				break;
+
+			cursor = MatchListCursor{ page.back().Date, page.back().Id };
+			const bool lastPage = page.size() < MatchListPageSize;
+			matches.insert(matches.end(), std::make_move_iterator(page.begin()), std::make_move_iterator(page.end()));
+
+			if (lastPage)
+				break;
+		}
+		return matches;
+	}, std::move(callback));
+}
+
+DatabaseTask AsyncDatabaseManager::SearchMatchesAsync(std::string query, size_t limit, QObject* context, Callback<std::vector<MatchListEntry>> callback)
+{
+	return Run<std::vector<MatchListEntry>>(context, [this, query = std::move(query), limit]([[maybe_unused]] const DatabaseTask& task)
+	{
+		return m_dbm.SearchMatches(query, limit);
+	}, std::move(callback));
+}
+
+DatabaseTask AsyncDatabaseManager::GetMatchJsonAsync(uint32_t id, QObject* context, Callback<std::optional<std::string>> callback)
+{
+	return Run<std::optional<std::string>>(context, [this, id]([[maybe_unused]] const DatabaseTask& task)
+	{
+		return m_dbm.GetMatchJson(id);
+	}, std::move(callback));
+}
+
+DatabaseTask AsyncDatabaseManager::GetReplaySummaryAsync(uint32_t id, QObject* context, Callback<std::optional<ReplaySummary>> callback)
+{
+	return Run<std::optional<ReplaySummary>>(context, [this, id]([[maybe_unused]] const DatabaseTask& task)
+	{
+		return m_dbm.GetReplaySummary(id);
+	}, std::move(callback));
+}
+
+DatabaseTask AsyncDatabaseManager::GetMatchStatisticsAsync(StatisticsGrouping grouping, QObject* context, Callback<std::vector<MatchStatistics>> callback)
+{
+	return Run<std::vector<MatchStatistics>>(context, [this, grouping]([[maybe_unused]] const DatabaseTask& task)
+	{
+		return m_dbm.GetMatchStatistics(grouping);
+	}, std::move(callback));
+}
+
+DatabaseTask AsyncDatabaseManager::DeleteMatchesAsync(std::vector<uint32_t> ids, QObject* context, Callback<void> callback)
+{
+	// a write is not interrupted once it started, cancelling only drops the callback
+	return Run<void>(context, [this, ids = std::move(ids)]([[maybe_unused]] const DatabaseTask& task)
+	{
+		return m_dbm.DeleteMatches(ids);
+	}, std::move(callback));
+}
+
+DatabaseTask AsyncDatabaseManager::AddMatchAsync(Match match, QObject* context, Callback<std::optional<Match>> callback)
+{
+	return Run<std::optional<Match>>(context, [this, match = std::move(match)]([[maybe_unused]] const DatabaseTask& task) mutable -> SqlResult<std::optional<Match>>
+	{
+		PA_TRY(exists, m_dbm.MatchExists(match.Hash));
+		if (exists)
+		{
+			return std::nullopt;
+		}
+
+		PA_TRYV(m_dbm.AddMatch(match));
+		return std::move(match);
+	}, std::move(callback));
+}
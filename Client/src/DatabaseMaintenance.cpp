@@ -0,0 +1,222 @@
+// Copyright 2025 <github.com/razaqq>
+
+#include "Client/DatabaseManager.hpp"
+
+#include "Core/Format.hpp"
+#include "Core/Instrumentor.hpp"
+#include "Core/Log.hpp"
+#include "Core/Sqlite.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+using PotatoAlert::Client::DatabaseManager;
+using PotatoAlert::Client::DatabaseStatistics;
+using PotatoAlert::Client::SqlResult;
+using PotatoAlert::Client::TableSize;
+using PotatoAlert::Core::SQLite;
+
+namespace {
+
+// deleted matches leave free pages behind, with incremental auto vacuum they are only given back to the file system by
+// incremental_vacuum, which the maintenance runs in small steps instead of a full vacuum that rewrites the whole file
+static constexpr int64_t IncrementalAutoVacuum = 2;
+
+std::optional<int64_t> GetPragma(const SQLite& db, std::string_view pragma)
+{
+	SQLite::Statement stmt(db, pragma);
+	if (!stmt)
+	{
+		return std::nullopt;
+	}
+
+	stmt.ExecuteStep();
+	int64_t value;
+	if (!stmt.HasRow() || !stmt.GetInt64(0, value))
+	{
+		return std::nullopt;
+	}
+	return value;
+}
+
+}  // namespace
+
+SqlResult<bool> DatabaseManager::EnableIncrementalVacuum(const SQLite& db)
+{
+	PA_PROFILE_FUNCTION();
+
+	if (GetPragma(db, "PRAGMA auto_vacuum") == IncrementalAutoVacuum)
+	{
+		return false;
+	}
+
+	if (!db.Execute("PRAGMA auto_vacuum = INCREMENTAL"))
+	{
+		return PA_SQL_ERROR("Failed to set auto vacuum: {}", db.GetLastError());
+	}
+
+	// new databases switch right away, existing ones only after the file is rebuilt once
+	return GetPragma(db, "PRAGMA auto_vacuum") != IncrementalAutoVacuum;
+}
+
+void DatabaseManager::RunQuickCheck()
+{
+	PA_PROFILE_FUNCTION();
+
+	// only reads the pages and indices, it is a lot faster than a full integrity_check
+	std::vector<std::string> errors;
+	const bool checked = m_db.Execute("PRAGMA quick_check(10)", [&errors](int columns, char** columnText, [[maybe_unused]] char** columnNames) -> int
+	{
+		if (columns > 0 && columnText[0] && std::string_view(columnText[0]) != "ok")
+		{
+			errors.emplace_back(columnText[0]);
+		}
+		return 0;
+	});
+
+	if (!checked)
+	{
+		LOG_ERROR("Failed to run database quick check: {}", m_db.GetLastError());
+		errors.emplace_back(m_db.GetLastError());
+	}
+	for (const std::string& error : errors)
+	{
+		LOG_ERROR("Database quick check failed: {}", error);
+	}
+
+	m_quickCheck = errors.empty() ? QuickCheck::Passed : QuickCheck::Failed;
+}
+
+bool DatabaseManager::RunMaintenance()
+{
+	PA_PROFILE_FUNCTION();
+
+	// the rebuild rewrites the whole file once, a database that failed the quick check is left as it is
+	if (m_rebuildPending)
+	{
+		m_rebuildPending = false;
+		if (m_quickCheck != QuickCheck::Passed)
+		{
+			LOG_WARN("Skipping database rebuild for incremental vacuum, the quick check did not pass");
+			return true;
+		}
+
+		LOG_INFO("Rebuilding database to enable incremental vacuum");
+		if (!m_db.Execute("VACUUM"))
+		{
+			LOG_ERROR("Failed to VACUUM database: {}", m_db.GetLastError());
+		}
+		return true;
+	}
+
+	const std::optional<int64_t> freePages = GetPragma(m_db, "PRAGMA freelist_count");
+	if (freePages.value_or(0) > 0)
+	{
+		if (!m_db.Execute(fmt::format("PRAGMA incremental_vacuum({})", IncrementalVacuumPages)))
+		{
+			LOG_ERROR("Failed to run incremental vacuum: {}", m_db.GetLastError());
+			return false;
+		}
+		if (*freePages > IncrementalVacuumPages)
+		{
+			return true;
+		}
+
+		// the file only shrinks once the vacuumed pages are moved from the WAL into it
+		if (!m_db.Execute("PRAGMA wal_checkpoint(PASSIVE)"))
+		{
+			LOG_ERROR("Failed to checkpoint database: {}", m_db.GetLastError());
+		}
+		return false;
+	}
+
+	// the analysis is limited by analysis_limit, 0x10000 also checks tables this connection did not use yet
+	const auto now = std::chrono::steady_clock::now();
+	if (now >= m_nextOptimize)
+	{
+		if (!m_db.Execute("PRAGMA optimize = 0x10002"))
+		{
+			LOG_ERROR("Failed to optimize database: {}", m_db.GetLastError());
+		}
+		m_nextOptimize = now + OptimizeInterval;
+	}
+
+	return false;
+}
+
+SqlResult<DatabaseStatistics> DatabaseManager::GetDatabaseStatistics() const
+{
+	static constexpr std::string_view pagesQuery =
+			"SELECT page_size, page_count, freelist_count FROM pragma_page_size(), pragma_page_count(), pragma_freelist_count()";
+
+	// indices are counted towards their table, fts5 and other virtual tables are made up of multiple shadow tables
+	static constexpr std::string_view tablesQuery =
+			"SELECT coalesce(s.tbl_name, d.name) AS Name, sum(d.pgsize) AS Size "
+			"FROM dbstat AS d LEFT JOIN sqlite_schema AS s ON s.name = d.name "
+			"WHERE d.aggregate = TRUE GROUP BY 1 ORDER BY Size DESC";
+
+	const Reader db = AcquireReader();
+
+	DatabaseStatistics statistics{};
+	{
+		SQLite::CachedStatement stmt = db->Prepare(pagesQuery);
+		if (!stmt)
+		{
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
+		}
+
+		stmt->ExecuteStep();
+		int64_t pageSize = 0, pageCount = 0, freelistCount = 0;
+		if (!stmt->HasRow() || !stmt->GetInt64(0, pageSize) || !stmt->GetInt64(1, pageCount) || !stmt->GetInt64(2, freelistCount))
+		{
+			return PA_SQL_ERROR("Failed to read page counts: {}", db->GetLastError());
+		}
+		statistics.PageSize = static_cast<uint64_t>(pageSize);
+		statistics.PageCount = static_cast<uint64_t>(pageCount);
+		statistics.FreelistCount = static_cast<uint64_t>(freelistCount);
+	}
+
+	switch (m_quickCheck.load())
+	{
+		case QuickCheck::Pending:
+			break;
+		case QuickCheck::Passed:
+			statistics.QuickCheckPassed = true;
+			break;
+		case QuickCheck::Failed:
+			statistics.QuickCheckPassed = false;
+			break;
+	}
+
+	// dbstat is a compile time option of sqlite, without it there are only the page counts
+	SQLite::CachedStatement stmt = db->Prepare(tablesQuery);
+	if (!stmt)
+	{
+		LOG_WARN("Failed to read table sizes: {}", db->GetLastError());
+		return statistics;
+	}
+
+	while (!stmt->IsDone())
+	{
+		stmt->ExecuteStep();
+		if (stmt->HasRow())
+		{
+			TableSize& table = statistics.Tables.emplace_back();
+			int64_t size = 0;
+			stmt->GetText(0, table.Name);
+			stmt->GetInt64(1, size);
+			table.Size = static_cast<uint64_t>(size);
+		}
+	}
+
+	if (stmt->HasFailed())
+	{
+		return PA_SQL_ERROR("Failed to read table sizes: {}", db->GetLastError());
+	}
+	return statistics;
+}
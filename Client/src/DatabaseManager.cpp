@@ -2,29 +2,51 @@
 
 #include "Client/DatabaseManager.hpp"
 
+#include "Core/Bytes.hpp"
 #include "Core/Format.hpp"
 #include "Core/Instrumentor.hpp"
+#include "Core/Log.hpp"
+#include "Core/Metrics.hpp"
 #include "Core/Preprocessor.hpp"
 #include "Core/Result.hpp"
 #include "Core/Sqlite.hpp"
 #include "Core/String.hpp"
 #include "Core/Time.hpp"
 #include "Core/Version.hpp"
+#include "Core/Zlib.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <mutex>
 #include <optional>
 #include <span>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 
+using PotatoAlert::Client::AwardKind;
 using PotatoAlert::Client::DatabaseManager;
 using PotatoAlert::Client::Match;
+using PotatoAlert::Client::MatchListCursor;
+using PotatoAlert::Client::MatchListEntry;
+using PotatoAlert::Client::MatchListFilter;
 using PotatoAlert::Client::NonAnalyzedMatch;
 using PotatoAlert::Client::SchemaInfo;
 using PotatoAlert::Client::SqlResult;
+using PotatoAlert::Core::Byte;
 using PotatoAlert::Core::SQLite;
+using PotatoAlert::ReplayParser::AchievementType;
+using PotatoAlert::ReplayParser::RibbonType;
+namespace Zlib = PotatoAlert::Core::Zlib;
 
 #define PA_DB_COLUMNS_WITH_ID_X_ENTRY(Type, Name, SqlType) ", " #Name
 #define PA_DB_COLUMNS_WITH_ID(Columns) "Id" Columns(PA_DB_COLUMNS_WITH_ID_X_ENTRY)
@@ -50,6 +72,9 @@ using PotatoAlert::Core::SQLite;
 #define PA_DB_SELECT_WITH_ID(Columns) "SELECT " PA_DB_COLUMNS_WITH_ID(Columns)
 #define PA_DB_CREATE_TABLE_WITH_ID(Table, Columns) "CREATE TABLE IF NOT EXISTS " #Table " (" PA_DB_COLUMNS_TYPES_WITH_ID(Columns) ")"
 
+#define MATCH_COLUMNS(X) MATCH_FIELDS(X) MATCH_SUMMARY_FIELDS(X)
+#define MATCH_LIST_COLUMNS(X) MATCH_LIST_FIELDS(X) MATCH_SUMMARY_FIELDS(X)
+
 namespace {
 
 template<typename T>
@@ -63,7 +88,7 @@ static inline T ParseValue(const SQLite::Statement& stmt, int index)
 			return value;
 		}
 	}
-	else if constexpr (std::is_integral_v<Value>)
+	else if constexpr (std::is_integral_v<Value> || std::is_enum_v<Value>)
 	{
 		if (int64_t value; stmt.GetInt64(index, value))
 		{
@@ -72,9 +97,9 @@ static inline T ParseValue(const SQLite::Statement& stmt, int index)
 	}
 	else if constexpr (std::is_floating_point_v<Value>)
 	{
-		if (T value; stmt.GetDouble(index, value))
+		if (double value; stmt.GetDouble(index, value))
 		{
-			return value;
+			return static_cast<Value>(value);
 		}
 	}
 	else if constexpr (std::is_same_v<Value, std::string>)
@@ -84,38 +109,80 @@ static inline T ParseValue(const SQLite::Statement& stmt, int index)
 			return value;
 		}
 	}
-	else if constexpr (std::is_same_v<Value, ReplaySummary>)
-	{
-		if (std::string json; stmt.GetText(index, json))
-		{
-			ReplaySummary summary;
-			FromJson(json, summary);  // TODO: handle the result
-			return summary;
-		}
-	}
 
 	LOG_ERROR("Failed to parse value into {}", typeid(T).name());
 	return T();
 }
 
 template<typename T>
-static inline T GetValue(const T& value)
-{
-	return value;
-}
-
-static inline std::string GetValue(const ReplaySummary& summary)
+static inline auto GetValue(const T& value)
 {
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer writer(buffer);
-	ToJson(writer, summary);  // TODO: handle the result
-	return buffer.GetString();
+	if constexpr (std::is_enum_v<T>)
+	{
+		return static_cast<int64_t>(value);
+	}
+	else
+	{
+		return value;
+	}
 }
 
 #define BIND_VALUE(Name, Stmt, Value)             \
 	auto PA_CAT(_value_, Name) = GetValue(Value); \
 	(Stmt).Bind(PA_STR(:Name), PA_CAT(_value_, Name))
 
+// the keys and values that make up most of the server response and arena info, preset for every compressed column
+// this can never change, because the stored matches can only be decompressed with the dictionary they were compressed with
+static constexpr std::string_view CompressionDictionary =
+	R"({"clientVersionFromXml":"","clientVersionFromExe":"","gameMode":7,"gameLogic":"Domination","scenario":"Domination",)"
+	R"("scenarioConfigId":,"scenarioUiCategoryId":0,"weatherParams":{},"disabledShipClasses":null,"mapBorder":null,)"
+	R"("battleDuration":1200,"duration":1200,"mapId":,"mapName":"spaces/","mapDisplayName":"","matchGroup":"pvp",)"
+	R"("playersPerTeam":12,"teamsCount":2,"logic":"Domination","name":"12x12","dateTime":"","playerID":0,)"
+	R"("playerName":"","playerVehicle":"","vehicles":[{"shipId":,"relation":2,"id":,"name":""},)"
+	R"("match_group":"pvp","stats_mode":"current","region":"eu","date_time":"","map":"",)"
+	R"("team1":{"id":1,"players":[],"team2":{"id":2,"players":[],"avg_dmg":{"string":"","color":[,,]},)"
+	R"("avg_win_rate":{"string":"","color":[,,]},"clan":null,"clan":{"name":"","tag":"","color":[,,],"region":"eu"},)"
+	R"("hidden_profile":false,"name_color":[255,255,255],"ship":{"name":"","class":"Destroyer","nation":"usa","tier":10},)"
+	R"("class":"Cruiser","class":"Battleship","class":"AirCarrier","class":"Submarine","nation":"japan",)"
+	R"("battles":{"string":"","color":[,,]},"win_rate":{"string":"","color":[,,]},"avg_dmg":{"string":"","color":[,,]},)"
+	R"("battles_ship":{"string":"","color":[,,]},"win_rate_ship":{"string":"","color":[,,]},)"
+	R"("avg_dmg_ship":{"string":"","color":[,,]},"pr_color":[,,,],"karma":null,"is_using_pa":false,)"
+	R"("wows_numbers_link":"https://wows-numbers.com/player/,/"})";
+
+static std::vector<Byte> CompressText(std::string_view text)
+{
+	return Zlib::Deflate(std::span(reinterpret_cast<const Byte*>(text.data()), text.size()), 6,
+		std::span(reinterpret_cast<const Byte*>(CompressionDictionary.data()), CompressionDictionary.size()));
+}
+
+static std::string ParseCompressedText(const SQLite::Statement& stmt, int index)
+{
+	std::span<const Byte> blob;
+	if (!stmt.GetBlob(index, blob))
+	{
+		// columns that were not migrated yet are still plain text
+		return ParseValue<std::string>(stmt, index);
+	}
+
+	std::string text;
+	const bool success = Zlib::InflateChunked(blob, [&text](std::span<const Byte> chunk) -> bool
+	{
+		text.append(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+		return true;
+	}, true, std::span(reinterpret_cast<const Byte*>(CompressionDictionary.data()), CompressionDictionary.size()));
+
+	if (!success)
+	{
+		LOG_ERROR("Failed to decompress database column {}", index);
+		return {};
+	}
+	return text;
+}
+
+#define BIND_COMPRESSED_VALUE(Name, Stmt, Value)       \
+	auto PA_CAT(_value_, Name) = CompressText(Value);  \
+	(Stmt).Bind(PA_STR(:Name), std::span<const Byte>(PA_CAT(_value_, Name)))
+
 #if 0
 #define BIND_VALUE(Name, Stmt, Value)                                           \
 	if constexpr (std::is_same_v<std::decay_t<decltype(Value)>, ReplaySummary>) \
@@ -145,13 +212,367 @@ static inline bool BindValue(std::string_view name, SQLite::Statement& stmt, con
 }
 #endif
 
+// parses the summary columns starting at index, the achievements and ribbons are read with ReadReplayAwards
+static inline ReplaySummary ParseReplaySummary(const SQLite::Statement& stmt, int index, const std::string& hash, bool analyzed)
+{
+	ReplaySummary summary;
+	summary.Hash = hash;
+	if (analyzed)
+	{
+#define PARSE_FIELD(Type, Name, SqlType) summary.Name = ParseValue<Type>(stmt, index++);
+		MATCH_SUMMARY_FIELDS(PARSE_FIELD)
+#undef PARSE_FIELD
+	}
+	return summary;
+}
+
 static inline Match ParseMatch(const SQLite::Statement& stmt)
 {
 	int index = 0;
 
 #define PARSE_FIELD(Type, Name, SqlType) .Name = ParseValue<Type>(stmt, index++),
-	return Match{ PARSE_FIELD(uint32_t, Id, "") MATCH_FIELDS(PARSE_FIELD) };
+#define PARSE_COMPRESSED_FIELD(Type, Name, SqlType) .Name = ParseCompressedText(stmt, index++),
+	Match match{ PARSE_FIELD(uint32_t, Id, "") MATCH_INFO_FIELDS(PARSE_FIELD) MATCH_BLOB_FIELDS(PARSE_COMPRESSED_FIELD) MATCH_STATE_FIELDS(PARSE_FIELD) };
+#undef PARSE_COMPRESSED_FIELD
 #undef PARSE_FIELD
+
+	match.ReplaySummary = ParseReplaySummary(stmt, index, match.Hash, match.Analyzed);
+	return match;
+}
+
+static inline MatchListEntry ParseMatchListEntry(const SQLite::Statement& stmt)
+{
+	int index = 0;
+
+#define PARSE_FIELD(Type, Name, SqlType) .Name = ParseValue<Type>(stmt, index++),
+	MatchListEntry entry{ PARSE_FIELD(uint32_t, Id, "") MATCH_LIST_FIELDS(PARSE_FIELD) };
+#undef PARSE_FIELD
+
+	entry.ReplaySummary = ParseReplaySummary(stmt, index, entry.Hash, entry.Analyzed);
+	return entry;
+}
+
+static SqlResult<void> ReadReplayAwards(const SQLite& db, uint32_t id, ReplaySummary& replaySummary)
+{
+	static constexpr std::string_view selectQuery = "SELECT Kind, Type, Count FROM replayAwards WHERE MatchId = :MatchId";
+
+	SQLite::CachedStatement stmt = db.Prepare(selectQuery);
+
+	if (!stmt)
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db.GetLastError());
+	}
+
+	stmt->Bind(":MatchId", id);
+
+	while (!stmt->IsDone())
+	{
+		stmt->ExecuteStep();
+		if (stmt->HasRow())
+		{
+			const uint32_t count = ParseValue<uint32_t>(*stmt, 2);
+			switch (ParseValue<AwardKind>(*stmt, 0))
+			{
+				case AwardKind::Achievement:
+					replaySummary.Achievements[ParseValue<AchievementType>(*stmt, 1)] = count;
+					break;
+				case AwardKind::Ribbon:
+					replaySummary.Ribbons[ParseValue<RibbonType>(*stmt, 1)] = count;
+					break;
+			}
+		}
+	}
+
+	if (stmt->HasFailed())
+	{
+		return PA_SQL_ERROR("Failed to read replay awards: {}", db.GetLastError());
+	}
+	return {};
+}
+
+// parses a full match row and reads its achievements and ribbons
+static SqlResult<Match> ReadMatch(const SQLite& db, const SQLite::Statement& stmt)
+{
+	Match match = ParseMatch(stmt);
+	if (match.Analyzed)
+	{
+		PA_TRYV(ReadReplayAwards(db, match.Id, match.ReplaySummary));
+	}
+	return match;
+}
+
+// replaces the achievements and ribbons of the match, this has to run inside of a write
+static SqlResult<void> WriteReplayAwards(const SQLite& db, uint32_t id, const ReplaySummary& replaySummary)
+{
+	static constexpr std::string_view deleteQuery = "DELETE FROM replayAwards WHERE MatchId = :MatchId";
+	static constexpr std::string_view insertQuery = "INSERT INTO replayAwards (MatchId, Kind, Type, Count) VALUES (:MatchId, :Kind, :Type, :Count)";
+
+	{
+		SQLite::CachedStatement stmt = db.Prepare(deleteQuery);
+
+		if (!stmt)
+		{
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db.GetLastError());
+		}
+
+		stmt->Bind(":MatchId", id);
+
+		stmt->ExecuteStep();
+		if (stmt->HasFailed())
+		{
+			return PA_SQL_ERROR("Failed to delete replay awards: {}", db.GetLastError());
+		}
+	}
+
+	if (replaySummary.Achievements.empty() && replaySummary.Ribbons.empty())
+	{
+		return {};
+	}
+
+	SQLite::CachedStatement stmt = db.Prepare(insertQuery);
+
+	if (!stmt)
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db.GetLastError());
+	}
+
+	auto insert = [&stmt, id](AwardKind kind, int64_t type, uint32_t count) -> bool
+	{
+		stmt->Reset();
+		stmt->Bind(":MatchId", id);
+		stmt->Bind(":Kind", static_cast<int32_t>(kind));
+		stmt->Bind(":Type", type);
+		stmt->Bind(":Count", count);
+
+		stmt->ExecuteStep();
+		return !stmt->HasFailed();
+	};
+
+	for (const auto& [achievement, count] : replaySummary.Achievements)
+	{
+		if (!insert(AwardKind::Achievement, static_cast<int64_t>(achievement), count))
+		{
+			return PA_SQL_ERROR("Failed to write replay achievement: {}", db.GetLastError());
+		}
+	}
+
+	for (const auto& [ribbon, count] : replaySummary.Ribbons)
+	{
+		if (!insert(AwardKind::Ribbon, static_cast<int64_t>(ribbon), count))
+		{
+			return PA_SQL_ERROR("Failed to write replay ribbon: {}", db.GetLastError());
+		}
+	}
+
+	return {};
+}
+
+// builds the WHERE clause for the filter, values holds the parameters in the order they have to be bound
+static void AppendFilter(const MatchListFilter& filter, std::string& where, std::vector<std::string_view>& values)
+{
+	auto appendCondition = [&where](std::string_view condition)
+	{
+		where += where.empty() ? " WHERE " : " AND ";
+		where += condition;
+	};
+
+	auto appendIn = [&](std::string_view column, const std::vector<std::string>& list)
+	{
+		if (list.empty())
+			return;
+
+		std::string condition = fmt::format("{} IN (", column);
+		for (size_t i = 0; i < list.size(); i++)
+		{
+			condition += i == 0 ? "?" : ", ?";
+			values.emplace_back(list[i]);
+		}
+		condition += ")";
+		appendCondition(condition);
+	};
+
+	appendIn("Ship", filter.Ships);
+	appendIn("Map", filter.Maps);
+	appendIn("MatchGroup", filter.MatchGroups);
+	appendIn("StatsMode", filter.StatsModes);
+	appendIn("Player", filter.Players);
+	appendIn("Region", filter.Regions);
+
+	if (filter.DateFrom)
+	{
+		appendCondition("Date >= ?");
+		values.emplace_back(*filter.DateFrom);
+	}
+
+	if (filter.DateTo)
+	{
+		appendCondition("Date <= ?");
+		values.emplace_back(*filter.DateTo);
+	}
+}
+
+static SqlResult<bool> HasColumn(const SQLite& db, std::string_view table, std::string_view column)
+{
+	SQLite::Statement stmt(db, "SELECT 1 FROM pragma_table_info(?) WHERE name = ?");
+	if (!stmt || !stmt.Bind(1, table) || !stmt.Bind(2, column))
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db.GetLastError());
+	}
+
+	stmt.ExecuteStep();
+	if (stmt.HasFailed())
+	{
+		return PA_SQL_ERROR("Failed to read table info: {}", db.GetLastError());
+	}
+	return stmt.HasRow();
+}
+
+// indexes the players, clans and ships of the server response and the map for SearchMatches
+// the json is only stored compressed, so it is passed in as text and extracted by sqlite, a malformed response only indexes the map
+static SqlResult<void> WriteMatchSearch(const SQLite& db, uint32_t id, std::string_view map, std::string_view json)
+{
+	// the json is parsed once into jsonb, which both teams are read from
+	static constexpr std::string_view insertQuery =
+		"WITH response (Json) AS MATERIALIZED (SELECT iif(json_valid(:Json), jsonb(:Json), jsonb('{}'))) "
+		"INSERT OR REPLACE INTO matchSearch (rowid, Players, Clans, Ships, Map) "
+		"SELECT :Id, group_concat(p.value ->> '$.name', ' '), "
+		"group_concat(concat_ws(' ', p.value ->> '$.clan.tag', p.value ->> '$.clan.name'), ' '), "
+		"group_concat(p.value ->> '$.ship.name', ' '), :Map "
+		"FROM (SELECT value FROM response, json_each(response.Json, '$.team1.players') "
+		"UNION ALL SELECT value FROM response, json_each(response.Json, '$.team2.players')) AS p";
+
+	SQLite::CachedStatement stmt = db.Prepare(insertQuery);
+
+	if (!stmt)
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db.GetLastError());
+	}
+
+	stmt->Bind(":Id", id);
+	stmt->Bind(":Map", map);
+	stmt->Bind(":Json", json);
+
+	stmt->ExecuteStep();
+	if (stmt->HasFailed())
+	{
+		return PA_SQL_ERROR("Failed to index match {} for search: {}", id, db.GetLastError());
+	}
+	return {};
+}
+
+// every word of the query has to match a whole token, unless it ends with a '*' to match the start of tokens
+// quoting the words keeps the fts5 query syntax out of user input
+static std::string ToSearchQuery(std::string_view query)
+{
+	std::string search;
+	for (std::string_view word : PotatoAlert::Core::String::Split(query, " "))
+	{
+		const bool prefix = word.ends_with('*');
+		while (word.ends_with('*'))
+		{
+			word.remove_suffix(1);
+		}
+		if (word.empty())
+		{
+			continue;
+		}
+
+		search += search.empty() ? "\"" : " \"";
+		for (const char c : word)
+		{
+			search += c;
+			if (c == '"')
+			{
+				search += '"';
+			}
+		}
+		search += prefix ? "\"*" : "\"";
+	}
+	return search;
+}
+
+// moves the replay summaries from the json column into the summary columns and the replayAwards table
+static SqlResult<void> MigrateReplaySummaries(const SQLite& db)
+{
+	PA_TRY(hasJsonColumn, HasColumn(db, "matches", "ReplaySummary"));
+	if (!hasJsonColumn)
+	{
+		// the table was created with the summary columns
+		return {};
+	}
+
+#define ADD_COLUMN(Type, Name, SqlType) "ALTER TABLE matches ADD COLUMN " #Name " " #SqlType ";"
+	static constexpr std::string_view addColumnsStmt = MATCH_SUMMARY_FIELDS(ADD_COLUMN);
+#undef ADD_COLUMN
+	if (!db.Execute(addColumnsStmt))
+	{
+		return PA_SQL_ERROR("Failed to add replay summary columns: {}", db.GetLastError());
+	}
+
+	// in chunks to not hold every summary in memory at once
+	SQLite::Statement selectStmt(db, "SELECT Id, ReplaySummary FROM matches "
+		"WHERE Id > :Id AND Analyzed AND ReplaySummary IS NOT NULL ORDER BY Id LIMIT 256");
+	SQLite::Statement updateStmt(db, "UPDATE matches SET " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_SUMMARY_FIELDS) " WHERE Id = :Id");
+	if (!selectStmt || !updateStmt)
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL migration statement: {}", db.GetLastError());
+	}
+
+	uint32_t lastId = 0;
+	while (true)
+	{
+		std::vector<std::pair<uint32_t, ReplaySummary>> rows;
+		selectStmt.Reset();
+		selectStmt.Bind(":Id", lastId);
+		while (!selectStmt.IsDone())
+		{
+			selectStmt.ExecuteStep();
+			if (selectStmt.HasRow())
+			{
+				const uint32_t id = ParseValue<uint32_t>(selectStmt, 0);
+				ReplaySummary replaySummary;
+				if (!FromJson(ParseValue<std::string>(selectStmt, 1), replaySummary))
+				{
+					LOG_WARN("Failed to parse replay summary of match {}, it is migrated empty", id);
+				}
+				rows.emplace_back(id, std::move(replaySummary));
+			}
+		}
+		if (selectStmt.HasFailed())
+		{
+			return PA_SQL_ERROR("Failed to perform replay summary migration: {}", db.GetLastError());
+		}
+
+		if (rows.empty())
+		{
+			break;
+		}
+
+		for (const auto& [id, replaySummary] : rows)
+		{
+			updateStmt.Reset();
+			updateStmt.Bind(":Id", id);
+#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, updateStmt, replaySummary.Name);
+			MATCH_SUMMARY_FIELDS(BIND_VALUES)
+#undef BIND_VALUES
+
+			updateStmt.ExecuteStep();
+			if (updateStmt.HasFailed())
+			{
+				return PA_SQL_ERROR("Failed to perform replay summary migration: {}", db.GetLastError());
+			}
+
+			PA_TRYV(WriteReplayAwards(db, id, replaySummary));
+		}
+		lastId = rows.back().first;
+	}
+
+	if (!db.Execute("ALTER TABLE matches DROP COLUMN ReplaySummary"))
+	{
+		return PA_SQL_ERROR("Failed to drop the ReplaySummary column: {}", db.GetLastError());
+	}
+
+	return {};
 }
 
 static inline SchemaInfo ParseSchemaInfo(const SQLite::Statement& stmt)
@@ -165,8 +586,40 @@ static inline SchemaInfo ParseSchemaInfo(const SQLite::Statement& stmt)
 
 }  // namespace
 
-DatabaseManager::DatabaseManager(SQLite& db) : m_db(db)
+MatchListEntry MatchListEntry::FromMatch(const Match& match)
 {
+#define COPY_FIELD(Type, Name, SqlType) .Name = match.Name,
+	return MatchListEntry{ .Id = match.Id, MATCH_LIST_FIELDS(COPY_FIELD) .ReplaySummary = match.ReplaySummary };
+#undef COPY_FIELD
+}
+
+DatabaseManager::DatabaseManager(SQLite& db) : m_db(db), m_sharedConnection(db.IsTemporary())
+{
+	// switching to WAL writes the header of a new database, after which auto vacuum can only change with a rebuild
+	// the rebuild of existing databases is left to the maintenance, so it does not delay the startup
+	SqlResult<bool> vacuum = EnableIncrementalVacuum(m_db);
+	if (!vacuum)
+	{
+		LOG_ERROR("Failed to enable incremental vacuum: {}", vacuum.error());
+	}
+	m_rebuildPending = vacuum.value_or(false);
+
+	// in WAL mode readers do not block the writer and commits only sync on checkpoints with synchronous = NORMAL
+	// the temp store stays on disk, the statement journals of the statistics triggers inside of the write savepoints
+	// get large on bulk writes and are a lot slower in memory
+	static constexpr std::string_view writerPragmas =
+		"PRAGMA journal_mode = WAL;"
+		"PRAGMA synchronous = NORMAL;"
+		"PRAGMA busy_timeout = 5000;"
+		"PRAGMA cache_size = -16384;"
+		"PRAGMA mmap_size = 268435456;"
+		"PRAGMA foreign_keys = ON;"
+		"PRAGMA analysis_limit = 1000;";
+	if (!m_db.Execute(writerPragmas))
+	{
+		LOG_ERROR("Failed to set database pragmas: {}", m_db.GetLastError());
+	}
+
 	SqlResult<void> create = CreateTables();
 	if (!create)
 	{
@@ -178,23 +631,224 @@ DatabaseManager::DatabaseManager(SQLite& db) : m_db(db)
 	{
 		LOG_ERROR("Failed to migrate tables: {}", migrate.error());
 	}
+
+	// the quick check reads the whole file, so it is the first job of the writer once no writes are queued
+	// the rest of the maintenance only starts after the idle delay
+	m_nextOptimize = std::chrono::steady_clock::now() + MaintenanceIdleDelay;
+	m_nextMaintenance = std::chrono::steady_clock::now();
+	m_writer = std::thread(&DatabaseManager::RunWriter, this);
 }
 
 DatabaseManager::~DatabaseManager()
 {
+	{
+		std::unique_lock lock(m_writeMutex);
+		m_stopWriter = true;
+	}
+	m_writeCondition.notify_one();
+	if (m_writer.joinable())
+	{
+		m_writer.join();
+	}
+
+	{
+		std::unique_lock lock(m_readerMutex);
+		m_readers.clear();
+	}
+
 	if (m_db)
 	{
-		if (!m_db.Execute("VACUUM"))
+		// free pages are given back by the maintenance, a full vacuum would rewrite the whole file on every exit
+		if (!m_db.Execute("PRAGMA optimize"))
 		{
-			LOG_ERROR("Failed to VACUUM database: {}", m_db.GetLastError());
+			LOG_ERROR("Failed to optimize database: {}", m_db.GetLastError());
 		}
 		m_db.Close();
 	}
 }
 
+DatabaseManager::Reader::~Reader()
+{
+	if (m_dbm && m_db)
+	{
+		std::unique_lock lock(m_dbm->m_readerMutex);
+		m_dbm->m_readers.emplace_back(std::move(m_db));
+	}
+}
+
+DatabaseManager::Reader DatabaseManager::AcquireReader() const
+{
+	if (m_sharedConnection)
+	{
+		return Reader(m_db, m_connectionMutex);
+	}
+
+	{
+		std::unique_lock lock(m_readerMutex);
+		if (!m_readers.empty())
+		{
+			SQLite db = std::move(m_readers.back());
+			m_readers.pop_back();
+			return Reader(*this, std::move(db));
+		}
+	}
+
+	static constexpr std::string_view readerPragmas =
+		"PRAGMA busy_timeout = 5000;"
+		"PRAGMA cache_size = -8192;"
+		"PRAGMA mmap_size = 268435456;";
+
+	SQLite db = SQLite::Open(m_db.GetPath(), SQLite::Flags::ReadOnly);
+	if (!db || !db.Execute(readerPragmas))
+	{
+		LOG_WARN("Failed to open read-only database connection, using the writer connection instead");
+		return Reader(m_db, m_connectionMutex);
+	}
+	return Reader(*this, std::move(db));
+}
+
+SqlResult<void> DatabaseManager::Write(std::function<SqlResult<void>()> func) const
+{
+	PA_METRIC_LATENCY("db.write");
+
+	// writes before the writer thread is started or from within another write are executed directly
+	if (!m_writer.joinable() || std::this_thread::get_id() == m_writer.get_id())
+	{
+		std::unique_lock lock(m_connectionMutex);
+		return Savepoint(func);
+	}
+
+	std::promise<SqlResult<void>> promise;
+	std::future<SqlResult<void>> future = promise.get_future();
+	{
+		std::unique_lock lock(m_writeMutex);
+		m_writeQueue.emplace_back(WriteJob{ std::move(func), std::move(promise) });
+		PA_METRIC_GAUGE_SET("db.write_queue", static_cast<int64_t>(m_writeQueue.size()));
+	}
+	m_writeCondition.notify_one();
+
+	return future.get();
+}
+
+void DatabaseManager::RunWriter()
+{
+	while (true)
+	{
+		std::vector<WriteJob> batch;
+		{
+			std::unique_lock lock(m_writeMutex);
+			const bool woken = m_writeCondition.wait_until(lock, m_nextMaintenance, [this]()
+			{
+				return m_stopWriter || !m_writeQueue.empty();
+			});
+
+			if (!woken)
+			{
+				lock.unlock();
+				std::unique_lock connectionLock(m_connectionMutex);
+				if (m_quickCheck == QuickCheck::Pending)
+				{
+					RunQuickCheck();
+					m_nextMaintenance = std::chrono::steady_clock::now() + MaintenanceIdleDelay;
+					continue;
+				}
+				const bool moreWork = RunMaintenance();
+				m_nextMaintenance = std::chrono::steady_clock::now() + (moreWork ? MaintenanceStepDelay : MaintenanceInterval);
+				continue;
+			}
+
+			if (m_writeQueue.empty())
+			{
+				return;
+			}
+
+			const auto end = m_writeQueue.begin() + static_cast<ptrdiff_t>(std::min(m_writeQueue.size(), MaxWriteBatchSize));
+			batch.reserve(static_cast<size_t>(end - m_writeQueue.begin()));
+			std::move(m_writeQueue.begin(), end, std::back_inserter(batch));
+			m_writeQueue.erase(m_writeQueue.begin(), end);
+			PA_METRIC_GAUGE_SET("db.write_queue", static_cast<int64_t>(m_writeQueue.size()));
+		}
+
+		std::unique_lock connectionLock(m_connectionMutex);
+
+		// every write gets its own savepoint, so a failing write does not roll back the rest of the batch
+		// without the transaction every savepoint is committed on its own
+		const bool transaction = m_db.Execute("BEGIN IMMEDIATE");
+		if (!transaction)
+		{
+			LOG_ERROR("Failed to begin write transaction: {}", m_db.GetLastError());
+		}
+
+		std::vector<SqlResult<void>> results;
+		results.reserve(batch.size());
+		for (WriteJob& job : batch)
+		{
+			results.emplace_back(Savepoint(job.Func));
+		}
+
+		if (transaction && !m_db.Execute("COMMIT"))
+		{
+			const std::string error = m_db.GetLastError();
+			m_db.Execute("ROLLBACK");
+			for (SqlResult<void>& result : results)
+			{
+				if (result)
+				{
+					result = PA_SQL_ERROR("Failed to commit write transaction: {}", error);
+				}
+			}
+		}
+
+		connectionLock.unlock();
+
+		PA_METRIC_COUNT("db.writes", batch.size());
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			batch[i].Result.set_value(std::move(results[i]));
+		}
+
+		if (m_quickCheck != QuickCheck::Pending)
+		{
+			m_nextMaintenance = std::max(m_nextMaintenance, std::chrono::steady_clock::now() + MaintenanceIdleDelay);
+		}
+	}
+}
+
+SqlResult<void> DatabaseManager::Savepoint(const std::function<SqlResult<void>()>& func) const
+{
+	// outside of a transaction the savepoint starts one, which is committed on release
+	const bool ownsTransaction = !m_db.InTransaction();
+	if (!m_db.Execute("SAVEPOINT write"))
+	{
+		return PA_SQL_ERROR("Failed to create savepoint: {}", m_db.GetLastError());
+	}
+
+	SqlResult<void> result = func();
+
+	if (!result)
+	{
+		m_db.Execute("ROLLBACK TO write");
+	}
+
+	if (!m_db.Execute("RELEASE write"))
+	{
+		const std::string error = m_db.GetLastError();
+		if (ownsTransaction && m_db.InTransaction())
+		{
+			m_db.Execute("ROLLBACK");
+		}
+		if (result)
+		{
+			return PA_SQL_ERROR("Failed to release savepoint: {}", error);
+		}
+	}
+
+	return result;
+}
+
 SqlResult<void> DatabaseManager::CreateTables() const
 {
-	static constexpr std::string_view matchesStmt = PA_DB_CREATE_TABLE_WITH_ID(matches, MATCH_FIELDS);
+	static constexpr std::string_view matchesStmt = PA_DB_CREATE_TABLE_WITH_ID(matches, MATCH_COLUMNS);
 	if (!m_db.Execute(matchesStmt))
 	{
 		return PA_SQL_ERROR("Failed to create matches table: {}", m_db.GetLastError());
@@ -206,6 +860,64 @@ SqlResult<void> DatabaseManager::CreateTables() const
 		return PA_SQL_ERROR("Failed to create schemaInfo table: {}", m_db.GetLastError());
 	}
 
+	// the match history is paged by date, replay analysis looks for non-analyzed matches
+	static constexpr std::string_view dateIndexStmt = "CREATE INDEX IF NOT EXISTS matches_Date_Id ON matches (Date DESC, Id DESC)";
+	if (!m_db.Execute(dateIndexStmt))
+	{
+		return PA_SQL_ERROR("Failed to create matches date index: {}", m_db.GetLastError());
+	}
+
+	static constexpr std::string_view analyzedIndexStmt = "CREATE INDEX IF NOT EXISTS matches_Analyzed ON matches (Analyzed)";
+	if (!m_db.Execute(analyzedIndexStmt))
+	{
+		return PA_SQL_ERROR("Failed to create matches analyzed index: {}", m_db.GetLastError());
+	}
+
+	// statistics are grouped by ship and map
+	static constexpr std::string_view shipIndexStmt = "CREATE INDEX IF NOT EXISTS matches_Ship ON matches (Ship)";
+	if (!m_db.Execute(shipIndexStmt))
+	{
+		return PA_SQL_ERROR("Failed to create matches ship index: {}", m_db.GetLastError());
+	}
+
+	static constexpr std::string_view mapIndexStmt = "CREATE INDEX IF NOT EXISTS matches_Map ON matches (Map)";
+	if (!m_db.Execute(mapIndexStmt))
+	{
+		return PA_SQL_ERROR("Failed to create matches map index: {}", m_db.GetLastError());
+	}
+
+	static constexpr std::string_view awardsStmt = "CREATE TABLE IF NOT EXISTS replayAwards ("
+		"MatchId INTEGER NOT NULL REFERENCES matches (Id) ON DELETE CASCADE, "
+		"Kind INTEGER NOT NULL, Type INTEGER NOT NULL, Count INTEGER NOT NULL, "
+		"PRIMARY KEY (MatchId, Kind, Type)) WITHOUT ROWID";
+	if (!m_db.Execute(awardsStmt))
+	{
+		return PA_SQL_ERROR("Failed to create replayAwards table: {}", m_db.GetLastError());
+	}
+
+	static constexpr std::string_view awardsIndexStmt = "CREATE INDEX IF NOT EXISTS replayAwards_Kind_Type ON replayAwards (Kind, Type)";
+	if (!m_db.Execute(awardsIndexStmt))
+	{
+		return PA_SQL_ERROR("Failed to create replayAwards index: {}", m_db.GetLastError());
+	}
+
+	// contentless, the text is only needed to find the matches and can always be extracted from their json again
+	// player names and clan tags contain underscores and dashes, which should not split them into multiple tokens
+	static constexpr std::string_view searchStmt = "CREATE VIRTUAL TABLE IF NOT EXISTS matchSearch USING fts5("
+		"Players, Clans, Ships, Map, content = '', contentless_delete = 1, prefix = '2 3', "
+		"tokenize = \"unicode61 remove_diacritics 2 tokenchars '_-'\")";
+	if (!m_db.Execute(searchStmt))
+	{
+		return PA_SQL_ERROR("Failed to create matchSearch table: {}", m_db.GetLastError());
+	}
+
+	static constexpr std::string_view searchDeleteStmt = "CREATE TRIGGER IF NOT EXISTS matches_search_delete AFTER DELETE ON matches "
+		"BEGIN DELETE FROM matchSearch WHERE rowid = OLD.Id; END";
+	if (!m_db.Execute(searchDeleteStmt))
+	{
+		return PA_SQL_ERROR("Failed to create matchSearch trigger: {}", m_db.GetLastError());
+	}
+
 	return {};
 }
 
@@ -223,10 +935,13 @@ SqlResult<void> DatabaseManager::MigrateTables() const
 		version = Version(ParseSchemaInfo(versionStmt).Version);
 	}
 
-	// backup old database before any migration
+	// backup old database before any migration, in-memory and temporary databases have no file to copy
 	const bool migrationNeeded = version != m_currentVersion;
-	if (migrationNeeded)
+	if (migrationNeeded && !m_sharedConnection)
 	{
+		// move everything from the WAL into the database file, otherwise the copy might be missing data
+		m_db.Execute("PRAGMA wal_checkpoint(TRUNCATE)");
+
 		std::filesystem::path dst = m_db.GetPath();
 		dst.replace_filename(fmt::format("{}_{}.{}", dst.filename(), version.ToString(), dst.extension()));
 		std::error_code ec;
@@ -237,356 +952,678 @@ SqlResult<void> DatabaseManager::MigrateTables() const
 		}
 	}
 
-	if (version < Version(1, 0))
-	{
-		// convert the time to YYYY-MM-DD HH:MM:SS
-		SQLite::Statement stmt(m_db, PA_DB_SELECT_WITH_ID(MATCH_FIELDS) " FROM matches WHERE Date LIKE '__.__.____ __:__:__'");
-		if (!stmt)
+	// everything after the backup runs in a single transaction, a failed migration leaves the database untouched
+	return Write([&]() -> SqlResult<void>
+	{
+		if (version < Version(1, 0))
+		{
+			// convert the time to YYYY-MM-DD HH:MM:SS, the dates are collected first to not modify the rows while iterating them
+			std::vector<std::pair<uint32_t, std::string>> dates;
+			SQLite::Statement selectStmt(m_db, "SELECT Id, Date FROM matches WHERE Date LIKE '__.__.____ __:__:__'");
+			if (!selectStmt)
+			{
+				return PA_SQL_ERROR("Failed to prepare SQL migration statement: {}", m_db.GetLastError());
+			}
+			while (!selectStmt.IsDone())
+			{
+				selectStmt.ExecuteStep();
+				if (selectStmt.HasRow())
+				{
+					const std::string date = ParseValue<std::string>(selectStmt, 1);
+					if (std::optional<Core::Time::TimePoint> tp = Core::Time::StrToTime(date, "%d.%m.%Y %H:%M:%S"))
+					{
+						dates.emplace_back(ParseValue<uint32_t>(selectStmt, 0), Core::Time::TimeToStr(*tp, "{:%Y-%m-%d %H:%M:%S}"));
+					}
+					else
+					{
+						return PA_SQL_ERROR("Failed to perform date migration");
+					}
+				}
+			}
+
+			SQLite::Statement updateStmt(m_db, "UPDATE matches SET Date = :Date WHERE Id = :Id");
+			if (!updateStmt)
+			{
+				return PA_SQL_ERROR("Failed to prepare SQL migration statement: {}", m_db.GetLastError());
+			}
+			for (const auto& [id, date] : dates)
+			{
+				updateStmt.Reset();
+				updateStmt.Bind(":Id", id);
+				updateStmt.Bind(":Date", date);
+
+				updateStmt.ExecuteStep();
+				if (updateStmt.HasFailed())
+				{
+					return PA_SQL_ERROR("Failed to perform date migration: {}", m_db.GetLastError());
+				}
+			}
+
+			// we have to delete all matches that are not of the supported format
+			if (!m_db.Execute("DELETE FROM matches WHERE Date NOT LIKE '____-__-__ __:__:__'"))
+			{
+				return PA_SQL_ERROR("Failed to delete matches with unsupported date: {}", m_db.GetLastError());
+			}
+		}
+
+		if (version < Version(1, 1))
+		{
+			// compress the server response and arena info, in chunks to not hold every match in memory at once
+			SQLite::Statement selectStmt(m_db, "SELECT Id, Json, ArenaInfo FROM matches "
+				"WHERE Id > :Id AND (typeof(Json) = 'text' OR typeof(ArenaInfo) = 'text') ORDER BY Id LIMIT 256");
+			SQLite::Statement updateStmt(m_db, "UPDATE matches SET Json = :Json, ArenaInfo = :ArenaInfo WHERE Id = :Id");
+			if (!selectStmt || !updateStmt)
+			{
+				return PA_SQL_ERROR("Failed to prepare SQL migration statement: {}", m_db.GetLastError());
+			}
+
+			uint32_t lastId = 0;
+			while (true)
+			{
+				std::vector<std::tuple<uint32_t, std::string, std::string>> rows;
+				selectStmt.Reset();
+				selectStmt.Bind(":Id", lastId);
+				while (!selectStmt.IsDone())
+				{
+					selectStmt.ExecuteStep();
+					if (selectStmt.HasRow())
+					{
+						rows.emplace_back(ParseValue<uint32_t>(selectStmt, 0), ParseCompressedText(selectStmt, 1), ParseCompressedText(selectStmt, 2));
+					}
+				}
+				if (selectStmt.HasFailed())
+				{
+					return PA_SQL_ERROR("Failed to perform compression migration: {}", m_db.GetLastError());
+				}
+
+				if (rows.empty())
+				{
+					break;
+				}
+
+				for (const auto& [id, json, arenaInfo] : rows)
+				{
+					updateStmt.Reset();
+					updateStmt.Bind(":Id", id);
+					BIND_COMPRESSED_VALUE(Json, updateStmt, json);
+					BIND_COMPRESSED_VALUE(ArenaInfo, updateStmt, arenaInfo);
+
+					updateStmt.ExecuteStep();
+					if (updateStmt.HasFailed())
+					{
+						return PA_SQL_ERROR("Failed to perform compression migration: {}", m_db.GetLastError());
+					}
+				}
+				lastId = std::get<0>(rows.back());
+			}
+		}
+
+		if (version < Version(1, 2))
+		{
+			PA_TRYV(MigrateReplaySummaries(m_db));
+		}
+
+		if (version < Version(1, 3))
 		{
-			return PA_SQL_ERROR("Failed to prepare SQL migration statement: {}", m_db.GetLastError());
+			// the triggers depend on the replay summary columns, which older schemas only have after the previous migration
+			PA_TRYV(CreateStatisticsTables(m_db));
+			PA_TRYV(RebuildStatistics(m_db));
 		}
-		while (!stmt.IsDone())
+
+		if (version < Version(1, 4))
 		{
-			stmt.ExecuteStep();
-			if (stmt.HasRow())
+			// index the matches stored before the search index existed, in chunks to not hold every json in memory at once
+			SQLite::Statement selectStmt(m_db, "SELECT Id, Map, Json FROM matches WHERE Id > :Id ORDER BY Id LIMIT 256");
+			if (!selectStmt)
+			{
+				return PA_SQL_ERROR("Failed to prepare SQL migration statement: {}", m_db.GetLastError());
+			}
+
+			uint32_t lastId = 0;
+			while (true)
 			{
-				Match match = ParseMatch(stmt);
-				if (std::optional<Core::Time::TimePoint> tp = Core::Time::StrToTime(match.Date, "%d.%m.%Y %H:%M:%S"))
+				std::vector<std::tuple<uint32_t, std::string, std::string>> rows;
+				selectStmt.Reset();
+				selectStmt.Bind(":Id", lastId);
+				while (!selectStmt.IsDone())
+				{
+					selectStmt.ExecuteStep();
+					if (selectStmt.HasRow())
+					{
+						rows.emplace_back(ParseValue<uint32_t>(selectStmt, 0), ParseValue<std::string>(selectStmt, 1), ParseCompressedText(selectStmt, 2));
+					}
+				}
+				if (selectStmt.HasFailed())
 				{
-					match.Date = Core::Time::TimeToStr(*tp, "{:%Y-%m-%d %H:%M:%S}");
-					PA_TRYV(UpdateMatch(match.Id, match));
+					return PA_SQL_ERROR("Failed to perform search index migration: {}", m_db.GetLastError());
 				}
-				else
+
+				if (rows.empty())
+				{
+					break;
+				}
+
+				for (const auto& [id, map, json] : rows)
 				{
-					return PA_SQL_ERROR("Failed to perform date migration");
+					PA_TRYV(WriteMatchSearch(m_db, id, map, json));
 				}
+				lastId = std::get<0>(rows.back());
+			}
+		}
+
+		// set current version
+		if (migrationNeeded)
+		{
+			SQLite::Statement schemaInsertStmt(m_db, "INSERT OR REPLACE INTO schemaInfo (" PA_DB_COLUMNS_WITH_ID(SCHEMAINFO_FIELDS) ") VALUES (1, ?)");
+			const std::string versionString = m_currentVersion.ToString(".", false);
+			if (!schemaInsertStmt || !schemaInsertStmt.Bind(1, versionString))
+			{
+				return PA_SQL_ERROR("Failed to prepare schemaInfo statement: {}", m_db.GetLastError());
+			}
+			schemaInsertStmt.ExecuteStep();
+			if (schemaInsertStmt.HasFailed())
+			{
+				return PA_SQL_ERROR("{}", m_db.GetLastError());
 			}
 		}
 
-		// we have to delete all matches that are not of the supported format
-		SQLite::Statement checkStmt(m_db, "SELECT Id FROM matches WHERE Date NOT LIKE '____-__-__ __:__:__'");
-		if (!checkStmt)
+		return {};
+	});
+}
+
+SqlResult<void> DatabaseManager::AddMatch(Match& match) const
+{
+	return AddMatches(std::span(&match, 1));
+}
+
+SqlResult<void> DatabaseManager::AddMatches(std::span<Match> matches) const
+{
+	PA_PROFILE_FUNCTION();
+
+	return Write([&]() -> SqlResult<void>
+	{
+		static constexpr std::string_view insertQuery = "INSERT INTO matches ("
+			PA_DB_COLUMNS(MATCH_COLUMNS) ") VALUES (" PA_DB_COLUMNS_VALUES(MATCH_COLUMNS) ")";
+
+		SQLite::CachedStatement stmt = m_db.Prepare(insertQuery);
+
+		if (!stmt)
 		{
-			return PA_SQL_ERROR("Failed to prepare SQL migration statement: {}", m_db.GetLastError());
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
 		}
-		while (!checkStmt.IsDone())
+
+		for (Match& match : matches)
 		{
-			checkStmt.ExecuteStep();
-			if (checkStmt.HasRow())
+			stmt->Reset();
+
+#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, *stmt, match.Name);
+#define BIND_COMPRESSED_VALUES(Type, Name, SqlType) BIND_COMPRESSED_VALUE(Name, *stmt, match.Name);
+			MATCH_INFO_FIELDS(BIND_VALUES)
+			MATCH_BLOB_FIELDS(BIND_COMPRESSED_VALUES)
+			MATCH_STATE_FIELDS(BIND_VALUES)
+#undef BIND_COMPRESSED_VALUES
+#undef BIND_VALUES
+
+			if (match.Analyzed)
 			{
-				int32_t id;
-				if (checkStmt.GetInt(0, id))
-				{
-					PA_TRYV(DeleteMatch(static_cast<uint32_t>(id)));
-				}
+#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, *stmt, match.ReplaySummary.Name);
+				MATCH_SUMMARY_FIELDS(BIND_VALUES)
+#undef BIND_VALUES
+			}
+
+			stmt->ExecuteStep();
+			if (stmt->HasFailed())
+			{
+				return PA_SQL_ERROR("Failed to add match '{}': {}", match.Hash, m_db.GetLastError());
+			}
+
+			match.Id = static_cast<uint32_t>(m_db.GetLastRowId());
+			if (match.Analyzed)
+			{
+				PA_TRYV(WriteReplayAwards(m_db, match.Id, match.ReplaySummary));
 			}
+			PA_TRYV(WriteMatchSearch(m_db, match.Id, match.Map, match.Json));
 		}
-	}
 
-	// set current version
-	if (migrationNeeded)
+		return {};
+	});
+}
+
+SqlResult<void> DatabaseManager::DeleteMatch(std::string_view hash) const
+{
+	return Write([&]() -> SqlResult<void>
 	{
-		SQLite::Statement schemaInsertStmt(m_db, "INSERT OR REPLACE INTO schemaInfo (" PA_DB_COLUMNS_WITH_ID(SCHEMAINFO_FIELDS) ") VALUES (1, ?)");
-		const std::string versionString = m_currentVersion.ToString(".", false);
-		if (!schemaInsertStmt || !schemaInsertStmt.Bind(1, versionString))
+		static constexpr std::string_view deleteQuery = "DELETE FROM matches WHERE Hash = :Hash";
+
+		SQLite::CachedStatement stmt = m_db.Prepare(deleteQuery);
+
+		if (!stmt)
 		{
-			return PA_SQL_ERROR("Failed to prepare schemaInfo statement: {}", m_db.GetLastError());
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
 		}
-		schemaInsertStmt.ExecuteStep();
-		if (!schemaInsertStmt.IsDone())
+
+		stmt->Bind(":Hash", hash);
+
+		stmt->ExecuteStep();
+		if (!stmt->IsDone())
 		{
 			return PA_SQL_ERROR("{}", m_db.GetLastError());
 		}
-	}
 
-	return {};
+		return {};
+	});
 }
 
-SqlResult<void> DatabaseManager::AddMatch(Match& match) const
+SqlResult<void> DatabaseManager::DeleteMatch(uint32_t id) const
 {
-	static constexpr std::string_view insertQuery = "INSERT INTO matches ("
-		PA_DB_COLUMNS(MATCH_FIELDS) ") VALUES (" PA_DB_COLUMNS_VALUES(MATCH_FIELDS) ")";
+	return DeleteMatches(std::span(&id, 1));
+}
 
-	SQLite::Statement stmt(m_db, insertQuery);
+SqlResult<void> DatabaseManager::DeleteMatches(std::span<const uint32_t> ids) const
+{
+	PA_PROFILE_FUNCTION();
 
-	if (!stmt)
+	return Write([&]() -> SqlResult<void>
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
-	}
+		static constexpr std::string_view deleteQuery = "DELETE FROM matches WHERE Id = :Id";
 
-#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, stmt, match.Name);
-	MATCH_FIELDS(BIND_VALUES)
-#undef BIND_VALUES
+		SQLite::CachedStatement stmt = m_db.Prepare(deleteQuery);
 
-	stmt.ExecuteStep();
-	if (!stmt.IsDone())
-	{
-		return PA_SQL_ERROR("{}", m_db.GetLastError());
-	}
+		if (!stmt)
+		{
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		}
 
-	match.Id = static_cast<uint32_t>(m_db.GetLastRowId());
+		for (const uint32_t id : ids)
+		{
+			stmt->Reset();
+			stmt->Bind(":Id", id);
 
-	return {};
+			stmt->ExecuteStep();
+			if (stmt->HasFailed())
+			{
+				return PA_SQL_ERROR("Failed to delete match {}: {}", id, m_db.GetLastError());
+			}
+		}
+
+		return {};
+	});
 }
 
-SqlResult<void> DatabaseManager::DeleteMatch(std::string_view hash) const
+SqlResult<std::optional<Match>> DatabaseManager::GetMatch(std::string_view hash) const
 {
-	static constexpr std::string_view deleteQuery = "DELETE FROM matches WHERE Hash = :Hash";
+	static constexpr std::string_view selectQuery =
+			PA_DB_SELECT_WITH_ID(MATCH_COLUMNS) " FROM matches WHERE Hash = :Hash";
 
-	SQLite::Statement stmt(m_db, deleteQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
 
-	stmt.Bind(":Hash", hash);
+	stmt->Bind(":Hash", hash);
 
-	stmt.ExecuteStep();
-	if (!stmt.IsDone())
+	stmt->ExecuteStep();
+	if (stmt->HasRow())
 	{
-		return PA_SQL_ERROR("{}", m_db.GetLastError());
+		return ReadMatch(*db, *stmt);
 	}
 
 	return {};
 }
 
-SqlResult<void> DatabaseManager::DeleteMatch(uint32_t id) const
+SqlResult<std::optional<Match>> DatabaseManager::GetMatch(uint32_t id) const
 {
-	static constexpr std::string_view deleteQuery = "DELETE FROM matches WHERE Id = :Id";
+	static constexpr std::string_view selectQuery =
+			PA_DB_SELECT_WITH_ID(MATCH_COLUMNS) " FROM matches WHERE Id = :Id";
 
-	SQLite::Statement stmt(m_db, deleteQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
 
-	stmt.Bind(":Id", id);
+	stmt->Bind(":Id", id);
 
-	stmt.ExecuteStep();
-	if (!stmt.IsDone())
+	stmt->ExecuteStep();
+	if (stmt->HasRow())
 	{
-		return PA_SQL_ERROR("{}", m_db.GetLastError());
+		return ReadMatch(*db, *stmt);
 	}
 
 	return {};
 }
 
-SqlResult<void> DatabaseManager::DeleteMatches(std::span<uint32_t> ids) const
+SqlResult<std::vector<Match>> DatabaseManager::GetMatches() const
 {
-	std::stringstream ss;
-	std::ranges::copy(ids, std::ostream_iterator<int>(ss, ", "));
-	const std::string idString = ss.str();
-	const std::string x = idString.substr(0, idString.size() - 2);
-	const std::string deleteQuery = fmt::format("DELETE FROM matches WHERE Id IN ({})", x);
+	PA_PROFILE_FUNCTION();
+
+	std::vector<Match> matches;
 
-	SQLite::Statement stmt(m_db, deleteQuery);
+	static constexpr std::string_view selectQuery =
+			PA_DB_SELECT_WITH_ID(MATCH_COLUMNS) " FROM matches ORDER BY Date DESC";
+
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
 
-	stmt.ExecuteStep();
-	if (!stmt.IsDone())
+	while (!stmt->IsDone())
 	{
-		return PA_SQL_ERROR("{}", m_db.GetLastError());
+		stmt->ExecuteStep();
+		if (stmt->HasRow())
+		{
+			PA_TRY(match, ReadMatch(*db, *stmt));
+			matches.emplace_back(std::move(match));
+		}
 	}
 
-	return {};
+	return matches;
 }
 
-SqlResult<std::optional<Match>> DatabaseManager::GetMatch(std::string_view hash) const
+SqlResult<std::vector<MatchListEntry>> DatabaseManager::GetMatchList(const MatchListFilter& filter, size_t limit, const std::optional<MatchListCursor>& after) const
 {
-	static constexpr std::string_view selectQuery =
-			PA_DB_SELECT_WITH_ID(MATCH_FIELDS) " FROM matches WHERE Hash = :Hash";
+	PA_PROFILE_FUNCTION();
+
+	std::string where;
+	std::vector<std::string_view> values;
+	AppendFilter(filter, where, values);
+	if (after)
+	{
+		where += where.empty() ? " WHERE " : " AND ";
+		where += "(Date, Id) < (?, ?)";
+	}
+
+	// the query only depends on the shape of the filter, so paging through results hits the statement cache
+	const std::string selectQuery = fmt::format(
+			PA_DB_SELECT_WITH_ID(MATCH_LIST_COLUMNS) " FROM matches{} ORDER BY Date DESC, Id DESC LIMIT ?", where);
 
-	SQLite::Statement stmt(m_db, selectQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
 
-	stmt.Bind(":Hash", hash);
+	int index = 1;
+	for (std::string_view value : values)
+	{
+		stmt->Bind(index++, value);
+	}
+	if (after)
+	{
+		stmt->Bind(index++, std::string_view(after->Date));
+		stmt->Bind(index++, after->Id);
+	}
+	stmt->Bind(index, static_cast<int32_t>(std::min<size_t>(limit, std::numeric_limits<int32_t>::max())));
 
-	stmt.ExecuteStep();
-	if (stmt.HasRow())
+	std::vector<MatchListEntry> entries;
+	entries.reserve(std::min<size_t>(limit, 1024));
+	while (!stmt->IsDone())
 	{
-		return ParseMatch(stmt);
+		stmt->ExecuteStep();
+		if (stmt->HasRow())
+		{
+			entries.emplace_back(ParseMatchListEntry(*stmt));
+		}
 	}
 
-	return {};
+	if (stmt->HasFailed())
+	{
+		return PA_SQL_ERROR("Failed to get match list: {}", db->GetLastError());
+	}
+	return entries;
 }
 
-SqlResult<std::optional<Match>> DatabaseManager::GetMatch(uint32_t id) const
+SqlResult<std::vector<MatchListEntry>> DatabaseManager::SearchMatches(std::string_view query, size_t limit, const std::optional<MatchListCursor>& after) const
 {
+	PA_PROFILE_FUNCTION();
+
+	const std::string search = ToSearchQuery(query);
+	if (search.empty())
+	{
+		return std::vector<MatchListEntry>{};
+	}
+
 	static constexpr std::string_view selectQuery =
-			PA_DB_SELECT_WITH_ID(MATCH_FIELDS) " FROM matches WHERE Id = :Id";
+			PA_DB_SELECT_WITH_ID(MATCH_LIST_COLUMNS) " FROM matches WHERE Id IN (SELECT rowid FROM matchSearch WHERE matchSearch MATCH :Query) "
+			"ORDER BY Date DESC, Id DESC LIMIT :Limit";
+	static constexpr std::string_view selectAfterQuery =
+			PA_DB_SELECT_WITH_ID(MATCH_LIST_COLUMNS) " FROM matches WHERE Id IN (SELECT rowid FROM matchSearch WHERE matchSearch MATCH :Query) "
+			"AND (Date, Id) < (:Date, :Id) ORDER BY Date DESC, Id DESC LIMIT :Limit";
 
-	SQLite::Statement stmt(m_db, selectQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(after ? selectAfterQuery : selectQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
 
-	stmt.Bind(":Id", id);
+	stmt->Bind(":Query", search);
+	if (after)
+	{
+		stmt->Bind(":Date", std::string_view(after->Date));
+		stmt->Bind(":Id", after->Id);
+	}
+	stmt->Bind(":Limit", static_cast<int32_t>(std::min<size_t>(limit, std::numeric_limits<int32_t>::max())));
 
-	stmt.ExecuteStep();
-	if (stmt.HasRow())
+	std::vector<MatchListEntry> entries;
+	entries.reserve(std::min<size_t>(limit, 1024));
+	while (!stmt->IsDone())
 	{
-		return ParseMatch(stmt);
+		stmt->ExecuteStep();
+		if (stmt->HasRow())
+		{
+			entries.emplace_back(ParseMatchListEntry(*stmt));
+		}
 	}
 
-	return {};
+	if (stmt->HasFailed())
+	{
+		return PA_SQL_ERROR("Failed to search matches: {}", db->GetLastError());
+	}
+	return entries;
 }
 
-SqlResult<std::vector<Match>> DatabaseManager::GetMatches() const
+SqlResult<size_t> DatabaseManager::GetMatchCount(const MatchListFilter& filter) const
 {
-	PA_PROFILE_FUNCTION();
+	std::string where;
+	std::vector<std::string_view> values;
+	AppendFilter(filter, where, values);
 
-	std::vector<Match> matches;
-
-	static constexpr std::string_view selectQuery =
-			PA_DB_SELECT_WITH_ID(MATCH_FIELDS) " FROM matches ORDER BY Date DESC";
+	const std::string countQuery = fmt::format("SELECT COUNT(*) FROM matches{}", where);
 
-	SQLite::Statement stmt(m_db, selectQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(countQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
 
-	while (!stmt.IsDone())
+	int index = 1;
+	for (std::string_view value : values)
 	{
-		stmt.ExecuteStep();
-		if (stmt.HasRow())
-		{
-			matches.emplace_back(ParseMatch(stmt));
-		}
+		stmt->Bind(index++, value);
 	}
 
-	return matches;
+	stmt->ExecuteStep();
+	if (int64_t count; stmt->HasRow() && stmt->GetInt64(0, count))
+	{
+		return static_cast<size_t>(count);
+	}
+	return PA_SQL_ERROR("Failed to count matches: {}", db->GetLastError());
 }
 
 SqlResult<void> DatabaseManager::UpdateMatch(uint32_t id, const Match& match) const
 {
-	static constexpr std::string_view updateStatement = "UPDATE matches SET " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_FIELDS) " WHERE Id = :Id";
+	return Write([&]() -> SqlResult<void>
+	{
+		static constexpr std::string_view updateStatement = "UPDATE matches SET " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_COLUMNS) " WHERE Id = :Id";
 
-	SQLite::Statement stmt(m_db, updateStatement);
+		SQLite::CachedStatement stmt = m_db.Prepare(updateStatement);
 
-	if (!stmt)
-	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
-	}
+		if (!stmt)
+		{
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		}
 
-	stmt.Bind(":Id", id);
-#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, stmt, match.Name);
-	MATCH_FIELDS(BIND_VALUES)
+		stmt->Bind(":Id", id);
+#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, *stmt, match.Name);
+#define BIND_COMPRESSED_VALUES(Type, Name, SqlType) BIND_COMPRESSED_VALUE(Name, *stmt, match.Name);
+		MATCH_INFO_FIELDS(BIND_VALUES)
+		MATCH_BLOB_FIELDS(BIND_COMPRESSED_VALUES)
+		MATCH_STATE_FIELDS(BIND_VALUES)
+#undef BIND_COMPRESSED_VALUES
 #undef BIND_VALUES
 
-	stmt.ExecuteStep();
-	if (!stmt.IsDone())
-	{
-		return PA_SQL_ERROR("{}", m_db.GetLastError());
-	}
+		if (match.Analyzed)
+		{
+#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, *stmt, match.ReplaySummary.Name);
+			MATCH_SUMMARY_FIELDS(BIND_VALUES)
+#undef BIND_VALUES
+		}
 
-	return {};
+		stmt->ExecuteStep();
+		if (stmt->HasFailed())
+		{
+			return PA_SQL_ERROR("{}", m_db.GetLastError());
+		}
+
+		PA_TRYV(WriteMatchSearch(m_db, id, match.Map, match.Json));
+		return WriteReplayAwards(m_db, id, match.Analyzed ? match.ReplaySummary : ReplaySummary{});
+	});
 }
 
 SqlResult<void> DatabaseManager::UpdateMatch(std::string_view hash, const Match& match) const
 {
-	static constexpr std::string_view updateStatement = "UPDATE matches SET " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_FIELDS) " WHERE Hash = :Hash";
+	return Write([&]() -> SqlResult<void>
+	{
+		static constexpr std::string_view updateStatement = "UPDATE matches SET " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_COLUMNS) " WHERE Hash = :Hash RETURNING Id";
 
-	SQLite::Statement stmt(m_db, updateStatement);
+		SQLite::CachedStatement stmt = m_db.Prepare(updateStatement);
 
-	if (!stmt)
-	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
-	}
+		if (!stmt)
+		{
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		}
 
-	stmt.Bind(":Hash", hash);
-#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, stmt, match.Name);
-	MATCH_FIELDS(BIND_VALUES)
+		stmt->Bind(":Hash", hash);
+#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, *stmt, match.Name);
+#define BIND_COMPRESSED_VALUES(Type, Name, SqlType) BIND_COMPRESSED_VALUE(Name, *stmt, match.Name);
+		MATCH_INFO_FIELDS(BIND_VALUES)
+		MATCH_BLOB_FIELDS(BIND_COMPRESSED_VALUES)
+		MATCH_STATE_FIELDS(BIND_VALUES)
+#undef BIND_COMPRESSED_VALUES
 #undef BIND_VALUES
 
-	stmt.ExecuteStep();
-	if (!stmt.IsDone())
-	{
-		return PA_SQL_ERROR("{}", m_db.GetLastError());
-	}
+		if (match.Analyzed)
+		{
+#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, *stmt, match.ReplaySummary.Name);
+			MATCH_SUMMARY_FIELDS(BIND_VALUES)
+#undef BIND_VALUES
+		}
 
-	return {};
+		stmt->ExecuteStep();
+		if (stmt->HasFailed())
+		{
+			return PA_SQL_ERROR("{}", m_db.GetLastError());
+		}
+
+		if (!stmt->HasRow())
+		{
+			return {};
+		}
+		const uint32_t id = ParseValue<uint32_t>(*stmt, 0);
+
+		PA_TRYV(WriteMatchSearch(m_db, id, match.Map, match.Json));
+		return WriteReplayAwards(m_db, id, match.Analyzed ? match.ReplaySummary : ReplaySummary{});
+	});
 }
 
 SqlResult<void> DatabaseManager::SetMatchNonAnalyzed(uint32_t id) const
 {
-	static constexpr std::string_view updateStatement = "UPDATE matches SET Analyzed = false WHERE Id = :Id";
+	return Write([&]() -> SqlResult<void>
+	{
+		static constexpr std::string_view updateStatement = "UPDATE matches SET Analyzed = false WHERE Id = :Id";
 
-	SQLite::Statement stmt(m_db, updateStatement);
+		SQLite::CachedStatement stmt = m_db.Prepare(updateStatement);
 
-	if (!stmt)
-	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
-	}
+		if (!stmt)
+		{
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		}
 
-	stmt.Bind(":Id", id);
+		stmt->Bind(":Id", id);
 
-	stmt.ExecuteStep();
-	if (!stmt.IsDone())
-	{
-		return PA_SQL_ERROR("{}", m_db.GetLastError());
-	}
+		stmt->ExecuteStep();
+		if (!stmt->IsDone())
+		{
+			return PA_SQL_ERROR("{}", m_db.GetLastError());
+		}
 
-	return {};
+		return {};
+	});
 }
 
 SqlResult<void> DatabaseManager::SetMatchNonAnalyzed(std::string_view hash) const
 {
-	static constexpr std::string_view updateStatement = "UPDATE matches SET Analyzed = false WHERE Hash = :Hash";
+	return Write([&]() -> SqlResult<void>
+	{
+		static constexpr std::string_view updateStatement = "UPDATE matches SET Analyzed = false WHERE Hash = :Hash";
 
-	SQLite::Statement stmt(m_db, updateStatement);
+		SQLite::CachedStatement stmt = m_db.Prepare(updateStatement);
 
-	if (!stmt)
-	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
-	}
+		if (!stmt)
+		{
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		}
 
-	stmt.Bind(":Hash", hash);
+		stmt->Bind(":Hash", hash);
 
-	stmt.ExecuteStep();
-	if (!stmt.IsDone())
-	{
-		return PA_SQL_ERROR("{}", m_db.GetLastError());
-	}
+		stmt->ExecuteStep();
+		if (!stmt->IsDone())
+		{
+			return PA_SQL_ERROR("{}", m_db.GetLastError());
+		}
 
-	return {};
+		return {};
+	});
 }
 
 SqlResult<std::vector<NonAnalyzedMatch>> DatabaseManager::GetNonAnalyzedMatches() const
 {
 	std::vector<NonAnalyzedMatch> matches;
 
-	static constexpr std::string_view selectQuery = "SELECT Hash, ReplayName FROM matches WHERE Analyzed = false";
+	static constexpr std::string_view selectQuery = "SELECT Id, Hash, ReplayName FROM matches WHERE Analyzed = false";
 
-	SQLite::Statement stmt(m_db, selectQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
 
-	while (!stmt.IsDone())
+	while (!stmt->IsDone())
 	{
-		stmt.ExecuteStep();
-		if (stmt.HasRow())
+		stmt->ExecuteStep();
+		if (stmt->HasRow())
 		{
 			matches.emplace_back(NonAnalyzedMatch
 			{
-				ParseValue<std::string>(stmt, 0),
-				ParseValue<std::string>(stmt, 1)
+				ParseValue<uint32_t>(*stmt, 0),
+				ParseValue<std::string>(*stmt, 1),
+				ParseValue<std::string>(*stmt, 2)
 			});
 		}
 	}
@@ -596,19 +1633,20 @@ SqlResult<std::vector<NonAnalyzedMatch>> DatabaseManager::GetNonAnalyzedMatches(
 
 SqlResult<std::optional<Match>> DatabaseManager::GetLatestMatch() const
 {
-	static constexpr std::string_view selectQuery = PA_DB_SELECT_WITH_ID(MATCH_FIELDS) " FROM matches ORDER BY Id DESC LIMIT 1";
+	static constexpr std::string_view selectQuery = PA_DB_SELECT_WITH_ID(MATCH_COLUMNS) " FROM matches ORDER BY Id DESC LIMIT 1";
 
-	SQLite::Statement stmt(m_db, selectQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
 
-	stmt.ExecuteStep();
-	if (stmt.HasRow())
+	stmt->ExecuteStep();
+	if (stmt->HasRow())
 	{
-		return ParseMatch(stmt);
+		return ReadMatch(*db, *stmt);
 	}
 	return std::nullopt;
 }
@@ -617,24 +1655,20 @@ SqlResult<std::optional<std::string>> DatabaseManager::GetMatchJson(uint32_t id)
 {
 	static constexpr std::string_view selectQuery = "SELECT Json FROM matches WHERE Id = :Id";
 
-	SQLite::Statement stmt(m_db, selectQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
 
-	stmt.Bind(":Id", id);
+	stmt->Bind(":Id", id);
 
-	stmt.ExecuteStep();
-	if (stmt.HasRow())
+	stmt->ExecuteStep();
+	if (stmt->HasRow())
 	{
-		std::string json;
-		if (stmt.GetText(0, json))
-		{
-			return json;
-		}
-		return PA_SQL_ERROR("Failed to get json column as string");
+		return ParseCompressedText(*stmt, 0);
 	}
 
 	return {};
@@ -644,113 +1678,163 @@ SqlResult<std::optional<std::string>> DatabaseManager::GetMatchJson(std::string_
 {
 	static constexpr std::string_view selectQuery = "SELECT Json FROM matches WHERE Hash = :Hash";
 
-	SQLite::Statement stmt(m_db, selectQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
 
-	stmt.Bind(":Hash", hash);
+	stmt->Bind(":Hash", hash);
 
-	stmt.ExecuteStep();
-	if (stmt.HasRow())
+	stmt->ExecuteStep();
+	if (stmt->HasRow())
 	{
-		std::string json;
-		if (stmt.GetText(0, json))
-		{
-			return json;
-		}
-		return PA_SQL_ERROR("Failed to get json column as string");
+		return ParseCompressedText(*stmt, 0);
 	}
 
 	return {};
 }
 
-SqlResult<void> DatabaseManager::SetMatchReplaySummary(uint32_t id, const ReplaySummary& replaySummary) const
+SqlResult<std::optional<ReplaySummary>> DatabaseManager::GetReplaySummary(uint32_t id) const
 {
-	static constexpr std::string_view updateStatement = "UPDATE matches SET Analyzed = TRUE, ReplaySummary = :ReplaySummary WHERE Id = :Id";
+	static constexpr std::string_view selectQuery =
+			"SELECT Hash, Analyzed, " PA_DB_COLUMNS(MATCH_SUMMARY_FIELDS) " FROM matches WHERE Id = :Id";
 
-	SQLite::Statement stmt(m_db, updateStatement);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
-	stmt.Bind(":Id", id);
 
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer writer(buffer);
-	PA_TRYV(ToJson(writer, replaySummary));
-	stmt.Bind(":ReplaySummary", buffer.GetString());
+	stmt->Bind(":Id", id);
 
-	stmt.ExecuteStep();
-	if (!stmt.IsDone())
+	stmt->ExecuteStep();
+	if (!stmt->HasRow() || !ParseValue<bool>(*stmt, 1))
 	{
-		return PA_SQL_ERROR("Failed to set ReplaySummary: {}", m_db.GetLastError());
+		return std::nullopt;
 	}
 
-	return {};
+	ReplaySummary replaySummary = ParseReplaySummary(*stmt, 2, ParseValue<std::string>(*stmt, 0), true);
+	PA_TRYV(ReadReplayAwards(*db, id, replaySummary));
+	return replaySummary;
+}
+
+SqlResult<void> DatabaseManager::SetMatchReplaySummary(uint32_t id, const ReplaySummary& replaySummary) const
+{
+	return Write([&]() -> SqlResult<void>
+	{
+		static constexpr std::string_view updateStatement =
+				"UPDATE matches SET Analyzed = TRUE, " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_SUMMARY_FIELDS) " WHERE Id = :Id";
+
+		SQLite::CachedStatement stmt = m_db.Prepare(updateStatement);
+
+		if (!stmt)
+		{
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		}
+
+		stmt->Bind(":Id", id);
+#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, *stmt, replaySummary.Name);
+		MATCH_SUMMARY_FIELDS(BIND_VALUES)
+#undef BIND_VALUES
+
+		stmt->ExecuteStep();
+		if (stmt->HasFailed())
+		{
+			return PA_SQL_ERROR("Failed to set ReplaySummary: {}", m_db.GetLastError());
+		}
+
+		return WriteReplayAwards(m_db, id, replaySummary);
+	});
 }
 
 SqlResult<void> DatabaseManager::SetMatchReplaySummary(std::string_view hash, const ReplaySummary& replaySummary) const
 {
-	static constexpr std::string_view updateStatement = "UPDATE matches SET Analyzed = TRUE, ReplaySummary = :ReplaySummary WHERE Hash = :Hash";
+	// the bulk update looks the match up by the hash of the summary
+	ReplaySummary summary = replaySummary;
+	summary.Hash = hash;
+	return SetMatchReplaySummaries(std::span(&summary, 1));
+}
 
-	SQLite::Statement stmt(m_db, updateStatement);
+SqlResult<void> DatabaseManager::SetMatchReplaySummaries(std::span<const ReplaySummary> replaySummaries) const
+{
+	PA_PROFILE_FUNCTION();
 
-	if (!stmt)
+	return Write([&]() -> SqlResult<void>
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
-	}
-	stmt.Bind(":Hash", hash);
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer writer(buffer);
-	PA_TRYV(ToJson(writer, replaySummary));
-	stmt.Bind(":ReplaySummary", buffer.GetString());
+		static constexpr std::string_view updateStatement =
+				"UPDATE matches SET Analyzed = TRUE, " PA_DB_COLUMNS_VALUES_UPDATE(MATCH_SUMMARY_FIELDS) " WHERE Hash = :Hash RETURNING Id";
 
-	stmt.ExecuteStep();
-	if (!stmt.IsDone())
-	{
-		return PA_SQL_ERROR("Failed to set ReplaySummary: {}", m_db.GetLastError());
-	}
+		SQLite::CachedStatement stmt = m_db.Prepare(updateStatement);
 
-	return {};
+		if (!stmt)
+		{
+			return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		}
+
+		for (const ReplaySummary& replaySummary : replaySummaries)
+		{
+			stmt->Reset();
+			stmt->Bind(":Hash", replaySummary.Hash);
+#define BIND_VALUES(Type, Name, SqlType) BIND_VALUE(Name, *stmt, replaySummary.Name);
+			MATCH_SUMMARY_FIELDS(BIND_VALUES)
+#undef BIND_VALUES
+
+			stmt->ExecuteStep();
+			if (stmt->HasFailed())
+			{
+				return PA_SQL_ERROR("Failed to set ReplaySummary of match '{}': {}", replaySummary.Hash, m_db.GetLastError());
+			}
+
+			if (stmt->HasRow())
+			{
+				PA_TRYV(WriteReplayAwards(m_db, ParseValue<uint32_t>(*stmt, 0), replaySummary));
+			}
+		}
+
+		return {};
+	});
 }
 
 SqlResult<bool> DatabaseManager::MatchExists(uint32_t id) const
 {
 	static constexpr std::string_view existsQuery = "SELECT 1 FROM matches WHERE Id = :Id";
 
-	SQLite::Statement stmt(m_db, existsQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(existsQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
-	stmt.Bind(":Id", id);
+	stmt->Bind(":Id", id);
 
-	stmt.ExecuteStep();
-	return stmt.HasRow();
+	stmt->ExecuteStep();
+	return stmt->HasRow();
 }
 
 SqlResult<bool> DatabaseManager::MatchExists(std::string_view hash) const
 {
 	static constexpr std::string_view existsQuery = "SELECT EXISTS(SELECT 1 FROM matches WHERE Hash = :Hash)";
 
-	SQLite::Statement stmt(m_db, existsQuery);
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(existsQuery);
 
 	if (!stmt)
 	{
-		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", m_db.GetLastError());
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
 	}
-	stmt.Bind(":Hash", hash);
+	stmt->Bind(":Hash", hash);
 
-	stmt.ExecuteStep();
-	if (stmt.HasRow())
+	stmt->ExecuteStep();
+	if (stmt->HasRow())
 	{
 		bool exists = false;
-		if (stmt.GetBool(0, exists))
+		if (stmt->GetBool(0, exists))
 		{
 			return exists;
 		}
@@ -0,0 +1,323 @@
+// Copyright 2025 <github.com/razaqq>
+
+#include "Client/DatabaseManager.hpp"
+#include "Client/MatchStatistics.hpp"
+
+#include "Core/Format.hpp"
+#include "Core/Instrumentor.hpp"
+#include "Core/Sqlite.hpp"
+
+#include "ReplayParser/ReplayParser.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+using PotatoAlert::Client::AwardKind;
+using PotatoAlert::Client::AwardStatistics;
+using PotatoAlert::Client::DatabaseManager;
+using PotatoAlert::Client::MatchStatistics;
+using PotatoAlert::Client::SqlResult;
+using PotatoAlert::Client::StatisticsGrouping;
+using PotatoAlert::Core::SQLite;
+using PotatoAlert::ReplayParser::MatchOutcome;
+
+namespace {
+
+// the statistics are sums, which makes them easy to update incrementally:
+// a match adds its values to the row of each of its groups when it is inserted and subtracts them when it is deleted,
+// an update subtracts the old values and adds the new ones. every write path of the DatabaseManager goes through the
+// triggers, including migrations and bulk operations. rows of groups without matches are left at zero until the next
+// rebuild and skipped when reading.
+// statements in triggers are expensive inside of the savepoint of each write, so every trigger statement updates all
+// groups at once by joining with the list of groupings.
+
+struct Grouping
+{
+	StatisticsGrouping Type;
+	std::string_view Column;  // empty for the single group of StatisticsGrouping::All
+};
+
+constexpr std::array Groupings =
+{
+	Grouping{ StatisticsGrouping::All, "" },
+	Grouping{ StatisticsGrouping::Ship, "Ship" },
+	Grouping{ StatisticsGrouping::Map, "Map" },
+	Grouping{ StatisticsGrouping::MatchGroup, "MatchGroup" },
+};
+
+// the value of each statistics column for a single match, {0} is the row prefix like 'NEW.'
+struct StatisticsColumn
+{
+	std::string_view Name;
+	std::string_view Value;
+};
+
+constexpr std::array StatisticsColumns =
+{
+	StatisticsColumn{ "Matches", "1" },
+	StatisticsColumn{ "Analyzed", "iif({0}Analyzed, 1, 0)" },
+	StatisticsColumn{ "Wins", "iif({0}Analyzed AND {0}Outcome = {1}, 1, 0)" },
+	StatisticsColumn{ "Losses", "iif({0}Analyzed AND {0}Outcome = {2}, 1, 0)" },
+	StatisticsColumn{ "Draws", "iif({0}Analyzed AND {0}Outcome = {3}, 1, 0)" },
+	StatisticsColumn{ "DamageDealt", "iif({0}Analyzed, coalesce({0}DamageDealt, 0), 0)" },
+	StatisticsColumn{ "DamageTaken", "iif({0}Analyzed, coalesce({0}DamageTaken, 0), 0)" },
+	StatisticsColumn{ "DamageSpotting", "iif({0}Analyzed, coalesce({0}DamageSpotting, 0), 0)" },
+	StatisticsColumn{ "DamagePotential", "iif({0}Analyzed, coalesce({0}DamagePotential, 0), 0)" },
+};
+
+// the columns of matches the statistics depend on, updates of other columns do not touch them
+constexpr std::string_view TrackedColumns[] =
+{
+	"Ship", "Map", "MatchGroup", "Analyzed", "Outcome", "DamageDealt", "DamageTaken", "DamageSpotting", "DamagePotential",
+};
+
+std::string ColumnValue(const StatisticsColumn& column, std::string_view row)
+{
+	return fmt::format(fmt::runtime(column.Value), row,
+		static_cast<int>(MatchOutcome::Win), static_cast<int>(MatchOutcome::Loss), static_cast<int>(MatchOutcome::Draw));
+}
+
+// a table with the grouping of each group in column1
+std::string GroupingsTable()
+{
+	std::string values;
+	for (const Grouping& grouping : Groupings)
+	{
+		values += fmt::format("{}({})", values.empty() ? "" : ", ", static_cast<int>(grouping.Type));
+	}
+	return fmt::format("(VALUES {}) AS g", values);
+}
+
+// the key of the group of a match row in the grouping g.column1
+std::string GroupKey(std::string_view row)
+{
+	std::string key = "CASE g.column1";
+	for (const Grouping& grouping : Groupings)
+	{
+		if (!grouping.Column.empty())
+		{
+			key += fmt::format(" WHEN {} THEN coalesce({}{}, '')", static_cast<int>(grouping.Type), row, grouping.Column);
+		}
+	}
+	return key + " ELSE '' END";
+}
+
+// adds (or subtracts) the values of a single match row to the statistics of its groups
+std::string UpdateMatchStatistics(std::string_view row, bool subtract)
+{
+	std::string names;
+	std::string values;
+	std::string updates;
+	for (const StatisticsColumn& column : StatisticsColumns)
+	{
+		names += fmt::format(", {}", column.Name);
+		values += fmt::format(", {}({})", subtract ? "-" : "", ColumnValue(column, row));
+		updates += fmt::format("{0}{1} = {1} + excluded.{1}", updates.empty() ? "" : ", ", column.Name);
+	}
+
+	return fmt::format("INSERT INTO matchStats (Grouping, Key{}) SELECT g.column1, {}{} FROM {} WHERE true "
+		"ON CONFLICT (Grouping, Key) DO UPDATE SET {};",
+		names, GroupKey(row), values, GroupingsTable(), updates);
+}
+
+// adds (or subtracts) all awards of a match row to the award statistics of its groups, if it is analyzed
+std::string UpdateMatchAwardStatistics(std::string_view row, bool subtract)
+{
+	return fmt::format("INSERT INTO awardStats (Grouping, Key, Kind, Type, Count) "
+		"SELECT g.column1, {0}, a.Kind, a.Type, {1}a.Count FROM replayAwards AS a, {2} WHERE a.MatchId = {3}Id AND {3}Analyzed "
+		"ON CONFLICT (Grouping, Key, Kind, Type) DO UPDATE SET Count = Count + excluded.Count;",
+		GroupKey(row), subtract ? "-" : "", GroupingsTable(), row);
+}
+
+// adds (or subtracts) a single award row to the award statistics of the groups of its match, if it is analyzed
+std::string UpdateAwardStatistics(std::string_view row, bool subtract)
+{
+	return fmt::format("INSERT INTO awardStats (Grouping, Key, Kind, Type, Count) "
+		"SELECT g.column1, {0}, {1}Kind, {1}Type, {2}{1}Count FROM matches AS m, {3} WHERE m.Id = {1}MatchId AND m.Analyzed "
+		"ON CONFLICT (Grouping, Key, Kind, Type) DO UPDATE SET Count = Count + excluded.Count;",
+		GroupKey("m."), row, subtract ? "-" : "", GroupingsTable());
+}
+
+std::string StatisticsSchema()
+{
+	std::string sql =
+		"CREATE TABLE IF NOT EXISTS matchStats ("
+		"Grouping INTEGER NOT NULL, Key TEXT NOT NULL, "
+		"Matches INTEGER NOT NULL, Analyzed INTEGER NOT NULL, Wins INTEGER NOT NULL, Losses INTEGER NOT NULL, Draws INTEGER NOT NULL, "
+		"DamageDealt REAL NOT NULL, DamageTaken REAL NOT NULL, DamageSpotting REAL NOT NULL, DamagePotential REAL NOT NULL, "
+		"PRIMARY KEY (Grouping, Key)) WITHOUT ROWID;"
+		"CREATE TABLE IF NOT EXISTS awardStats ("
+		"Grouping INTEGER NOT NULL, Key TEXT NOT NULL, Kind INTEGER NOT NULL, Type INTEGER NOT NULL, Count INTEGER NOT NULL, "
+		"PRIMARY KEY (Grouping, Key, Kind, Type)) WITHOUT ROWID;";
+
+	std::string changed;
+	for (std::string_view column : TrackedColumns)
+	{
+		changed += fmt::format("{0}OLD.{1} IS NOT NEW.{1}", changed.empty() ? "" : " OR ", column);
+	}
+
+	sql += fmt::format("CREATE TRIGGER IF NOT EXISTS matches_stats_insert AFTER INSERT ON matches BEGIN {} END;",
+		UpdateMatchStatistics("NEW.", false));
+
+	// runs before the delete, the foreign key removes the awards of the match afterwards
+	sql += fmt::format("CREATE TRIGGER IF NOT EXISTS matches_stats_delete BEFORE DELETE ON matches BEGIN {}{} END;",
+		UpdateMatchStatistics("OLD.", true), UpdateMatchAwardStatistics("OLD.", true));
+
+	sql += fmt::format("CREATE TRIGGER IF NOT EXISTS matches_stats_update AFTER UPDATE OF {} ON matches WHEN {} BEGIN {}{}{}{} END;",
+		fmt::join(TrackedColumns, ", "), changed,
+		UpdateMatchStatistics("OLD.", true), UpdateMatchStatistics("NEW.", false),
+		UpdateMatchAwardStatistics("OLD.", true), UpdateMatchAwardStatistics("NEW.", false));
+
+	sql += fmt::format("CREATE TRIGGER IF NOT EXISTS replayAwards_stats_insert AFTER INSERT ON replayAwards BEGIN {} END;",
+		UpdateAwardStatistics("NEW.", false));
+
+	sql += fmt::format("CREATE TRIGGER IF NOT EXISTS replayAwards_stats_delete AFTER DELETE ON replayAwards BEGIN {} END;",
+		UpdateAwardStatistics("OLD.", true));
+
+	sql += fmt::format("CREATE TRIGGER IF NOT EXISTS replayAwards_stats_update AFTER UPDATE ON replayAwards BEGIN {}{} END;",
+		UpdateAwardStatistics("OLD.", true), UpdateAwardStatistics("NEW.", false));
+
+	return sql;
+}
+
+std::string StatisticsRebuild()
+{
+	std::string names;
+	std::string sums;
+	for (const StatisticsColumn& column : StatisticsColumns)
+	{
+		names += fmt::format(", {}", column.Name);
+		sums += fmt::format(", SUM({})", ColumnValue(column, ""));
+	}
+
+	return fmt::format("DELETE FROM matchStats; DELETE FROM awardStats;"
+		"INSERT INTO matchStats (Grouping, Key{0}) SELECT g.column1, {1}{2} FROM matches, {3} GROUP BY 1, 2;"
+		"INSERT INTO awardStats (Grouping, Key, Kind, Type, Count) "
+		"SELECT g.column1, {4}, a.Kind, a.Type, SUM(a.Count) FROM replayAwards AS a JOIN matches AS m ON m.Id = a.MatchId, {3} "
+		"WHERE m.Analyzed GROUP BY 1, 2, 3, 4;",
+		names, GroupKey(""), sums, GroupingsTable(), GroupKey("m."));
+}
+
+uint32_t GetUInt32(const SQLite::Statement& stmt, int index)
+{
+	int64_t value = 0;
+	stmt.GetInt64(index, value);
+	return static_cast<uint32_t>(value);
+}
+
+double GetDouble(const SQLite::Statement& stmt, int index)
+{
+	double value = 0.0;
+	stmt.GetDouble(index, value);
+	return value;
+}
+
+}  // namespace
+
+SqlResult<void> DatabaseManager::CreateStatisticsTables(const SQLite& db)
+{
+	static const std::string schema = StatisticsSchema();
+	if (!db.Execute(schema))
+	{
+		return PA_SQL_ERROR("Failed to create statistics tables: {}", db.GetLastError());
+	}
+	return {};
+}
+
+SqlResult<void> DatabaseManager::RebuildStatistics(const SQLite& db)
+{
+	PA_PROFILE_FUNCTION();
+
+	static const std::string rebuild = StatisticsRebuild();
+	if (!db.Execute(rebuild))
+	{
+		return PA_SQL_ERROR("Failed to rebuild statistics: {}", db.GetLastError());
+	}
+	return {};
+}
+
+SqlResult<std::vector<MatchStatistics>> DatabaseManager::GetMatchStatistics(StatisticsGrouping grouping) const
+{
+	static constexpr std::string_view selectQuery =
+			"SELECT Key, Matches, Analyzed, Wins, Losses, Draws, DamageDealt, DamageTaken, DamageSpotting, DamagePotential "
+			"FROM matchStats WHERE Grouping = :Grouping AND Matches > 0 ORDER BY Matches DESC, Key";
+
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
+
+	if (!stmt)
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
+	}
+
+	stmt->Bind(":Grouping", static_cast<int32_t>(grouping));
+
+	std::vector<MatchStatistics> statistics;
+	while (!stmt->IsDone())
+	{
+		stmt->ExecuteStep();
+		if (stmt->HasRow())
+		{
+			MatchStatistics& stats = statistics.emplace_back();
+			stmt->GetText(0, stats.Key);
+			stats.Matches = GetUInt32(*stmt, 1);
+			stats.Analyzed = GetUInt32(*stmt, 2);
+			stats.Wins = GetUInt32(*stmt, 3);
+			stats.Losses = GetUInt32(*stmt, 4);
+			stats.Draws = GetUInt32(*stmt, 5);
+			stats.DamageDealt = GetDouble(*stmt, 6);
+			stats.DamageTaken = GetDouble(*stmt, 7);
+			stats.DamageSpotting = GetDouble(*stmt, 8);
+			stats.DamagePotential = GetDouble(*stmt, 9);
+		}
+	}
+
+	if (stmt->HasFailed())
+	{
+		return PA_SQL_ERROR("Failed to read match statistics: {}", db->GetLastError());
+	}
+	return statistics;
+}
+
+SqlResult<std::vector<AwardStatistics>> DatabaseManager::GetAwardStatistics(StatisticsGrouping grouping, std::string_view key) const
+{
+	static constexpr std::string_view selectQuery =
+			"SELECT Kind, Type, Count FROM awardStats WHERE Grouping = :Grouping AND Key = :Key AND Count > 0 ORDER BY Kind, Count DESC";
+
+	const Reader db = AcquireReader();
+	SQLite::CachedStatement stmt = db->Prepare(selectQuery);
+
+	if (!stmt)
+	{
+		return PA_SQL_ERROR("Failed to prepare SQL statement: {}", db->GetLastError());
+	}
+
+	stmt->Bind(":Grouping", static_cast<int32_t>(grouping));
+	stmt->Bind(":Key", key);
+
+	std::vector<AwardStatistics> statistics;
+	while (!stmt->IsDone())
+	{
+		stmt->ExecuteStep();
+		if (stmt->HasRow())
+		{
+			int64_t kind = 0;
+			int64_t type = 0;
+			int64_t count = 0;
+			stmt->GetInt64(0, kind);
+			stmt->GetInt64(1, type);
+			stmt->GetInt64(2, count);
+			statistics.emplace_back(static_cast<AwardKind>(kind), type, static_cast<uint64_t>(count));
+		}
+	}
+
+	if (stmt->HasFailed())
+	{
+		return PA_SQL_ERROR("Failed to read award statistics: {}", db->GetLastError());
+	}
+	return statistics;
+}
@@ -1,6 +1,7 @@
 // Copyright 2020 <github.com/razaqq>
 
 #include "Client/AppDirectories.hpp"
+#include "Client/AsyncDatabaseManager.hpp"
 #include "Client/Config.hpp"
 #include "Client/DatabaseManager.hpp"
 #include "Client/Game.hpp"
@@ -15,6 +16,7 @@
 #include "Core/Format.hpp"
 #include "Core/Json.hpp"
 #include "Core/Log.hpp"
+#include "Core/Metrics.hpp"
 #include "Core/Sha256.hpp"
 #include "Core/String.hpp"
 #include "Core/StandardPaths.hpp"
@@ -22,6 +24,7 @@
 
 #include "GameFileUnpack/GameFileUnpack.hpp"
 
+#include <QByteArray>
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QObject>
@@ -33,11 +36,13 @@
 #include <filesystem>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
 
 
 using PotatoAlert::Client::PotatoClient;
 using PotatoAlert::Client::StatsParser::MatchType;
+using PotatoAlert::Client::StatsParser::ServerMatch;
 using PotatoAlert::GameFileUnpack::UnpackResult;
 using namespace PotatoAlert::Core;
 
@@ -148,52 +153,17 @@ PA_JSON_SERIALIZE_ENUM(ServerErrorCategory,
 	{ UnknownError, "UnknownError" }
 });
 
+// the category is kept as a string, so a category we do not know yet does not fail the whole response
 struct ServerResponse
 {
 	RequestStatus Status;
 	std::optional<std::string> Error;
-	std::optional<ServerErrorCategory> ErrorCategory;
+	std::optional<std::string> ErrorCategory;
 	std::optional<std::string> IssuedAt;
 	std::optional<std::string> CompletedAt;
-	std::optional<rapidjson::Document> Result;
+	ServerMatch Result;
 };
 
-[[maybe_unused]] static JsonResult<void> FromJson(rapidjson::Document& j, ServerResponse& r)
-{
-	if (!j.HasMember("status"))
-		return PA_JSON_ERROR("Server response is missing status");
-	FromJson(j["status"], r.Status);
-	if (j.HasMember("error"))
-	{
-		PA_TRYA(r.Error, PotatoAlert::Core::FromJson<std::string>(j, "error"));
-	}
-	if (j.HasMember("error_category"))
-	{
-		ServerErrorCategory category;
-		if (FromJson(j["error_category"], category))
-		{
-			r.ErrorCategory = category;
-		}
-
-	}
-	if (j.HasMember("issued_at"))
-	{
-		PA_TRYA(r.IssuedAt, PotatoAlert::Core::FromJson<std::string>(j, "issued_at"));
-	}
-	if (j.HasMember("completed_at"))
-	{
-		PA_TRYA(r.CompletedAt, PotatoAlert::Core::FromJson<std::string>(j, "completed_at"));
-	}
-	if (j.HasMember("result"))
-	{
-		rapidjson::Document d;
-		d.Swap(j["result"]);
-		r.Result = std::move(d);
-	}
-
-	return {};
-}
-
 static inline std::optional<std::string> GetReplayName(const MatchType::InfoType& info)
 {
 	const std::vector<std::string> dateSplit = Split(info.DateTime, " ");
@@ -212,6 +182,19 @@ static inline std::optional<std::string> GetReplayName(const MatchType::InfoType
 
 }
 
+template<>
+struct PotatoAlert::Core::JsonObject<ServerResponse>
+{
+	static constexpr auto Fields = std::make_tuple(
+		JsonField("status", &ServerResponse::Status),
+		JsonField("error", &ServerResponse::Error),
+		JsonField("error_category", &ServerResponse::ErrorCategory),
+		JsonField("issued_at", &ServerResponse::IssuedAt),
+		JsonField("completed_at", &ServerResponse::CompletedAt),
+		JsonField("result", &ServerResponse::Result, false)
+	);
+};
+
 void PotatoClient::Init()
 {
 	auto sysInfo = GetSysInfo();
@@ -226,15 +209,20 @@ void PotatoClient::Init()
 
 	connect(&m_watcher, &DirectoryWatcher::FileChanged, this, &PotatoClient::OnFileChanged);
 	connect(&m_watcher, &DirectoryWatcher::FileChanged, &m_replayAnalyzer, &ReplayAnalyzer::OnFileChanged);
+	// the replays written while we were closed are not connected, UpdateGameInstalls analyzes the whole game directory
 
 	connect(&m_replayAnalyzer, &ReplayAnalyzer::ReplaySummaryReady, this, &PotatoClient::ReplaySummaryChanged);
 
+	// has to be loaded before the directories are watched, so they can catch up with what changed while we were closed
+	m_watcher.LoadState(AppDataPath("PotatoAlert") / "DirectoryState.json");
+
 	UpdateGameInstalls();
 }
 
 void PotatoClient::SendRequest(std::string_view requestString, MatchContext&& matchContext)
 {
 	LOG_TRACE("Sending request with content: {}", requestString);
+	m_requestTime = std::chrono::steady_clock::now();
 
 	QNetworkRequest submitRequest;
 	submitRequest.setUrl(QUrl(m_options.SubmitUrl.data()));
@@ -315,27 +303,20 @@ void PotatoClient::LookupResult(const std::string& url, const std::string& authT
 		{
 			auto handler = [this, &url = url, authToken, &matchContext](QNetworkReply* reply)
 			{
-				const QString content = QString::fromUtf8(reply->readAll());
+				QByteArray content = reply->readAll();
 				if (content.isNull() || content == "null")
 				{
 					emit StatusReady(Status::Error, "NULL Response");
 					return;
 				}
 
-				const std::string lookupResponseString = content.toUtf8().toStdString();
-				LOG_TRACE("Got lookupReply from server with content '{}'", lookupResponseString);
-
-				PA_TRY_OR_ELSE(json, ParseJson(lookupResponseString),
-				{
-					LOG_ERROR("Failed to parse lookup response as JSON.");
-					emit StatusReady(Status::Error, "JSON Parse Error");
-					return;
-				});
+				LOG_TRACE("Got lookupReply from server with content '{}'", std::string_view(content.constData(), content.size()));
 
+				// parsed in place and only once, the match result is read into its structs along with the rest of the reply
 				ServerResponse serverResponse;
-				PA_TRYV_OR_ELSE(FromJson(json, serverResponse),
+				PA_TRYV_OR_ELSE(ReadJsonInSitu(content.data(), serverResponse),
 				{
-					LOG_ERROR("Failed to parse server lookup response as JSON.");
+					LOG_ERROR("Failed to parse server lookup response as JSON: {}", error);
 					emit StatusReady(Status::Error, "JSON Parse Error");
 					return;
 				});
@@ -350,17 +331,21 @@ void PotatoClient::LookupResult(const std::string& url, const std::string& authT
 					}
 					case Completed:
 					{
-						if (!serverResponse.Result)
+						if (!serverResponse.Result.HasMatch())
 						{
 							LOG_ERROR("Server says ResponseStatus is completed, but is missing result field");
 							return;
 						}
 
+						// from submitting the match until the server completed the lookup, including the polling
+						static Core::Histogram& lookupLatency = Core::Metrics::Instance().GetHistogram("client.lookup");
+						lookupLatency.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_requestTime).count()));
+
 						LOG_TRACE("Parsing match.");
 						const bool showKarma = m_services.Get<Config>().Get<ConfigKey::ShowKarma>();
 						const bool fontShadow = m_services.Get<Config>().Get<ConfigKey::FontShadow>();
 						const int fontScaling = m_services.Get<Config>().Get<ConfigKey::FontScaling>();
-						PA_TRY_OR_ELSE(res, ParseMatch(serverResponse.Result.value(), matchContext, { showKarma, fontShadow, (float)fontScaling / 100.0f }),
+						PA_TRY_OR_ELSE(res, ParseMatch(serverResponse.Result, matchContext, { showKarma, fontShadow, (float)fontScaling / 100.0f }),
 						{
 							LOG_ERROR("Failed to parse server match response as JSON: {}", error);
 							emit StatusReady(Status::Error, "JSON Parse Error");
@@ -371,59 +356,48 @@ void PotatoClient::LookupResult(const std::string& url, const std::string& authT
 
 						if (config.Get<ConfigKey::MatchHistory>())
 						{
-							const DatabaseManager& dbm = m_services.Get<DatabaseManager>();
-
-							PA_TRY_OR_ELSE(exists, dbm.MatchExists(m_lastArenaInfoHash),
+							const std::optional<std::string> replayName = GetReplayName(res.Match.Info);
+							if (!replayName)
 							{
-								LOG_ERROR("Failed to check if match exists in database: {}", error);
+								LOG_ERROR("Failed to get replay name");
 								return;
-							});
+							}
 
-							if (!exists)
+							Match match
+							{
+								.Hash = m_lastArenaInfoHash,
+								.ReplayName = *replayName,
+								.Date = res.Match.Info.DateTime,
+								.Ship = res.Match.Info.ShipName,
+								.ShipNation = res.Match.Info.ShipNation,
+								.ShipClass = res.Match.Info.ShipClass,
+								.ShipTier = res.Match.Info.ShipTier,
+								.Map = res.Match.Info.Map,
+								.MatchGroup = res.Match.Info.MatchGroup,
+								.StatsMode = res.Match.Info.StatsMode,
+								.Player = res.Match.Info.Player,
+								.Region = res.Match.Info.Region,
+								.Json = serverResponse.Result.Json,
+								.ArenaInfo = matchContext.ArenaInfo,
+								.Analyzed = false,
+								.ReplaySummary = ReplaySummary{}
+							};
+
+							// checking for the match and adding it runs on the database threads, not on the gui thread
+							m_services.Get<AsyncDatabaseManager>().AddMatchAsync(std::move(match), this, [this](SqlResult<std::optional<Match>> added)
 							{
-								LOG_TRACE("Adding match to match history '{}'", m_lastArenaInfoHash);
-								
-								rapidjson::StringBuffer buffer;
-								rapidjson::Writer writer(buffer);
-								serverResponse.Result.value().Accept(writer);
-
-								const std::optional<std::string> replayName = GetReplayName(res.Match.Info);
-								if (!replayName)
+								PA_TRY_OR_ELSE(addedMatch, std::move(added),
 								{
-									LOG_ERROR("Failed to get replay name");
+									LOG_ERROR("Failed to add match to database: {}", error);
 									return;
-								}
+								});
 
-								Match match
+								if (addedMatch)
 								{
-									.Hash = m_lastArenaInfoHash,
-									.ReplayName = *replayName,
-									.Date = res.Match.Info.DateTime,
-									.Ship = res.Match.Info.ShipName,
-									.ShipNation = res.Match.Info.ShipNation,
-									.ShipClass = res.Match.Info.ShipClass,
-									.ShipTier = res.Match.Info.ShipTier,
-									.Map = res.Match.Info.Map,
-									.MatchGroup = res.Match.Info.MatchGroup,
-									.StatsMode = res.Match.Info.StatsMode,
-									.Player = res.Match.Info.Player,
-									.Region = res.Match.Info.Region,
-									.Json = buffer.GetString(),
-									.ArenaInfo = matchContext.ArenaInfo,
-									.Analyzed = false,
-									.ReplaySummary = ReplaySummary{}
-								};
-
-								SqlResult<void> addResult = dbm.AddMatch(match);
-								if (addResult)
-								{
-									emit MatchHistoryNewMatch(match);
+									LOG_TRACE("Added match to match history '{}'", addedMatch->Hash);
+									emit MatchHistoryNewMatch(*addedMatch);
 								}
-								else
-								{
-									LOG_ERROR("Failed to add match to database: {}", addResult.error());
-								}
-							}
+							});
 						}
 
 						if (config.Get<ConfigKey::SaveMatchCsv>())
@@ -454,9 +428,10 @@ void PotatoClient::LookupResult(const std::string& url, const std::string& authT
 					}
 					case Error:
 					{
-						if (serverResponse.ErrorCategory)
+						ServerErrorCategory category;
+						if (serverResponse.ErrorCategory && FromJson(std::string_view(*serverResponse.ErrorCategory), category))
 						{
-							switch (*serverResponse.ErrorCategory)
+							switch (category)
 							{
 								case WargamingApiError:
 								{
@@ -654,6 +629,7 @@ void PotatoClient::UpdateGameInstalls()
 {
 	m_gameInfos.clear();
 	m_watcher.ClearDirectories();
+	m_replayAnalyzer.CancelDirectoryAnalysis();
 
 	for (const fs::path& game : m_services.Get<Config>().Get<ConfigKey::GameDirectories>())
 	{
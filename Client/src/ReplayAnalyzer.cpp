@@ -6,6 +6,7 @@
 #include "Core/Encoding.hpp"
 #include "Core/File.hpp"
 #include "Core/Log.hpp"
+#include "Core/Metrics.hpp"
 #include "Core/String.hpp"
 
 #include "GameFileUnpack/GameFileUnpack.hpp"
@@ -15,9 +16,14 @@
 #include <algorithm>
 #include <chrono>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <ranges>
+#include <span>
 #include <string>
+#include <utility>
+#include <vector>
 
 
 namespace fs = std::filesystem;
@@ -28,6 +34,21 @@ using PotatoAlert::Client::ReplayAnalyzer;
 using PotatoAlert::GameFileUnpack::Unpacker;
 using PotatoAlert::GameFileUnpack::UnpackResult;
 
+namespace {
+
+// the summaries of a directory are written in batches, instead of one write per replay
+struct DirectoryAnalysis
+{
+	std::mutex Mutex;
+	size_t Remaining = 0;
+	std::vector<uint32_t> Ids;
+	std::vector<ReplaySummary> Summaries;
+};
+
+static constexpr size_t SummaryBatchSize = 128;
+
+}  // namespace
+
 bool ReplayAnalyzer::HasGameFiles(Version gameVersion) const
 {
 	return ReplayParser::HasGameScripts(gameVersion, m_gameFilePath);
@@ -36,10 +57,12 @@ bool ReplayAnalyzer::HasGameFiles(Version gameVersion) const
 
 UnpackResult<void> ReplayAnalyzer::UnpackGameFiles(const fs::path& dst, const fs::path& pkgPath, const fs::path& idxPath)
 {
-	Unpacker unpacker(pkgPath, idxPath);
+	// the cache is shared between versions, it is simply rebuilt whenever the idx files change
+	Unpacker unpacker(pkgPath, idxPath, dst.parent_path() / "idx.cache");
 	PA_TRYV(unpacker.Parse());
-	PA_TRYV(unpacker.Extract("scripts/", dst));
-	PA_TRYV(unpacker.Extract("content/GameParams.data", dst));
+	// a partially written pkg file after an interrupted game update must not end up as corrupt scripts
+	PA_TRYV(unpacker.Extract("scripts/", dst, true, true));
+	PA_TRYV(unpacker.Extract("content/GameParams.data", dst, true, true));
 	return {};
 }
 
@@ -95,17 +118,59 @@ void ReplayAnalyzer::AnalyzeReplay(const fs::path& path, std::chrono::seconds re
 	// this avoids running multiple analyzes if the game writes to the replay multiple times
 	if (!m_futures.contains(path.native()))
 	{
-		m_futures.emplace(path.native(), m_threadPool.Enqueue(analyze, path, readDelay));
+		m_futures.emplace(path.native(), m_threadPool.Enqueue(TaskPriority::High, analyze, path, readDelay));
 	}
 
 	if (m_futures.at(path.native()).wait_for(0s) == std::future_status::ready)
 	{
-		m_futures.at(path.native()) = m_threadPool.Enqueue(analyze, path, readDelay);
+		m_futures.at(path.native()) = m_threadPool.Enqueue(TaskPriority::High, analyze, path, readDelay);
 	}
 }
 
+void ReplayAnalyzer::StoreSummaries(std::span<const uint32_t> ids, std::span<const ReplaySummary> summaries) const
+{
+	PA_TRYV_OR_ELSE(m_services.Get<DatabaseManager>().SetMatchReplaySummaries(summaries),
+	{
+		LOG_ERROR("Failed to set replay summaries for {} matches: {}", summaries.size(), error);
+		return;
+	});
+
+	for (size_t i = 0; i < summaries.size(); i++)
+	{
+		emit ReplaySummaryReady(ids[i], summaries[i]);
+	}
+	LOG_TRACE("Set replay summaries for {} matches", summaries.size());
+}
+
 void ReplayAnalyzer::AnalyzeDirectory(const fs::path& directory)
 {
+	std::error_code ec;
+	auto it = fs::recursive_directory_iterator(directory, ec);
+	if (ec)
+	{
+		LOG_ERROR("Failed to iterate replay directory '{}': {}", directory, ec.message());
+		return;
+	}
+
+	std::vector<fs::path> files;
+	for (const fs::directory_entry& entry : it)
+	{
+		if (entry.is_regular_file() && entry.path().extension() == ".wowsreplay")
+		{
+			files.emplace_back(entry.path());
+		}
+	}
+
+	AnalyzeReplays(files);
+}
+
+void ReplayAnalyzer::AnalyzeReplays(const std::vector<fs::path>& files)
+{
+	if (files.empty())
+	{
+		return;
+	}
+
 	const DatabaseManager& dbm = m_services.Get<DatabaseManager>();
 
 	PA_TRY_OR_ELSE(matches, dbm.GetNonAnalyzedMatches(),
@@ -119,28 +184,94 @@ void ReplayAnalyzer::AnalyzeDirectory(const fs::path& directory)
 		return left.ReplayName < right.ReplayName;
 	});
 
-	std::error_code ec;
-	auto it = fs::recursive_directory_iterator(directory, ec);
-	if (ec)
+	std::vector<std::pair<fs::path, NonAnalyzedMatch>> replays;
+	for (const fs::path& file : files)
+	{
+		// the files that were removed in the meantime are skipped as well
+		if (file.extension() != fs::path(".wowsreplay") || !File::Exists(file))
+		{
+			continue;
+		}
+
+		auto found = std::ranges::find_if(matches, [&](const NonAnalyzedMatch& match)
+		{
+			const std::string fileName = String::ToLower(file.filename().string());
+			return String::ToLower(match.ReplayName) == fileName;
+		});
+
+		// skip replays that are currently analyzed because they changed
+		auto running = m_futures.find(file.native());
+		if (found != matches.end() && (running == m_futures.end() || running->second.wait_for(0s) == std::future_status::ready))
+		{
+			replays.emplace_back(file, *found);
+		}
+	}
+
+	if (replays.empty())
 	{
-		LOG_ERROR("Failed to iterate replay directory '{}': {}", directory, ec.message());
 		return;
 	}
 
-	for (const fs::directory_entry& entry : it)
+	auto analysis = std::make_shared<DirectoryAnalysis>();
+	analysis->Remaining = replays.size();
+
+	auto analyze = [this, analysis](const CancellationToken& token, const fs::path& file, const NonAnalyzedMatch& match) -> void
 	{
-		if (entry.is_regular_file() && entry.path().extension() == ".wowsreplay")
+		// cancelled replays still count towards the analysis, so the summaries of the finished ones are stored
+		std::optional<ReplaySummary> summary;
+		if (!token.IsCancelled())
 		{
-			auto found = std::ranges::find_if(matches, [&](const NonAnalyzedMatch& match)
+			ReplayResult<ReplaySummary> result = ReplayParser::AnalyzeReplay(file, m_gameFilePath);
+			if (!result)
 			{
-				const std::string fileName = String::ToLower(entry.path().filename().string());
-				return String::ToLower(match.ReplayName) == fileName;
-			});
+				LOG_ERROR(STR("Failed to analyze replay file {}: {}"), file, StringWrap(result.error()));
+			}
+			else if (result->Hash != match.Hash)
+			{
+				LOG_TRACE("Cannot find replay to set summary with hash '{}'", result->Hash);
+			}
+			else
+			{
+				summary = std::move(result.value());
+			}
+		}
 
-			if (found != matches.end())
+		std::vector<uint32_t> ids;
+		std::vector<ReplaySummary> summaries;
+		{
+			std::unique_lock lock(analysis->Mutex);
+			if (summary)
 			{
-				AnalyzeReplay(entry.path());
+				analysis->Ids.emplace_back(match.Id);
+				analysis->Summaries.emplace_back(std::move(*summary));
 			}
+
+			analysis->Remaining--;
+			if (analysis->Remaining == 0 || analysis->Summaries.size() >= SummaryBatchSize)
+			{
+				ids.swap(analysis->Ids);
+				summaries.swap(analysis->Summaries);
+			}
+		}
+
+		if (!summaries.empty())
+		{
+			StoreSummaries(ids, summaries);
 		}
+		PA_METRIC_GAUGE_ADD("replay.backlog", -1);
+	};
+
+	PA_METRIC_GAUGE_ADD("replay.backlog", static_cast<int64_t>(replays.size()));
+
+	// the backlog of old replays must not delay the summary of a match that just ended
+	for (const auto& [path, match] : replays)
+	{
+		m_futures[path.native()] = m_threadPool.Enqueue(TaskPriority::Low, m_directoryCancellation, analyze, path, match);
 	}
 }
+
+void ReplayAnalyzer::CancelDirectoryAnalysis()
+{
+	m_directoryCancellation.Cancel();
+	m_directoryCancellation = CancellationToken();
+}
@@ -88,24 +88,12 @@ struct Color
 	}
 
 private:
-	int m_r, m_g, m_b;
+	friend struct Core::JsonSax<Color>;
+
+	int m_r = 0, m_g = 0, m_b = 0;
 	std::optional<int> m_a;
 };
 
-template<size_t Size>
-static JsonResult<Color> ToColor(const rapidjson::Value& value, std::string_view key)
-{
-	if (!value.HasMember(key.data()))
-		return PA_JSON_ERROR("Json color object has no key '{}'", key);
-
-	std::array<int, Size> color = {};
-	if (!Core::FromJson(value[key.data()], color))
-	{
-		return PA_JSON_ERROR("Failed to get stat color json as array");
-	}
-	return Color(color);
-}
-
 class ShadowLabel : public QLabel
 {
 public:
@@ -160,16 +148,6 @@ struct Stat
 	}
 };
 
-static JsonResult<void> FromJson(const rapidjson::Value& j, std::string_view key, Stat& s)
-{
-	if (!j.HasMember(key.data()))
-		return PA_JSON_ERROR("Json object for Stat has no key '{}'", key);
-
-	PA_TRYA(s.Str, Core::FromJson<std::string>(j[key.data()], "string"));
-	PA_TRYA(s.ColorRGB, ToColor<3>(j[key.data()], "color"));
-	return {};
-}
-
 struct Clan
 {
 	std::string Name;
@@ -191,15 +169,6 @@ struct Clan
 	}
 };
 
-static JsonResult<void> FromJson(const rapidjson::Value& j, Clan& c)
-{
-	PA_TRYA(c.Name, Core::FromJson<std::string>(j, "name"));
-	PA_TRYA(c.Tag, Core::FromJson<std::string>(j, "tag"));
-	PA_TRYA(c.ColorRGB, ToColor<3>(j, "color"));
-	PA_TRYA(c.Region, Core::FromJson<std::string>(j, "region"));
-	return {};
-}
-
 struct Ship
 {
 	std::string Name;
@@ -264,15 +233,6 @@ struct Ship
 	}
 };
 
-static JsonResult<void> FromJson(const rapidjson::Value& j, Ship& s)
-{
-	PA_TRYA(s.Name, Core::FromJson<std::string>(j, "name"));
-	PA_TRYA(s.Class, Core::FromJson<std::string>(j, "class"));
-	PA_TRYA(s.Nation, Core::FromJson<std::string>(j, "nation"));
-	PA_TRYA(s.Tier, Core::FromJson<uint8_t>(j, "tier"));
-	return {};
-}
-
 struct Player
 {
 	std::optional<Clan> Clan;
@@ -289,7 +249,7 @@ struct Player
 	std::optional<Stat> Karma;
 	Color PrColor;
 	std::string WowsNumbers;
-	bool IsUsingPa;
+	bool IsUsingPa = false;
 
 	[[nodiscard]] PlayerType GetTableRow(const MatchParseOptions& parseOptions) const
 	{
@@ -389,51 +349,6 @@ struct Player
 	}
 };
 
-static JsonResult<void> FromJson(const rapidjson::Value& j, Player& p)
-{
-	if (j.HasMember("clan") && !j["clan"].IsNull())
-	{
-		Clan clan;
-		PA_TRYV(FromJson(j["clan"], clan));
-		p.Clan = clan;
-	}
-	PA_TRYA(p.HiddenPro, Core::FromJson<bool>(j, "hidden_profile"));
-	PA_TRYA(p.Name, Core::FromJson<std::string>(j, "name"));
-	PA_TRYA(p.NameColor, ToColor<3>(j, "name_color"));
-	if (j.HasMember("ship") && !j["ship"].IsNull())
-	{
-		Ship ship;
-		PA_TRYV(FromJson(j["ship"], ship));
-		p.Ship = ship;
-	}
-	PA_TRYV(FromJson(j, "battles", p.Battles));
-	PA_TRYV(FromJson(j, "win_rate", p.Winrate));
-	PA_TRYV(FromJson(j, "avg_dmg", p.AvgDmg));
-	PA_TRYV(FromJson(j, "battles_ship", p.BattlesShip));
-	PA_TRYV(FromJson(j, "win_rate_ship", p.WinrateShip));
-	PA_TRYV(FromJson(j, "avg_dmg_ship", p.AvgDmgShip));
-	PA_TRYA(p.PrColor, ToColor<4>(j, "pr_color"));
-
-	PA_TRYA(p.WowsNumbers, Core::FromJson<std::string>(j, "wows_numbers_link"));
-
-	if (j.HasMember("karma") && !j["karma"].IsNull())
-	{
-		Stat karma;
-		PA_TRYV(FromJson(j, "karma", karma));
-		p.Karma = karma;
-	}
-
-	if (j.HasMember("is_using_pa"))
-	{
-		PA_TRYA(p.IsUsingPa, Core::FromJson<bool>(j, "is_using_pa"));
-	}
-	else
-	{
-		p.IsUsingPa = false;
-	}
-	return {};
-}
-
 struct Team
 {
 	uint8_t Id;
@@ -442,24 +357,6 @@ struct Team
 	Stat AvgWr;
 };
 
-static JsonResult<void> FromJson(const rapidjson::Value& j, Team& t)
-{
-	PA_TRYV(Core::FromJson(j, "id", t.Id));
-
-	const auto playersValue = j["players"].GetArray();
-	t.Players.reserve(playersValue.Size());
-	for (const auto& m : playersValue)
-	{
-		Player player;
-		PA_TRYV(FromJson(m, player));
-		t.Players.emplace_back(player);
-	}
-	// PA_TRYV(Core::FromJson(j, "players", t.players));
-	PA_TRYV(FromJson(j, "avg_dmg", t.AvgDmg));
-	PA_TRYV(FromJson(j, "avg_win_rate", t.AvgWr));
-	return {};
-}
-
 struct Match
 {
 	Team Team1;
@@ -471,19 +368,6 @@ struct Match
 	std::string DateTime;
 };
 
-static JsonResult<void> FromJson(const rapidjson::Value& j, Match& m)
-{
-	PA_TRYV(FromJson(j["team1"], m.Team1));
-	PA_TRYV(FromJson(j["team2"], m.Team2));
-	PA_TRYA(m.MatchGroup, Core::FromJson<std::string>(j, "match_group"));
-	PA_TRYA(m.StatsMode, Core::FromJson<std::string>(j, "stats_mode"));
-	PA_TRYA(m.Region, Core::FromJson<std::string>(j, "region"));
-	PA_TRYA(m.Map, Core::FromJson<std::string>(j, "map"));
-	PA_TRYA(m.DateTime, Core::FromJson<std::string>(j, "date_time"));
-
-	return {};
-}
-
 static std::string GetCSV(const Match& match)
 {
 	std::string out;
@@ -517,6 +401,112 @@ static std::string GetCSV(const Match& match)
 
 }  // namespace _JSON
 
+// colors are sent as [r, g, b] or [r, g, b, a]
+template<>
+struct PotatoAlert::Core::JsonSax<_JSON::Color>
+{
+	static constexpr Sax::SinkOps Ops =
+	{
+		.StartArray = [](void*) { return true; },
+		.Element = [](void* target, size_t index) -> Sax::Sink
+		{
+			_JSON::Color& color = *static_cast<_JSON::Color*>(target);
+			switch (index)
+			{
+				case 0:
+					return Sax::SinkFor(color.m_r);
+				case 1:
+					return Sax::SinkFor(color.m_g);
+				case 2:
+					return Sax::SinkFor(color.m_b);
+				case 3:
+					return Sax::SinkFor(color.m_a);
+				default:
+					return {};
+			}
+		},
+		.EndArray = [](void*, size_t count) { return count == 3 || count == 4; },
+	};
+};
+
+template<>
+struct PotatoAlert::Core::JsonObject<_JSON::Stat>
+{
+	static constexpr auto Fields = std::make_tuple(
+		JsonField("string", &_JSON::Stat::Str),
+		JsonField("color", &_JSON::Stat::ColorRGB)
+	);
+};
+
+template<>
+struct PotatoAlert::Core::JsonObject<_JSON::Clan>
+{
+	static constexpr auto Fields = std::make_tuple(
+		JsonField("name", &_JSON::Clan::Name),
+		JsonField("tag", &_JSON::Clan::Tag),
+		JsonField("color", &_JSON::Clan::ColorRGB),
+		JsonField("region", &_JSON::Clan::Region)
+	);
+};
+
+template<>
+struct PotatoAlert::Core::JsonObject<_JSON::Ship>
+{
+	static constexpr auto Fields = std::make_tuple(
+		JsonField("name", &_JSON::Ship::Name),
+		JsonField("class", &_JSON::Ship::Class),
+		JsonField("nation", &_JSON::Ship::Nation),
+		JsonField("tier", &_JSON::Ship::Tier)
+	);
+};
+
+template<>
+struct PotatoAlert::Core::JsonObject<_JSON::Player>
+{
+	static constexpr auto Fields = std::make_tuple(
+		JsonField("clan", &_JSON::Player::Clan),
+		JsonField("hidden_profile", &_JSON::Player::HiddenPro),
+		JsonField("name", &_JSON::Player::Name),
+		JsonField("name_color", &_JSON::Player::NameColor),
+		JsonField("ship", &_JSON::Player::Ship),
+		JsonField("battles", &_JSON::Player::Battles),
+		JsonField("win_rate", &_JSON::Player::Winrate),
+		JsonField("avg_dmg", &_JSON::Player::AvgDmg),
+		JsonField("battles_ship", &_JSON::Player::BattlesShip),
+		JsonField("win_rate_ship", &_JSON::Player::WinrateShip),
+		JsonField("avg_dmg_ship", &_JSON::Player::AvgDmgShip),
+		JsonField("karma", &_JSON::Player::Karma),
+		JsonField("pr_color", &_JSON::Player::PrColor),
+		JsonField("wows_numbers_link", &_JSON::Player::WowsNumbers),
+		JsonField("is_using_pa", &_JSON::Player::IsUsingPa, false)
+	);
+};
+
+template<>
+struct PotatoAlert::Core::JsonObject<_JSON::Team>
+{
+	static constexpr auto Fields = std::make_tuple(
+		JsonField("id", &_JSON::Team::Id),
+		JsonField("players", &_JSON::Team::Players),
+		JsonField("avg_dmg", &_JSON::Team::AvgDmg),
+		JsonField("avg_win_rate", &_JSON::Team::AvgWr)
+	);
+};
+
+template<>
+struct PotatoAlert::Core::JsonObject<_JSON::Match>
+{
+	static constexpr auto Fields = std::make_tuple(
+		JsonField("team1", &_JSON::Match::Team1),
+		JsonField("team2", &_JSON::Match::Team2),
+		JsonField("match_group", &_JSON::Match::MatchGroup),
+		JsonField("stats_mode", &_JSON::Match::StatsMode),
+		JsonField("region", &_JSON::Match::Region),
+		JsonField("map", &_JSON::Match::Map),
+		JsonField("date_time", &_JSON::Match::DateTime)
+	);
+};
+
 namespace pn = PotatoAlert::Client::StatsParser;
 
 void pn::Label::UpdateLabel(QLabel* label) const
@@ -531,13 +521,32 @@ void pn::Label::UpdateLabel(QLabel* label) const
 	}
 }
 
-JsonResult<StatsParseResult> pn::ParseMatch(const rapidjson::Value& j, const MatchContext& matchContext, MatchParseOptions&& parseOptions) noexcept
+struct pn::ServerMatch::Data
 {
-	StatsParseResult result;
+	std::optional<_JSON::Match> Match;
+};
 
-	_JSON::Match match;
-	PA_TRYV(FromJson(j, match));
+pn::ServerMatch::ServerMatch() : m_data(std::make_unique<Data>()) {}
+
+pn::ServerMatch::ServerMatch(ServerMatch&&) noexcept = default;
+
+pn::ServerMatch& pn::ServerMatch::operator=(ServerMatch&&) noexcept = default;
+
+pn::ServerMatch::~ServerMatch() = default;
+
+bool pn::ServerMatch::HasMatch() const
+{
+	return m_data && m_data->Match;
+}
 
+Core::Sax::Sink PotatoAlert::Core::JsonSax<pn::ServerMatch>::SinkFor(pn::ServerMatch& match)
+{
+	return { &match.m_data->Match, &Sax::OpsFor<std::optional<_JSON::Match>>, &match.Json };
+}
+
+static StatsParseResult GetParseResult(_JSON::Match& match, const MatchContext& matchContext, const MatchParseOptions& parseOptions)
+{
+	StatsParseResult result;
 	result.Csv = GetCSV(match);
 
 	_JSON::Ship playerShip;
@@ -639,7 +648,16 @@ JsonResult<StatsParseResult> pn::ParseMatch(const rapidjson::Value& j, const Mat
 
 JsonResult<StatsParseResult> pn::ParseMatch(const std::string& raw, const MatchContext& matchContext, MatchParseOptions&& parseOptions) noexcept
 {
-	PA_TRY(j, Core::ParseJson(raw));
-	PA_TRY(match, ParseMatch(j, matchContext, std::move(parseOptions)));
-	return match;
+	// read straight into the structs, a match has a few hundred values and building a document for them was most of the time
+	_JSON::Match match;
+	PA_TRYV(Core::ReadJson(raw, match));
+	return GetParseResult(match, matchContext, parseOptions);
+}
+
+JsonResult<StatsParseResult> pn::ParseMatch(ServerMatch& match, const MatchContext& matchContext, MatchParseOptions&& parseOptions) noexcept
+{
+	if (!match.HasMatch())
+		return PA_JSON_ERROR("Server response has no match result");
+
+	return GetParseResult(*match.m_data->Match, matchContext, parseOptions);
 }
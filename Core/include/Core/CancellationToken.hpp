@@ -0,0 +1,30 @@
+// Copyright 2025 <github.com/razaqq>
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+
+namespace PotatoAlert::Core {
+
+// cooperative cancellation, copies share their state and the work checks IsCancelled at points where it can stop
+class CancellationToken
+{
+public:
+	CancellationToken() : m_cancelled(std::make_shared<std::atomic_bool>(false)) {}
+
+	void Cancel() const
+	{
+		m_cancelled->store(true, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] bool IsCancelled() const
+	{
+		return m_cancelled->load(std::memory_order_relaxed);
+	}
+
+private:
+	std::shared_ptr<std::atomic_bool> m_cancelled;
+};
+
+}  // namespace PotatoAlert::Core
@@ -0,0 +1,21 @@
+// Copyright 2025 <github.com/razaqq>
+#pragma once
+
+#include "Core/Bytes.hpp"
+
+#include <cstdint>
+#include <span>
+
+
+namespace PotatoAlert::Core {
+
+// crc32 with the zlib polynomial, can be computed incrementally by passing in the previous result
+// uses carry-less multiplication folding if the cpu supports it and slice-by-8 otherwise
+uint32_t Crc32(uint32_t crc, std::span<const Byte> data);
+
+inline uint32_t Crc32(std::span<const Byte> data)
+{
+	return Crc32(0, data);
+}
+
+}  // namespace PotatoAlert::Core
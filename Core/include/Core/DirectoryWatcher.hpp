@@ -1,37 +1,100 @@
 // Copyright 2022 <github.com/razaqq>
 #pragma once
 
-#include <QFileSystemWatcher>
-#include <QDateTime>
+#include <QObject>
 #include <QString>
+#include <QTimer>
 
+#ifdef WIN32
+	#include <QFileSystemWatcher>
+#else
+	#include <QSocketNotifier>
+#endif
+
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 
 namespace PotatoAlert::Core {
 
+// emits FileChanged for every file that was written, moved into or removed from a watched directory
+// on linux the changes come straight from inotify, elsewhere the directory is compared to its last listing
+// all changes within DebounceInterval of the first one are coalesced, so every file is emitted once per burst
+// the known files of every directory can be kept across restarts, the changes made while we were closed are emitted
+// with FilesCaughtUp once the directory is watched again, so they are not mistaken for live ones
 class DirectoryWatcher : public QObject
 {
 	Q_OBJECT
 
 public:
+	static constexpr std::chrono::milliseconds DebounceInterval{ 100 };
+	static constexpr std::chrono::seconds SaveInterval{ 30 };
+
 	DirectoryWatcher();
+	~DirectoryWatcher() override;
+
 	void WatchDirectory(std::string_view dir);
 	void WatchDirectory(const std::filesystem::path& dir);
 	void ClearDirectories();
 	void ForceDirectoryChanged();
 	void ForceFileChanged(std::string_view file);
 
+	// the state of the watched directories is written back to the file at most every SaveInterval and on destruction
+	bool LoadState(const std::filesystem::path& stateFile);
+
 private:
+	struct FileState
+	{
+		uint64_t Size;
+		int64_t LastWriteTime;
+
+		bool operator==(const FileState&) const = default;
+	};
+
+	// file name -> state, every directory has its own table so a change only ever touches the entries of its directory
+	using DirectoryState = std::unordered_map<std::filesystem::path, FileState>;
+
+	[[nodiscard]] std::vector<std::filesystem::path> ScanDirectory(const std::filesystem::path& directory);
+	void UpdateFile(const std::filesystem::path& directory, const std::filesystem::path& file);
+	void MarkStateChanged();
+	bool SaveState();
+	[[nodiscard]] std::vector<std::filesystem::path> Directories() const;
+	void QueueChange(const std::filesystem::path& directory, const std::filesystem::path& file);
+	void QueueCaughtUp(std::vector<std::filesystem::path> files);
+	void ClearChanges();
+	void EmitChanges();
+
+	QTimer m_debounceTimer;
+	std::vector<std::filesystem::path> m_changedDirectories;
+	std::vector<std::filesystem::path> m_changedFiles;
+	std::unordered_set<std::filesystem::path> m_queued;
+	std::vector<std::filesystem::path> m_caughtUpFiles;
+
+	std::unordered_map<std::filesystem::path, DirectoryState> m_directories;
+	std::filesystem::path m_stateFile;
+	QTimer m_saveTimer;
+	bool m_stateChanged = false;
+
+#ifdef WIN32
 	void OnDirectoryChanged(const QString& path);
 	QFileSystemWatcher m_watcher;
-	std::unordered_map<QString, QDateTime> m_lastModified;
+#else
+	void ReadEvents();
+	int m_inotify = -1;
+	std::unique_ptr<QSocketNotifier> m_notifier;
+	std::unordered_map<int, std::filesystem::path> m_watches;
+#endif
 
 signals:
 	void DirectoryChanged(const std::filesystem::path& directory);
 	void FileChanged(const std::filesystem::path& file);
+	void FilesCaughtUp(const std::vector<std::filesystem::path>& files);
 };
 
 }  // namespace PotatoAlert::Core
@@ -129,6 +129,25 @@ public:
 		return RawWriteString(m_handle, data, resetFilePointer);
 	}
 
+	// writes at the current file pointer and leaves the end of the file untouched, use Truncate once done
+	template<is_byte T>
+	bool WriteChunk(std::span<const T> data) const
+	{
+		return RawWriteChunk<T>(m_handle, data);
+	}
+
+	// sets the end of the file to the current file pointer
+	bool Truncate() const
+	{
+		return RawTruncate(m_handle);
+	}
+
+	// reserves disk space for size bytes without changing the file size where the os allows it
+	bool Allocate(uint64_t size) const
+	{
+		return RawAllocate(m_handle, size);
+	}
+
 	bool FlushBuffer() const
 	{
 		return RawFlushBuffer(m_handle);
@@ -214,6 +233,10 @@ private:
 	template<is_byte T>
 	static bool RawWrite(Handle handle, std::span<const T> data, bool resetFilePointer);
 	static bool RawWriteString(Handle handle, std::string_view data, bool resetFilePointer);
+	template<is_byte T>
+	static bool RawWriteChunk(Handle handle, std::span<const T> data);
+	static bool RawTruncate(Handle handle);
+	static bool RawAllocate(Handle handle, uint64_t size);
 	static bool RawFlushBuffer(Handle handle);
 	static uint64_t RawGetSize(Handle handle);
 	static Handle RawOpen(std::string_view path, Flags flags);
@@ -1,129 +1,216 @@
 // Copyright 2021 <github.com/razaqq>
 #pragma once
 
-#include "Core/AsciiTable.hpp"
-#include "Core/Log.hpp"
+#include "Core/File.hpp"
+#include "Core/Metrics.hpp"
 #include "Core/Preprocessor.hpp"
 #include "Core/Singleton.hpp"
-#include "Core/String.hpp"
 
-#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
-#include <numeric>
-#include <sstream>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 
-namespace core = PotatoAlert::Core;
-
 namespace PotatoAlert::Core {
 
-using Micros = std::chrono::duration<double, std::micro>;
-using MicrosRep = std::chrono::microseconds::rep;
+namespace Detail {
 
-struct ProfileResult
+// the scope name with calling conventions and our namespace stripped, built at compile time
+template<size_t N>
+struct ScopeName
 {
-	std::string_view name;
-	Micros startTime;
-	std::chrono::microseconds elapsedTime;
-	std::thread::id threadId;
+	std::array<char, N> Data{};
+
+	consteval explicit ScopeName(const char (&name)[N])
+	{
+		constexpr std::string_view removed[] = { "__cdecl ", "PotatoAlert::" };
+
+		size_t out = 0;
+		for (size_t i = 0; i < N - 1;)
+		{
+			bool skipped = false;
+			for (const std::string_view r : removed)
+			{
+				if (std::string_view(name + i, N - 1 - i).starts_with(r))
+				{
+					i += r.size();
+					skipped = true;
+					break;
+				}
+			}
+			if (!skipped)
+				Data[out++] = name[i++];
+		}
+	}
+
+	[[nodiscard]] constexpr const char* CStr() const
+	{
+		return Data.data();
+	}
 };
 
-class Instrumentor
+}  // namespace Detail
+
+using TraceClock = std::chrono::steady_clock;
+
+// the name has to outlive the instrumentor, which is the case for the static names of PA_PROFILE_SCOPE
+struct TraceEvent
 {
-public:
-	PA_SINGLETON(Instrumentor);
+	const char* Name;
+	TraceClock::rep Start;
+	TraceClock::rep End;
+};
 
-	void WriteResult(const ProfileResult& result)
-	{
-		std::lock_guard<std::mutex> lock(m_mutex);
+// a fixed size ring of a single thread, only that thread pushes and only the flusher pops
+// a full ring drops the event instead of waiting, so a slow flusher never stalls the profiled code
+class TraceBuffer
+{
+public:
+	static constexpr size_t Capacity = 4096;
 
-		LOG_INFO("Name: {}, TID: {}, Start: {}, Duration: {}",
-			result.name, result.threadId, result.startTime.count(), result.elapsedTime.count());
+	explicit TraceBuffer(uint32_t threadId) : m_threadId(threadId) {}
 
-		if (m_timings.contains(result.name.data()))
-			m_timings[result.name.data()].push_back(result.elapsedTime.count());
-		m_timings.insert({result.name.data(), std::vector{ result.elapsedTime.count() }});
+	void Push(const TraceEvent& event)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) == Capacity)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		m_events[head % Capacity] = event;
+		m_head.store(head + 1, std::memory_order_release);
 	}
 
-private:
-	Instrumentor() = default;
-	~Instrumentor()
+	template<typename Func>
+	void Drain(Func&& func)
 	{
-		AsciiTable<std::string, MicrosRep, MicrosRep, MicrosRep, MicrosRep, size_t> table({ "Name", "Average", "Min", "Max", "Total", "Runs" });
-
-		for (auto& [name, timings] : m_timings)
+		const size_t head = m_head.load(std::memory_order_acquire);
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		for (; tail != head; tail++)
 		{
-			MicrosRep total = std::accumulate(timings.begin(), timings.end(), MicrosRep{ 0 });
-			MicrosRep avg = total / static_cast<MicrosRep>(timings.size());
-			MicrosRep min = *std::ranges::min_element(timings);
-			MicrosRep max = *std::ranges::max_element(timings);
-			table.AddRow(name, avg, min, max, total, timings.size());
+			func(m_events[tail % Capacity]);
 		}
+		m_tail.store(tail, std::memory_order_release);
+	}
 
-		table.SortByColumn<1>(SortOrder::Descending);
+	[[nodiscard]] uint32_t ThreadId() const
+	{
+		return m_threadId;
+	}
 
-		std::stringstream stream;
-		table.Print(stream);
-		LOG_INFO("\n{}", stream.str());
+	[[nodiscard]] uint64_t TakeDropped()
+	{
+		return m_dropped.exchange(0, std::memory_order_relaxed);
 	}
-	std::mutex m_mutex;
-	std::unordered_map<std::string, std::vector<MicrosRep>> m_timings;
+
+	// set once the thread exited, the buffer is removed after it was drained a last time
+	std::atomic_bool Retired = false;
+
+private:
+	uint32_t m_threadId;
+	alignas(64) std::atomic<size_t> m_head = 0;
+	alignas(64) std::atomic<size_t> m_tail = 0;
+	std::atomic<uint64_t> m_dropped = 0;
+	std::array<TraceEvent, Capacity> m_events;
 };
 
-class Timer
+// collects the profiled scopes of all threads without any locks on the hot path
+// a background thread drains the buffers of all threads, keeps the statistics for the summary on exit
+// and appends the events to the trace file, which can be opened in chrome://tracing or ui.perfetto.dev
+class Instrumentor
 {
 public:
-	Timer() = delete;
-	explicit Timer(std::string_view name) : m_name(name), m_running(true), m_startTime(std::chrono::steady_clock::now()) {}
-	Timer(const Timer&) = delete;
-	Timer(Timer&&) = delete;
-	Timer& operator=(Timer&) = delete;
-	Timer& operator=(Timer&&) = delete;
-
-	[[nodiscard]] MicrosRep Elapsed() const
+	PA_SINGLETON(Instrumentor);
+
+	bool BeginTrace(const std::filesystem::path& path);
+	void EndTrace();
+
+	void Record(const char* name, TraceClock::time_point start, TraceClock::time_point end)
 	{
-		if (m_running)
-		{
-			return (std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()).time_since_epoch() -
-					std::chrono::time_point_cast<std::chrono::microseconds>(m_startTime).time_since_epoch()).count();
-		}
-		return 0;
+		if (!s_buffer)
+			s_buffer = RegisterThread();
+		s_buffer->Push({ name, start.time_since_epoch().count(), end.time_since_epoch().count() });
 	}
 
-	~Timer()
-	{
-		if (m_running)
-		{
-			auto endTime = std::chrono::steady_clock::now();
+private:
+	Instrumentor();
+	~Instrumentor();
+
+	TraceBuffer* RegisterThread();
+	void RunFlusher();
+	void Flush();
+	void LogSummary() const;
+
+	static thread_local TraceBuffer* s_buffer;
+
+	const TraceClock::time_point m_epoch = TraceClock::now();
+
+	std::mutex m_buffersMutex;
+	std::vector<std::shared_ptr<TraceBuffer>> m_buffers;
+	uint32_t m_nextThreadId = 1;
+
+	// only touched by the flusher, which holds the flush mutex
+	std::mutex m_flushMutex;
+	std::unordered_map<std::string_view, Histogram> m_stats;
+	uint64_t m_dropped = 0;
+	File m_traceFile;
+	bool m_traceHasEvents = false;
+	std::string m_traceChunk;
+
+	std::mutex m_flusherMutex;
+	std::condition_variable m_flusherCondition;
+	bool m_isStopping = false;
+	std::thread m_flusher;
+};
 
-			auto elapsed = std::chrono::time_point_cast<std::chrono::microseconds>(endTime).time_since_epoch() -
-				std::chrono::time_point_cast<std::chrono::microseconds>(m_startTime).time_since_epoch();
+class ScopeTimer
+{
+public:
+	explicit ScopeTimer(const char* name) : m_name(name), m_start(TraceClock::now()) {}
 
-			m_running = false;
+	ScopeTimer(const ScopeTimer&) = delete;
+	ScopeTimer(ScopeTimer&&) = delete;
+	ScopeTimer& operator=(const ScopeTimer&) = delete;
+	ScopeTimer& operator=(ScopeTimer&&) = delete;
 
-			Instrumentor::Instance().WriteResult({ m_name, Micros{ m_startTime.time_since_epoch() }, elapsed, std::this_thread::get_id() });
-		}
+	~ScopeTimer()
+	{
+		Instrumentor::Instance().Record(m_name, m_start, TraceClock::now());
 	}
+
 private:
-	std::string m_name;
-	bool m_running;
-	std::chrono::time_point<std::chrono::steady_clock> m_startTime;
+	const char* m_name;
+	TraceClock::time_point m_start;
 };
 
 }  // namespace PotatoAlert::Core
 
 #ifdef PA_PROFILE
 
-#define PA_PROFILE_SCOPE_LINE(name, line) ::core::Timer timer##line(::core::String::ReplaceAll(::core::String::ReplaceAll(name, "__cdecl ", ""), "PotatoAlert::", ""))
+#define PA_PROFILE_SCOPE_LINE(name, line)                                                                 \
+	static constexpr ::PotatoAlert::Core::Detail::ScopeName<sizeof(name)> PA_CAT(paScopeName, line)(name); \
+	const ::PotatoAlert::Core::ScopeTimer PA_CAT(paScopeTimer, line)(PA_CAT(paScopeName, line).CStr())
 #define PA_PROFILE_SCOPE(name) PA_PROFILE_SCOPE_LINE(name, __LINE__)
 #define PA_PROFILE_FUNCTION() PA_PROFILE_SCOPE(PA_FUNC_SIG)
+#define PA_PROFILE_TRACE(path) ::PotatoAlert::Core::Instrumentor::Instance().BeginTrace(path)
 
 #else
 
 #define PA_PROFILE_SCOPE_LINE(name, line)
 #define PA_PROFILE_SCOPE(name)
 #define PA_PROFILE_FUNCTION()
+#define PA_PROFILE_TRACE(path)
 
 #endif
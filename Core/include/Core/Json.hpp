@@ -12,17 +12,24 @@ namespace rapidjson {
 #define RAPIDJSON_HAS_STDSTRING 1
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
+#include <rapidjson/memorystream.h>
 #include <rapidjson/prettywriter.h>
 #include <rapidjson/rapidjson.h>
+#include <rapidjson/reader.h>
 #include <rapidjson/writer.h>
 
 #include <array>
 #include <cstdint>
 #include <expected>
+#include <optional>
 #include <ranges>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #ifdef WIN32
@@ -432,6 +439,9 @@ inline constexpr bool is_specialization<T<Args...>, T> = true;
 template<class T>
 concept is_vector = is_specialization<T, std::vector>;
 
+template<class T>
+concept is_optional = is_specialization<T, std::optional>;
+
 template<typename T>
 concept is_deserializable_vec = is_vector<T> && is_primitive_serializable<typename T::value_type>;
 
@@ -525,6 +535,498 @@ static inline JsonResult<void> FromJson(const rapidjson::Value& json, std::strin
 	return {};
 }
 
+// json text that is kept as is instead of being deserialized, e.g. to store it alongside the parsed values
+struct JsonRaw
+{
+	std::string Json;
+};
+
+// the schema of a struct for ReadJson, specialize it with the members that are read from the object:
+// static constexpr auto Fields = std::make_tuple(JsonField("name", &T::Name), ...);
+// keys that are not part of it are skipped, missing keys are an error unless the member is a std::optional
+// or the field is passed required = false, a missing JsonRaw is left empty
+template<typename T>
+struct JsonObject;
+
+template<typename Class, typename Member>
+struct JsonField
+{
+	std::string_view Key;
+	Member Class::* Pointer;
+	bool Required;
+
+	constexpr JsonField(std::string_view key, Member Class::* pointer, bool required = !is_optional<Member>)
+		: Key(key), Pointer(pointer), Required(required) {}
+};
+
+// custom value types, specialize it with static constexpr Sax::SinkOps Ops
+// or with static Sax::Sink SinkFor(T&) for a type whose members are only known to its own translation unit
+template<typename T>
+struct JsonSax;
+
+namespace Sax {
+
+struct Sink;
+
+// the events a value accepts, the ones it does not handle are a type mismatch
+struct SinkOps
+{
+	bool (*Null)(void* target) = nullptr;
+	bool (*Bool)(void* target, bool value) = nullptr;
+	bool (*Int)(void* target, int64_t value) = nullptr;
+	bool (*Uint)(void* target, uint64_t value) = nullptr;
+	bool (*Double)(void* target, double value) = nullptr;
+	bool (*String)(void* target, std::string_view value) = nullptr;
+	bool (*StartObject)(void* target) = nullptr;
+	Sink (*Key)(void* target, std::string_view key, size_t& field) = nullptr;
+	std::optional<std::string_view> (*MissingKey)(uint64_t seenFields) = nullptr;
+	bool (*StartArray)(void* target) = nullptr;
+	Sink (*Element)(void* target, size_t index) = nullptr;
+	bool (*EndArray)(void* target, size_t count) = nullptr;  // optional, checks the number of elements
+};
+
+// where the next value goes, the value is also written to capture as json text if it is set
+struct Sink
+{
+	void* Target = nullptr;
+	const SinkOps* Ops = nullptr;
+	std::string* Capture = nullptr;
+};
+
+static constexpr size_t NoField = static_cast<size_t>(-1);
+
+inline constexpr SinkOps SkipOps =
+{
+	.Null = [](void*) { return true; },
+	.Bool = [](void*, bool) { return true; },
+	.Int = [](void*, int64_t) { return true; },
+	.Uint = [](void*, uint64_t) { return true; },
+	.Double = [](void*, double) { return true; },
+	.String = [](void*, std::string_view) { return true; },
+	.StartObject = [](void*) { return true; },
+	.Key = [](void*, std::string_view, size_t&) { return Sink{ nullptr, &SkipOps }; },
+	.StartArray = [](void*) { return true; },
+	.Element = [](void*, size_t) { return Sink{ nullptr, &SkipOps }; },
+};
+
+template<typename T>
+constexpr SinkOps MakeOps();
+
+template<typename T>
+inline constexpr SinkOps OpsFor = MakeOps<T>();
+
+template<typename T>
+Sink SinkFor(T& value)
+{
+	if constexpr (std::is_same_v<T, JsonRaw>)
+	{
+		return { nullptr, &SkipOps, &value.Json };
+	}
+	else if constexpr (requires { JsonSax<T>::SinkFor(value); })
+	{
+		return JsonSax<T>::SinkFor(value);
+	}
+	else
+	{
+		return { &value, &OpsFor<T> };
+	}
+}
+
+template<typename T, size_t... I>
+Sink FindField(T& object, std::string_view key, size_t& field, std::index_sequence<I...>)
+{
+	constexpr auto& fields = JsonObject<T>::Fields;
+	Sink sink = { nullptr, &SkipOps };
+	((std::get<I>(fields).Key == key && (sink = SinkFor(object.*std::get<I>(fields).Pointer), field = I, true)) || ...);
+	return sink;
+}
+
+template<typename T, size_t... I>
+std::optional<std::string_view> FindMissingField(uint64_t seenFields, std::index_sequence<I...>)
+{
+	constexpr auto& fields = JsonObject<T>::Fields;
+	std::optional<std::string_view> missing;
+	((std::get<I>(fields).Required && !(seenFields & (1ull << I)) && (missing = std::get<I>(fields).Key, true)) || ...);
+	return missing;
+}
+
+// values that are present are parsed into the optional, null resets it
+template<typename T>
+T& Emplace(void* target)
+{
+	std::optional<T>& optional = *static_cast<std::optional<T>*>(target);
+	if (!optional)
+		optional.emplace();
+	return *optional;
+}
+
+template<typename T>
+constexpr SinkOps MakeOps()
+{
+	SinkOps ops;
+	if constexpr (requires { JsonSax<T>::Ops; })
+	{
+		ops = JsonSax<T>::Ops;
+	}
+	else if constexpr (is_bool<T>)
+	{
+		ops.Bool = [](void* target, bool value) { *static_cast<T*>(target) = value; return true; };
+	}
+	else if constexpr (std::is_integral_v<T>)
+	{
+		ops.Int = [](void* target, int64_t value)
+		{
+			if (!std::in_range<T>(value))
+				return false;
+			*static_cast<T*>(target) = static_cast<T>(value);
+			return true;
+		};
+		ops.Uint = [](void* target, uint64_t value)
+		{
+			if (!std::in_range<T>(value))
+				return false;
+			*static_cast<T*>(target) = static_cast<T>(value);
+			return true;
+		};
+	}
+	else if constexpr (std::is_floating_point_v<T>)
+	{
+		ops.Int = [](void* target, int64_t value) { *static_cast<T*>(target) = static_cast<T>(value); return true; };
+		ops.Uint = [](void* target, uint64_t value) { *static_cast<T*>(target) = static_cast<T>(value); return true; };
+		ops.Double = [](void* target, double value) { *static_cast<T*>(target) = static_cast<T>(value); return true; };
+	}
+	else if constexpr (is_std_string<T>)
+	{
+		ops.String = [](void* target, std::string_view value) { static_cast<T*>(target)->assign(value); return true; };
+	}
+	else if constexpr (std::is_enum_v<T>)
+	{
+		// needs the FromJson(std::string_view, T&) of PA_JSON_SERIALIZE_ENUM
+		ops.String = [](void* target, std::string_view value) { return FromJson(value, *static_cast<T*>(target)); };
+	}
+	else if constexpr (is_optional<T>)
+	{
+		using V = typename T::value_type;
+
+		// the value is only emplaced once it is known to accept the event
+		ops.Null = [](void* target) { static_cast<T*>(target)->reset(); return true; };
+		ops.Bool = [](void* target, bool value)
+		{
+			return OpsFor<V>.Bool && OpsFor<V>.Bool(&Emplace<V>(target), value);
+		};
+		ops.Int = [](void* target, int64_t value)
+		{
+			return OpsFor<V>.Int && OpsFor<V>.Int(&Emplace<V>(target), value);
+		};
+		ops.Uint = [](void* target, uint64_t value)
+		{
+			return OpsFor<V>.Uint && OpsFor<V>.Uint(&Emplace<V>(target), value);
+		};
+		ops.Double = [](void* target, double value)
+		{
+			return OpsFor<V>.Double && OpsFor<V>.Double(&Emplace<V>(target), value);
+		};
+		ops.String = [](void* target, std::string_view value)
+		{
+			return OpsFor<V>.String && OpsFor<V>.String(&Emplace<V>(target), value);
+		};
+		ops.StartObject = [](void* target)
+		{
+			return OpsFor<V>.StartObject && OpsFor<V>.StartObject(&Emplace<V>(target));
+		};
+		ops.Key = [](void* target, std::string_view key, size_t& field)
+		{
+			return OpsFor<V>.Key(&Emplace<V>(target), key, field);
+		};
+		ops.MissingKey = OpsFor<V>.MissingKey;
+		ops.StartArray = [](void* target)
+		{
+			return OpsFor<V>.StartArray && OpsFor<V>.StartArray(&Emplace<V>(target));
+		};
+		ops.Element = [](void* target, size_t index)
+		{
+			return OpsFor<V>.Element(&Emplace<V>(target), index);
+		};
+		ops.EndArray = [](void* target, size_t count)
+		{
+			return !OpsFor<V>.EndArray || OpsFor<V>.EndArray(&Emplace<V>(target), count);
+		};
+	}
+	else if constexpr (is_vector<T>)
+	{
+		ops.StartArray = [](void* target) { static_cast<T*>(target)->clear(); return true; };
+		ops.Element = [](void* target, size_t) { return SinkFor(static_cast<T*>(target)->emplace_back()); };
+	}
+	else if constexpr (requires { std::tuple_size<T>::value; typename T::value_type; })
+	{
+		// std::array, missing and surplus elements are an error
+		ops.StartArray = [](void*) { return true; };
+		ops.Element = [](void* target, size_t index)
+		{
+			T& array = *static_cast<T*>(target);
+			return index < array.size() ? SinkFor(array[index]) : Sink{};
+		};
+		ops.EndArray = [](void*, size_t count) { return count == std::tuple_size_v<T>; };
+	}
+	else if constexpr (requires { JsonObject<T>::Fields; })
+	{
+		constexpr size_t fieldCount = std::tuple_size_v<std::decay_t<decltype(JsonObject<T>::Fields)>>;
+		static_assert(fieldCount <= 64, "JsonObject can have at most 64 fields");
+
+		ops.StartObject = [](void*) { return true; };
+		ops.Key = [](void* target, std::string_view key, size_t& field)
+		{
+			return FindField(*static_cast<T*>(target), key, field, std::make_index_sequence<fieldCount>());
+		};
+		ops.MissingKey = [](uint64_t seenFields)
+		{
+			return FindMissingField<T>(seenFields, std::make_index_sequence<fieldCount>());
+		};
+	}
+	else
+	{
+		static_assert(sizeof(T) == 0, "Type can not be read from json, add a JsonObject or JsonSax for it");
+	}
+	return ops;
+}
+
+// turns the reader events into writes to the sinks, the stack only holds the objects and arrays that are open
+class Handler
+{
+public:
+	explicit Handler(Sink root) : m_root(root) {}
+
+	bool Null()
+	{
+		return Scalar("null", [](const Sink& s) { return s.Ops->Null && s.Ops->Null(s.Target); },
+			[](auto& w) { return w.Null(); });
+	}
+
+	bool Bool(bool b)
+	{
+		return Scalar("bool", [b](const Sink& s) { return s.Ops->Bool && s.Ops->Bool(s.Target, b); },
+			[b](auto& w) { return w.Bool(b); });
+	}
+
+	bool Int(int i)
+	{
+		return Int64(i);
+	}
+
+	bool Uint(unsigned u)
+	{
+		return Uint64(u);
+	}
+
+	bool Int64(int64_t i)
+	{
+		return Scalar("integer", [i](const Sink& s) { return s.Ops->Int && s.Ops->Int(s.Target, i); },
+			[i](auto& w) { return w.Int64(i); });
+	}
+
+	bool Uint64(uint64_t u)
+	{
+		return Scalar("integer", [u](const Sink& s) { return s.Ops->Uint && s.Ops->Uint(s.Target, u); },
+			[u](auto& w) { return w.Uint64(u); });
+	}
+
+	bool Double(double d)
+	{
+		return Scalar("number", [d](const Sink& s) { return s.Ops->Double && s.Ops->Double(s.Target, d); },
+			[d](auto& w) { return w.Double(d); });
+	}
+
+	bool RawNumber(const char*, rapidjson::SizeType, bool)
+	{
+		return false;
+	}
+
+	bool String(const char* str, rapidjson::SizeType length, bool copy)
+	{
+		const std::string_view value(str, length);
+		return Scalar("string", [value](const Sink& s) { return s.Ops->String && s.Ops->String(s.Target, value); },
+			[str, length, copy](auto& w) { return w.String(str, length, copy); });
+	}
+
+	bool StartObject()
+	{
+		return Start(true);
+	}
+
+	bool Key(const char* str, rapidjson::SizeType length, bool copy)
+	{
+		if (m_capture && !m_writer.Key(str, length, copy))
+			return false;
+
+		Frame& frame = m_frames.back();
+		m_key.assign(str, length);
+		size_t field = NoField;
+		frame.Pending = frame.Container.Ops->Key(frame.Container.Target, m_key, field);
+		if (field < 64)
+			frame.SeenFields |= 1ull << field;
+		return true;
+	}
+
+	bool EndObject(rapidjson::SizeType count)
+	{
+		if (m_capture && !m_writer.EndObject(count))
+			return false;
+
+		const Frame frame = m_frames.back();
+		m_frames.pop_back();
+		if (frame.Container.Ops->MissingKey)
+		{
+			if (const std::optional<std::string_view> missing = frame.Container.Ops->MissingKey(frame.SeenFields))
+			{
+				m_error = fmt::format("Json object has no key '{}'", *missing);
+				return false;
+			}
+		}
+		return End();
+	}
+
+	bool StartArray()
+	{
+		return Start(false);
+	}
+
+	bool EndArray(rapidjson::SizeType count)
+	{
+		if (m_capture && !m_writer.EndArray(count))
+			return false;
+
+		const Frame frame = m_frames.back();
+		m_frames.pop_back();
+		if (frame.Container.Ops->EndArray && !frame.Container.Ops->EndArray(frame.Container.Target, count))
+		{
+			m_error = fmt::format("Unexpected json array length {} after key '{}'", count, m_key);
+			return false;
+		}
+		return End();
+	}
+
+	JsonResult<void> Finish(const rapidjson::ParseResult& result) const
+	{
+		if (!m_error.empty())
+			return PA_JSON_ERROR("{}", m_error);
+		if (result.IsError())
+			return PA_JSON_ERROR("Json parse error: {} ({})", GetParseError_En(result.Code()), result.Offset());
+		return {};
+	}
+
+private:
+	struct Frame
+	{
+		Sink Container;
+		Sink Pending = {};
+		uint64_t SeenFields = 0;
+		size_t Count = 0;
+		bool IsObject = false;
+	};
+
+	Sink NextSink()
+	{
+		if (m_frames.empty())
+			return std::exchange(m_root, Sink{});
+
+		Frame& frame = m_frames.back();
+		if (frame.IsObject)
+			return frame.Pending;
+		return frame.Container.Ops->Element(frame.Container.Target, frame.Count++);
+	}
+
+	void BeginCapture(const Sink& sink)
+	{
+		if (m_capture || !sink.Capture)
+			return;
+
+		m_capture = sink.Capture;
+		m_captureDepth = m_frames.size();
+		m_buffer.Clear();
+		m_writer.Reset(m_buffer);
+	}
+
+	bool End()
+	{
+		if (m_capture && m_captureDepth == m_frames.size())
+		{
+			m_capture->assign(m_buffer.GetString(), m_buffer.GetSize());
+			m_capture = nullptr;
+		}
+		return true;
+	}
+
+	bool Fail(std::string_view type)
+	{
+		if (m_frames.empty())
+			m_error = fmt::format("Unexpected json {}", type);
+		else if (m_frames.back().IsObject)
+			m_error = fmt::format("Unexpected json {} for key '{}'", type, m_key);
+		else
+			m_error = fmt::format("Unexpected json {} in array after key '{}'", type, m_key);
+		return false;
+	}
+
+	template<typename Apply, typename Write>
+	bool Scalar(std::string_view type, Apply&& apply, Write&& write)
+	{
+		const Sink sink = NextSink();
+		BeginCapture(sink);
+		if (m_capture && !write(m_writer))
+			return false;
+		if (!sink.Ops || !apply(sink))
+			return Fail(type);
+		return End();
+	}
+
+	bool Start(bool isObject)
+	{
+		const Sink sink = NextSink();
+		BeginCapture(sink);
+		if (m_capture && !(isObject ? m_writer.StartObject() : m_writer.StartArray()))
+			return false;
+
+		const auto start = sink.Ops ? (isObject ? sink.Ops->StartObject : sink.Ops->StartArray) : nullptr;
+		if (!start || !start(sink.Target))
+			return Fail(isObject ? "object" : "array");
+
+		m_frames.push_back(Frame{ .Container = sink, .IsObject = isObject });
+		return true;
+	}
+
+	Sink m_root;
+	std::vector<Frame> m_frames;
+	std::string m_key;
+	std::string m_error;
+
+	std::string* m_capture = nullptr;
+	size_t m_captureDepth = 0;
+	rapidjson::StringBuffer m_buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> m_writer;
+};
+
+}  // namespace Sax
+
+// fills the value straight from the reader events, without building a document first
+template<typename T>
+static inline JsonResult<void> ReadJson(std::string_view json, T& value)
+{
+	Sax::Handler handler(Sax::SinkFor(value));
+	rapidjson::MemoryStream stream(json.data(), json.size());
+	rapidjson::Reader reader;
+	return handler.Finish(reader.Parse(stream, handler));
+}
+
+// like ReadJson, but the strings are decoded in place, json has to be null terminated and is overwritten
+template<typename T>
+static inline JsonResult<void> ReadJsonInSitu(char* json, T& value)
+{
+	Sax::Handler handler(Sax::SinkFor(value));
+	rapidjson::InsituStringStream stream(json);
+	rapidjson::Reader reader;
+	return handler.Finish(reader.Parse<rapidjson::kParseInsituFlag>(stream, handler));
+}
+
 #define PA_JSON_SERIALIZE_ENUM(ENUM_TYPE, ...)                                                              \
 	template<typename OutputStream = rapidjson::StringBuffer>                                               \
 	[[maybe_unused]] inline bool ToJson(rapidjson::Writer<OutputStream>& writer, const ENUM_TYPE& e)        \
@@ -549,13 +1051,10 @@ static inline JsonResult<void> FromJson(const rapidjson::Value& json, std::strin
 									   });                                                                  \
 		return ::PotatoAlert::Core::ToRef((it != std::end(m) ? it : std::begin(m))->second);                \
 	}                                                                                                       \
-	[[maybe_unused]] inline bool FromJson(const rapidjson::Value& j, ENUM_TYPE& e)                          \
+	[[maybe_unused]] inline bool FromJson(std::string_view key, ENUM_TYPE& e)                               \
 	{                                                                                                       \
 		static_assert(std::is_enum_v<ENUM_TYPE>, #ENUM_TYPE " must be an enum!");                           \
 		static const std::pair<ENUM_TYPE, std::string_view> m[] = __VA_ARGS__;                              \
-		if (!j.IsString())                                                                                  \
-			return false;                                                                                   \
-		std::string_view key = j.GetString();                                                               \
 		auto it = std::ranges::find_if(m,                                                                   \
 									   [key](const std::pair<ENUM_TYPE, std::string_view>& ej_pair) -> bool \
 									   {                                                                    \
@@ -565,6 +1064,12 @@ static inline JsonResult<void> FromJson(const rapidjson::Value& json, std::strin
 			return false;                                                                                   \
 		e = it->first;                                                                                      \
 		return true;                                                                                        \
+	}                                                                                                       \
+	[[maybe_unused]] inline bool FromJson(const rapidjson::Value& j, ENUM_TYPE& e)                          \
+	{                                                                                                       \
+		if (!j.IsString())                                                                                  \
+			return false;                                                                                   \
+		return FromJson(std::string_view(j.GetString(), j.GetStringLength()), e);                           \
 	}
 
 #define PA_JSON_SERIALIZE_ENUM_PAIRS(ENUM_TYPE, PAIRS)                                                          \
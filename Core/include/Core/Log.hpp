@@ -17,7 +17,15 @@
 #ifndef SPDLOG_NO_EXCEPTIONS
 	#define SPDLOG_NO_EXCEPTIONS
 #endif
-#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+// the lowest level that is compiled in, set for the whole build (see cmake/LogLevel.cmake)
+#ifndef PA_LOG_ACTIVE_LEVEL
+	#ifdef NDEBUG
+		#define PA_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+	#else
+		#define PA_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+	#endif
+#endif
+#define SPDLOG_ACTIVE_LEVEL PA_LOG_ACTIVE_LEVEL
 #include <spdlog/spdlog.h>
 
 #include <filesystem>
@@ -27,19 +35,38 @@
 
 namespace PotatoAlert::Core {
 
+// everything up to warnings is queued and written by a background thread, so logging never waits for the disk
+// errors are written and flushed right away to the same sinks, so they survive a crash right after them
+// but can end up in the file before messages that were logged earlier and are still queued
 class Log
 {
 public:
 	static void Init(const std::filesystem::path& logFile);
 	static std::shared_ptr<spdlog::logger>& GetLogger() { return s_logger; }
+	static std::shared_ptr<spdlog::logger>& GetErrorLogger() { return s_errorLogger; }
 
 private:
 	static std::shared_ptr<spdlog::logger> s_logger;
+	static std::shared_ptr<spdlog::logger> s_errorLogger;
 };
 
 }  // namespace PotatoAlert::Core
 
-#define LOG_TRACE(...) SPDLOG_LOGGER_TRACE(::PotatoAlert::Core::Log::GetLogger(), __VA_ARGS__)
-#define LOG_INFO(...)  SPDLOG_LOGGER_INFO(::PotatoAlert::Core::Log::GetLogger(), __VA_ARGS__)
-#define LOG_WARN(...)  SPDLOG_LOGGER_WARN(::PotatoAlert::Core::Log::GetLogger(), __VA_ARGS__)
-#define LOG_ERROR(...) SPDLOG_LOGGER_ERROR(::PotatoAlert::Core::Log::GetLogger(), __VA_ARGS__)
+// the arguments are only evaluated if the logger would write the message, so they can be expensive to format
+// calls below the active level are compiled out, but still type checked so their arguments never become unused
+#define PA_LOG_CALL(logger, level, ...)                                              \
+	do                                                                               \
+	{                                                                                \
+		if constexpr (PA_LOG_ACTIVE_LEVEL <= static_cast<int>(level))                \
+		{                                                                            \
+			if (const auto& paLogger = (logger); paLogger->should_log(level))        \
+			{                                                                        \
+				SPDLOG_LOGGER_CALL(paLogger, level, __VA_ARGS__);                    \
+			}                                                                        \
+		}                                                                            \
+	} while (0)
+
+#define LOG_TRACE(...) PA_LOG_CALL(::PotatoAlert::Core::Log::GetLogger(), ::spdlog::level::trace, __VA_ARGS__)
+#define LOG_INFO(...)  PA_LOG_CALL(::PotatoAlert::Core::Log::GetLogger(), ::spdlog::level::info, __VA_ARGS__)
+#define LOG_WARN(...)  PA_LOG_CALL(::PotatoAlert::Core::Log::GetLogger(), ::spdlog::level::warn, __VA_ARGS__)
+#define LOG_ERROR(...) PA_LOG_CALL(::PotatoAlert::Core::Log::GetErrorLogger(), ::spdlog::level::err, __VA_ARGS__)
@@ -0,0 +1,204 @@
+// Copyright 2025 <github.com/razaqq>
+#pragma once
+
+#include "Core/Preprocessor.hpp"
+#include "Core/Singleton.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+
+namespace PotatoAlert::Core {
+
+// a log-linear histogram like hdr histogram: every power of two is split into SubBucketCount buckets
+// so the percentiles are accurate to about 6% over the whole range of uint64_t, recording is a few relaxed atomics
+class Histogram
+{
+public:
+	static constexpr uint32_t SubBucketBits = 4;
+	static constexpr uint32_t SubBucketCount = 1u << SubBucketBits;
+	static constexpr size_t BucketCount = (64 - SubBucketBits + 1) * SubBucketCount;
+
+	Histogram() = default;
+	Histogram(const Histogram&) = delete;
+	Histogram& operator=(const Histogram&) = delete;
+
+	void Record(uint64_t value)
+	{
+		m_buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(value, std::memory_order_relaxed);
+
+		uint64_t max = m_max.load(std::memory_order_relaxed);
+		while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+		uint64_t min = m_min.load(std::memory_order_relaxed);
+		while (value < min && !m_min.compare_exchange_weak(min, value, std::memory_order_relaxed)) {}
+	}
+
+	[[nodiscard]] uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+	[[nodiscard]] uint64_t Sum() const { return m_sum.load(std::memory_order_relaxed); }
+	[[nodiscard]] uint64_t Max() const { return m_max.load(std::memory_order_relaxed); }
+	[[nodiscard]] uint64_t Min() const { return Count() ? m_min.load(std::memory_order_relaxed) : 0; }
+
+	[[nodiscard]] uint64_t Mean() const
+	{
+		const uint64_t count = Count();
+		return count ? Sum() / count : 0;
+	}
+
+	// the highest value of the bucket the percentile falls into, percentile is in [0, 100]
+	[[nodiscard]] uint64_t Percentile(double percentile) const;
+
+	static constexpr size_t BucketIndex(uint64_t value)
+	{
+		if (value < SubBucketCount)
+			return static_cast<size_t>(value);
+
+		const uint32_t shift = static_cast<uint32_t>(std::bit_width(value)) - 1 - SubBucketBits;
+		return (shift + 1) * SubBucketCount + static_cast<size_t>((value >> shift) - SubBucketCount);
+	}
+
+	static constexpr uint64_t BucketUpperBound(size_t index)
+	{
+		if (index < SubBucketCount)
+			return index;
+
+		const uint32_t shift = static_cast<uint32_t>(index / SubBucketCount) - 1;
+		const uint64_t sub = index % SubBucketCount + SubBucketCount;
+		return ((sub + 1) << shift) - 1;
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, BucketCount> m_buckets{};
+	std::atomic<uint64_t> m_count = 0;
+	std::atomic<uint64_t> m_sum = 0;
+	std::atomic<uint64_t> m_min = std::numeric_limits<uint64_t>::max();
+	std::atomic<uint64_t> m_max = 0;
+};
+
+// only ever goes up, e.g. bytes inflated or rows written
+class Counter
+{
+public:
+	void Add(uint64_t value = 1)
+	{
+		m_value.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] uint64_t Value() const
+	{
+		return m_value.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> m_value = 0;
+};
+
+// the current value of something, e.g. a queue depth
+class Gauge
+{
+public:
+	void Set(int64_t value)
+	{
+		m_value.store(value, std::memory_order_relaxed);
+	}
+
+	void Add(int64_t value)
+	{
+		m_value.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] int64_t Value() const
+	{
+		return m_value.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<int64_t> m_value = 0;
+};
+
+// the named metrics of the whole application, they live until exit so references to them can be cached
+// latencies are recorded in nanoseconds by LatencyTimer and printed in microseconds
+class Metrics
+{
+public:
+	PA_SINGLETON(Metrics);
+
+	Counter& GetCounter(std::string_view name);
+	Gauge& GetGauge(std::string_view name);
+	Histogram& GetHistogram(std::string_view name);
+
+	[[nodiscard]] std::string Format() const;
+	void Log() const;
+	bool WriteToFile(const std::filesystem::path& path) const;
+
+private:
+	Metrics() = default;
+	~Metrics() = default;
+
+	mutable std::mutex m_mutex;
+	std::map<std::string, std::unique_ptr<Counter>, std::less<>> m_counters;
+	std::map<std::string, std::unique_ptr<Gauge>, std::less<>> m_gauges;
+	std::map<std::string, std::unique_ptr<Histogram>, std::less<>> m_histograms;
+};
+
+class LatencyTimer
+{
+public:
+	explicit LatencyTimer(Histogram& histogram) : m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {}
+
+	LatencyTimer(const LatencyTimer&) = delete;
+	LatencyTimer(LatencyTimer&&) = delete;
+	LatencyTimer& operator=(const LatencyTimer&) = delete;
+	LatencyTimer& operator=(LatencyTimer&&) = delete;
+
+	~LatencyTimer()
+	{
+		m_histogram.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count()));
+	}
+
+private:
+	Histogram& m_histogram;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+}  // namespace PotatoAlert::Core
+
+// the metrics are looked up once per call site, afterwards only the atomics are touched
+#define PA_METRIC_COUNT(name, value)                                                                              \
+	do                                                                                                            \
+	{                                                                                                             \
+		static ::PotatoAlert::Core::Counter& paCounter = ::PotatoAlert::Core::Metrics::Instance().GetCounter(name); \
+		paCounter.Add(value);                                                                                     \
+	} while (0)
+
+#define PA_METRIC_GAUGE_SET(name, value)                                                                       \
+	do                                                                                                         \
+	{                                                                                                          \
+		static ::PotatoAlert::Core::Gauge& paGauge = ::PotatoAlert::Core::Metrics::Instance().GetGauge(name); \
+		paGauge.Set(value);                                                                                    \
+	} while (0)
+
+#define PA_METRIC_GAUGE_ADD(name, value)                                                                       \
+	do                                                                                                         \
+	{                                                                                                          \
+		static ::PotatoAlert::Core::Gauge& paGauge = ::PotatoAlert::Core::Metrics::Instance().GetGauge(name); \
+		paGauge.Add(value);                                                                                    \
+	} while (0)
+
+#define PA_METRIC_LATENCY_LINE(name, line)                                                                                                  \
+	static ::PotatoAlert::Core::Histogram& PA_CAT(paHistogram, line) = ::PotatoAlert::Core::Metrics::Instance().GetHistogram(name); \
+	const ::PotatoAlert::Core::LatencyTimer PA_CAT(paLatencyTimer, line)(PA_CAT(paHistogram, line))
+#define PA_METRIC_LATENCY(name) PA_METRIC_LATENCY_LINE(name, __LINE__)
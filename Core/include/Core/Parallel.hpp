@@ -0,0 +1,283 @@
+// Copyright 2025 <github.com/razaqq>
+#pragma once
+
+#include "Core/ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace PotatoAlert::Core {
+
+// the calling thread always works on the loop itself, the pool only adds helpers to it
+// this keeps nested loops from deadlocking, even if every worker of the pool is busy running the outer loop
+namespace Detail {
+
+struct ParallelLoopState
+{
+	std::atomic<size_t> Next = 0;
+	std::atomic<size_t> Remaining;
+
+	explicit ParallelLoopState(size_t chunks) : Remaining(chunks) {}
+};
+
+inline size_t ChunkCount(size_t count, size_t grainSize)
+{
+	return (count + grainSize - 1) / grainSize;
+}
+
+// a few chunks per thread, so threads that finish early can take some of the work of slower ones
+inline size_t DefaultGrainSize(const ThreadPool& pool, size_t count)
+{
+	return std::max<size_t>(1, count / ((pool.ThreadCount() + 1) * 4));
+}
+
+// runs chunk(i) for every chunk index, helpers that start after all chunks were taken return right away
+template<typename Chunk>
+void RunChunks(ThreadPool& pool, size_t chunks, Chunk& chunk)
+{
+	if (chunks == 0)
+		return;
+
+	if (chunks == 1)
+	{
+		chunk(0);
+		return;
+	}
+
+	auto state = std::make_shared<ParallelLoopState>(chunks);
+	auto work = [state, &chunk, chunks]()
+	{
+		size_t i;
+		while ((i = state->Next.fetch_add(1, std::memory_order_relaxed)) < chunks)
+		{
+			chunk(i);
+			if (state->Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				state->Remaining.notify_all();
+			}
+		}
+	};
+
+	// the chunk is only called by helpers which took a chunk, those are always waited for
+	const size_t helpers = std::min(chunks - 1, pool.ThreadCount());
+	for (size_t i = 0; i < helpers; i++)
+	{
+		pool.Submit(work);
+	}
+	work();
+
+	size_t remaining;
+	while ((remaining = state->Remaining.load(std::memory_order_acquire)) > 0)
+	{
+		state->Remaining.wait(remaining, std::memory_order_acquire);
+	}
+}
+
+// the stages of one item run back to back in the same task, the intermediate values are moved along
+template<typename T>
+std::decay_t<T> ApplyStages(T&& value)
+{
+	return std::forward<T>(value);
+}
+
+template<typename T, typename Stage, typename... Stages>
+auto ApplyStages(T&& value, Stage& stage, Stages&... stages)
+{
+	return ApplyStages(std::invoke(stage, std::forward<T>(value)), stages...);
+}
+
+}  // namespace Detail
+
+// calls func(i) for every i in [begin, end), grainSize indices are handed to a thread at once, 0 picks one
+template<typename Func>
+void ParallelFor(ThreadPool& pool, size_t begin, size_t end, Func&& func, size_t grainSize = 0)
+{
+	if (end <= begin)
+		return;
+
+	const size_t count = end - begin;
+	const size_t grain = grainSize ? grainSize : Detail::DefaultGrainSize(pool, count);
+
+	auto chunk = [&](size_t i)
+	{
+		const size_t from = begin + i * grain;
+		const size_t to = std::min(end, from + grain);
+		for (size_t j = from; j < to; j++)
+		{
+			func(j);
+		}
+	};
+	Detail::RunChunks(pool, Detail::ChunkCount(count, grain), chunk);
+}
+
+// combines map(i) for every i in [begin, end) with reduce, which has to be associative
+// the partial results are combined in index order, so the result does not depend on the scheduling
+template<typename T, typename Map, typename Reduce>
+T ParallelReduce(ThreadPool& pool, size_t begin, size_t end, T identity, Map&& map, Reduce&& reduce, size_t grainSize = 0)
+{
+	if (end <= begin)
+		return identity;
+
+	const size_t count = end - begin;
+	const size_t grain = grainSize ? grainSize : Detail::DefaultGrainSize(pool, count);
+	const size_t chunks = Detail::ChunkCount(count, grain);
+
+	std::vector<T> partials(chunks, identity);
+	auto chunk = [&](size_t i)
+	{
+		const size_t from = begin + i * grain;
+		const size_t to = std::min(end, from + grain);
+		T partial = identity;
+		for (size_t j = from; j < to; j++)
+		{
+			partial = reduce(std::move(partial), map(j));
+		}
+		partials[i] = std::move(partial);
+	};
+	Detail::RunChunks(pool, chunks, chunk);
+
+	T result = std::move(identity);
+	for (T& partial : partials)
+	{
+		result = reduce(std::move(result), std::move(partial));
+	}
+	return result;
+}
+
+// output[i] = func(input[i]), the output has to be at least as large as the input
+template<typename In, typename Out, typename Func>
+void ParallelTransform(ThreadPool& pool, std::span<In> input, std::span<Out> output, Func&& func, size_t grainSize = 0)
+{
+	ParallelFor(pool, 0, std::min(input.size(), output.size()), [&](size_t i)
+	{
+		output[i] = func(input[i]);
+	}, grainSize);
+}
+
+// a bounded pipeline: the source is called one item at a time until it returns std::nullopt, every item is passed
+// through the stages in parallel and handed to the sink in the order of the source. at most maxInFlight items are
+// between the source and the sink at once, which bounds the memory of e.g. read -> decrypt -> inflate -> parse
+template<typename Source, typename Sink, typename... Stages>
+void ParallelPipeline(ThreadPool& pool, size_t maxInFlight, Source&& source, Sink&& sink, Stages&&... stages)
+{
+	using Item = typename std::invoke_result_t<Source&>::value_type;
+	using Result = decltype(Detail::ApplyStages(std::declval<Item>(), stages...));
+
+	struct State
+	{
+		std::mutex SourceMutex;
+		bool SourceDone = false;
+		size_t Taken = 0;
+
+		std::mutex SinkMutex;
+		std::map<size_t, Result> Ready;
+		size_t NextToSink = 0;
+		bool Sinking = false;
+		std::atomic<size_t> Sunk = 0;
+	};
+
+	maxInFlight = std::max<size_t>(maxInFlight, 1);
+	auto state = std::make_shared<State>();
+
+	// hands the result to the sink, whoever finds the next item in order drains as many as are ready
+	auto deliver = [&sink](State& s, size_t index, Result&& result)
+	{
+		{
+			std::unique_lock lock(s.SinkMutex);
+			s.Ready.emplace(index, std::move(result));
+			if (s.Sinking)
+				return;
+			s.Sinking = true;
+		}
+
+		while (true)
+		{
+			std::optional<Result> next;
+			{
+				std::unique_lock lock(s.SinkMutex);
+				auto it = s.Ready.find(s.NextToSink);
+				if (it == s.Ready.end())
+				{
+					s.Sinking = false;
+					return;
+				}
+				next.emplace(std::move(it->second));
+				s.Ready.erase(it);
+				s.NextToSink++;
+			}
+
+			sink(std::move(*next));
+			s.Sunk.fetch_add(1, std::memory_order_acq_rel);
+			s.Sunk.notify_all();
+		}
+	};
+
+	// helpers that start after the source is exhausted return without touching source, stages or sink
+	auto run = [state, &source, &deliver, &stages..., maxInFlight]()
+	{
+		State& s = *state;
+		while (true)
+		{
+			std::optional<Item> item;
+			size_t index;
+			{
+				std::unique_lock lock(s.SourceMutex);
+				if (s.SourceDone)
+					return;
+
+				// the oldest item is always held by a running thread, so the sink eventually catches up
+				size_t sunk;
+				while (s.Taken - (sunk = s.Sunk.load(std::memory_order_acquire)) >= maxInFlight)
+				{
+					lock.unlock();
+					s.Sunk.wait(sunk, std::memory_order_acquire);
+					lock.lock();
+					if (s.SourceDone)
+						return;
+				}
+
+				item = source();
+				if (!item)
+				{
+					s.SourceDone = true;
+					return;
+				}
+				index = s.Taken++;
+			}
+
+			deliver(s, index, Detail::ApplyStages(std::move(*item), stages...));
+		}
+	};
+
+	const size_t helpers = std::min(maxInFlight - 1, pool.ThreadCount());
+	for (size_t i = 0; i < helpers; i++)
+	{
+		pool.Submit(run);
+	}
+	run();
+
+	// the source is exhausted, wait for the items still in flight
+	size_t taken;
+	{
+		std::unique_lock lock(state->SourceMutex);
+		taken = state->Taken;
+	}
+	size_t sunk;
+	while ((sunk = state->Sunk.load(std::memory_order_acquire)) < taken)
+	{
+		state->Sunk.wait(sunk, std::memory_order_acquire);
+	}
+}
+
+}  // namespace PotatoAlert::Core
@@ -1,11 +1,18 @@
 // Copyright 2021 <github.com/razaqq>
 #pragma once
 
+#include "Core/Bytes.hpp"
 #include "Core/Flags.hpp"
 
 #include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 
 
@@ -40,11 +47,14 @@ public:
 		m_handle = Handle::Null;
 	}
 
-	explicit SQLite(Handle handle, std::filesystem::path path) : m_handle(handle), m_path(std::move(path)) {}
+	explicit SQLite(Handle handle, std::filesystem::path path)
+		: m_handle(handle), m_path(std::move(path)), m_statementCache(std::make_unique<StatementCache>()) {}
 
 	SQLite(SQLite&& src) noexcept
 	{
 		m_handle = std::exchange(src.m_handle, Handle::Null);
+		m_path = std::move(src.m_path);
+		m_statementCache = std::move(src.m_statementCache);
 	}
 
 	SQLite(const SQLite&) = delete;
@@ -52,8 +62,13 @@ public:
 	SQLite& operator=(SQLite&& src) noexcept
 	{
 		if (m_handle != Handle::Null)
+		{
+			m_statementCache.reset();
 			RawClose(m_handle);
+		}
 		m_handle = std::exchange(src.m_handle, Handle::Null);
+		m_path = std::move(src.m_path);
+		m_statementCache = std::move(src.m_statementCache);
 		return *this;
 	}
 
@@ -62,7 +77,10 @@ public:
 	~SQLite()
 	{
 		if (m_handle != Handle::Null)
+		{
+			m_statementCache.reset();
 			RawClose(m_handle);
+		}
 	}
 
 	[[nodiscard]] Handle GetHandle() const
@@ -82,6 +100,8 @@ public:
 
 	void Close()
 	{
+		// cached statements have to be finalized before the connection can be closed
+		m_statementCache.reset();
 		RawClose(std::exchange(m_handle, Handle::Null));
 	}
 
@@ -92,6 +112,10 @@ public:
 
 	[[nodiscard]] std::string GetLastError() const;
 	[[nodiscard]] int64_t GetLastRowId() const;
+	// false if the connection is in autocommit mode
+	[[nodiscard]] bool InTransaction() const;
+	// true for in-memory and temporary databases, which no other connection can open
+	[[nodiscard]] bool IsTemporary() const;
 
 	bool Execute(std::string_view sql) const
 	{
@@ -112,7 +136,8 @@ public:
 	struct Statement
 	{
 	public:
-		Statement(const SQLite& db, std::string_view sql);
+		// persistent statements are expected to be reused many times, e.g. by the statement cache
+		Statement(const SQLite& db, std::string_view sql, bool persistent = false);
 		~Statement();
 
 		Statement(Statement&&) = delete;
@@ -122,41 +147,110 @@ public:
 		
 		bool Bind(int index, int32_t value) const;
 		bool Bind(int index, uint32_t value) const;
+		bool Bind(int index, int64_t value) const;
 		bool Bind(int index, double value) const;
 		bool Bind(int index, const char* value) const;
 		bool Bind(int index, const std::string& value) const;
 		bool Bind(int index, std::string_view value) const;
+		bool Bind(int index, std::span<const Byte> value) const;
 
 		bool Bind(std::string_view name, int32_t value) const;
 		bool Bind(std::string_view name, uint32_t value) const;
+		bool Bind(std::string_view name, int64_t value) const;
 		bool Bind(std::string_view name, double value) const;
 		bool Bind(std::string_view name, const char* value) const;
 		bool Bind(std::string_view name, const std::string& value) const;
 		bool Bind(std::string_view name, std::string_view value) const;
+		bool Bind(std::string_view name, std::span<const Byte> value) const;
 
 		bool GetText(int index, std::string& outStr) const;
 		bool GetInt(int index, int32_t& outInt) const;
 		bool GetInt64(int index, int64_t& outInt) const;
 		bool GetBool(int index, bool& outBool) const;
 		bool GetDouble(int index, double& outDouble) const;
+		// fails if the value is not a blob, the span is only valid until the next step
+		bool GetBlob(int index, std::span<const Byte>& outBlob) const;
 
 		void ExecuteStep();
+		// resets the statement so it can be executed again and clears all bindings
+		bool Reset();
 		[[nodiscard]] bool IsDone() const { return m_done; }
 		[[nodiscard]] bool HasRow() const { return m_hasRow; }
-
-		[[nodiscard]] const SQLite& GetDb() const { return m_db; }
+		// the last step returned an error, the statement is also done in that case
+		[[nodiscard]] bool HasFailed() const { return m_failed; }
 
 		explicit operator bool() const { return m_valid; }
 
 	private:
-		const SQLite& m_db;
+		// no reference to the connection, cached statements live as long as it and it may be moved in the meantime
 		void* m_stmt;
 		bool m_valid;
 		bool m_done = false;
 		bool m_hasRow = false;
+		bool m_failed = false;
 		int m_columnCount;
 	};
 
+private:
+	struct StatementCache
+	{
+		struct Hash
+		{
+			using is_transparent = void;
+
+			size_t operator()(std::string_view sql) const
+			{
+				return std::hash<std::string_view>{}(sql);
+			}
+		};
+
+		struct Entry
+		{
+			std::unique_ptr<Statement> Stmt;
+			uint64_t LastUse;
+		};
+
+		// queries built at runtime, e.g. with one parameter per list element, would otherwise grow the cache without bound
+		static constexpr size_t Capacity = 64;
+
+		std::mutex Mutex;
+		uint64_t Clock = 0;
+		std::unordered_map<std::string, Entry, Hash, std::equal_to<>> Statements;
+	};
+
+public:
+	// a statement borrowed from the statement cache of the connection, gets reset and returned on destruction
+	// if the same query is in use on another thread, a new statement is prepared instead of waiting for it
+	class CachedStatement
+	{
+	public:
+		~CachedStatement();
+
+		CachedStatement(CachedStatement&&) = delete;
+		CachedStatement(const CachedStatement&) = delete;
+		CachedStatement& operator=(const CachedStatement&) = delete;
+		CachedStatement& operator=(CachedStatement&&) = delete;
+
+		Statement& operator*() const { return *m_stmt; }
+		Statement* operator->() const { return m_stmt.get(); }
+
+		explicit operator bool() const { return m_stmt && *m_stmt; }
+
+	private:
+		friend class SQLite;
+
+		CachedStatement(StatementCache* cache, std::string_view sql, std::unique_ptr<Statement> stmt)
+			: m_cache(cache), m_sql(sql), m_stmt(std::move(stmt)) {}
+
+		StatementCache* m_cache;
+		std::string_view m_sql;
+		std::unique_ptr<Statement> m_stmt;
+	};
+
+	// returns a prepared statement for the query, only prepares it if it is not cached yet
+	// the sql has to outlive the returned statement, which in turn must not outlive the connection
+	[[nodiscard]] CachedStatement Prepare(std::string_view sql) const;
+
 	explicit operator bool() const
 	{
 		return m_handle != Handle::Null;
@@ -175,6 +269,7 @@ public:
 private:
 	Handle m_handle;
 	std::filesystem::path m_path;
+	std::unique_ptr<StatementCache> m_statementCache;
 
 	static Handle RawOpen(const std::filesystem::path& path, Flags flags);
 	static void RawClose(Handle handle);
@@ -1,16 +1,71 @@
 // Copyright 2021 <github.com/razaqq>
 #pragma once
 
+#include "Core/CancellationToken.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 
 namespace PotatoAlert::Core {
 
+namespace Detail {
+
+// a type erased task, the callable is stored inline instead of in a separate std::function
+// nodes up to TaskNodeBlockSize are recycled by a small cache of each thread instead of going through the allocator
+struct TaskNode
+{
+	static constexpr size_t TaskNodeBlockSize = 128;
+
+	virtual ~TaskNode() = default;
+	virtual void Run() = 0;
+
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr, size_t size);
+};
+
+template<typename F>
+struct TaskNodeImpl final : TaskNode
+{
+	static_assert(alignof(F) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "Over-aligned tasks are not supported");
+
+	explicit TaskNodeImpl(F&& func) : Func(std::move(func)) {}
+	explicit TaskNodeImpl(const F& func) : Func(func) {}
+
+	void Run() override
+	{
+		Func();
+	}
+
+	F Func;
+};
+
+}  // namespace Detail
+
+// queued tasks of a higher priority are always started before the ones of a lower priority
+// running tasks are never interrupted, so a high priority task waits at most until the next task finishes
+enum class TaskPriority : uint8_t
+{
+	High = 0,    // interactive work, which the user is waiting for
+	Normal = 1,
+	Low = 2,     // backlog work, which can take as long as it needs
+};
+
+// a work stealing thread pool, every worker has its own deque, which it pushes to and pops from at the bottom
+// idle workers steal from the top of the other deques. tasks enqueued from outside of the pool go to a shared
+// injection queue, so only external submitters contend on a lock. every priority has its own deques and queue
 class ThreadPool
 {
 public:
@@ -23,21 +78,59 @@ public:
 
 	template<typename Func, typename... Args>
 	auto Enqueue(Func&& func, Args&&... args) -> std::future<std::invoke_result_t<Func&&, Args&&...>>
+	{
+		return Enqueue(TaskPriority::Normal, std::forward<Func>(func), std::forward<Args>(args)...);
+	}
+
+	template<typename Func, typename... Args>
+	auto Enqueue(TaskPriority priority, Func&& func, Args&&... args) -> std::future<std::invoke_result_t<Func&&, Args&&...>>
 	{
 		using Ret = std::invoke_result_t<Func&&, Args&&...>;
 
-		auto task = std::make_shared<std::packaged_task<Ret()>>(
-			std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+		std::promise<Ret> promise;
+		std::future<Ret> res = promise.get_future();
+
+		Submit(priority, [promise = std::move(promise), func = std::forward<Func>(func), ...args = std::forward<Args>(args)]() mutable
+		{
+			if constexpr (std::is_void_v<Ret>)
+			{
+				std::invoke(std::move(func), std::move(args)...);
+				promise.set_value();
+			}
+			else
+			{
+				promise.set_value(std::invoke(std::move(func), std::move(args)...));
+			}
+		});
 
-		std::future<Ret> res = task->get_future();
+		return res;
+	}
 
-		std::unique_lock<std::mutex> lock(m_queueMutex);
+	// the token is passed to the task as its first argument, the task is still run if it was cancelled while queued
+	// so its future is always fulfilled, it has to check the token itself
+	template<typename Func, typename... Args>
+	auto Enqueue(TaskPriority priority, const CancellationToken& token, Func&& func, Args&&... args)
+		-> std::future<std::invoke_result_t<Func&&, CancellationToken, Args&&...>>
+	{
+		return Enqueue(priority, std::forward<Func>(func), token, std::forward<Args>(args)...);
+	}
 
-		m_tasks.emplace([task](){ (*task)(); });
-		std::atomic_fetch_add_explicit(&m_inFlight, 1, std::memory_order_relaxed);
-		m_conditionConsumers.notify_one();
+	// runs the task without a future, which saves allocating its shared state
+	template<typename Func>
+	void Submit(Func&& func)
+	{
+		Submit(TaskPriority::Normal, std::forward<Func>(func));
+	}
 
-		return res;
+	template<typename Func>
+	void Submit(TaskPriority priority, Func&& func)
+	{
+		Push(new Detail::TaskNodeImpl<std::decay_t<Func>>(std::forward<Func>(func)), priority);
+	}
+
+	[[nodiscard]] size_t ThreadCount() const
+	{
+		return m_workers.size();
 	}
 
 	void WaitUntilEmpty();
@@ -45,20 +138,38 @@ public:
 	~ThreadPool();
 
 private:
-	void StartWorker(size_t id, const std::unique_lock<std::mutex>& lock);
+	struct Worker;
 
-	bool m_isStopping = false;
-	
-	std::vector<std::thread> m_threads;
-	std::queue<std::function<void()>> m_tasks;
+	static constexpr size_t PriorityCount = 3;
+
+	void Push(Detail::TaskNode* task, TaskPriority priority);
+	Detail::TaskNode* FindTask(Worker* self, size_t priority);
+	Detail::TaskNode* PopInjected(size_t priority);
+	void RunWorker(Worker* self);
+	void OnTaskTaken(size_t priority);
+	void OnTaskDone();
 
-	std::mutex m_queueMutex;
-	std::condition_variable m_conditionProducers;
-	std::condition_variable m_conditionConsumers;
+	std::vector<std::unique_ptr<Worker>> m_workers;
+
+	static thread_local Worker* s_currentWorker;
+
+	std::mutex m_injectionMutex;
+	std::array<std::deque<Detail::TaskNode*>, PriorityCount> m_injection;
+	std::array<std::atomic<size_t>, PriorityCount> m_injectionSize{};
+
+	// queued tasks, which are in a deque or the injection queue and were not taken by a worker yet
+	std::atomic<size_t> m_queued = 0;
+	std::array<std::atomic<size_t>, PriorityCount> m_queuedByPriority{};
+	// queued tasks and the ones currently running
+	std::atomic<size_t> m_inFlight = 0;
+	std::atomic<size_t> m_sleeping = 0;
+
+	std::mutex m_sleepMutex;
+	bool m_isStopping = false;
+	std::condition_variable m_sleepCondition;
 
-	std::mutex m_inFlightMutex;
-	std::condition_variable m_inFlightCondition;
-	std::atomic<size_t> m_inFlight;
+	std::mutex m_waitMutex;
+	std::condition_variable m_waitCondition;
 };
 
 }  // namespace PotatoAlert::Core
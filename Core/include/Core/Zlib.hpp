@@ -3,12 +3,21 @@
 
 #include "Core/Bytes.hpp"
 
+#include <functional>
 #include <span>
 #include <vector>
 
 
 namespace PotatoAlert::Core::Zlib {
 
-std::vector<Byte> Inflate(std::span<const Byte> in, bool hasHeader = true);
+// the dictionary is only used by streams that were deflated with one, it has to be the same one
+std::vector<Byte> Inflate(std::span<const Byte> in, bool hasHeader = true, std::span<const Byte> dictionary = {});
+
+// inflates into a fixed size buffer and hands every filled chunk to the consumer, which can return false to abort
+bool InflateChunked(std::span<const Byte> in, const std::function<bool(std::span<const Byte>)>& consumer, bool hasHeader = true, std::span<const Byte> dictionary = {});
+
+// deflates into a stream with zlib header, a preset dictionary helps a lot with small and similar inputs
+// returns an empty vector on error
+std::vector<Byte> Deflate(std::span<const Byte> in, int level = 6, std::span<const Byte> dictionary = {});
 
 }  // namespace PotatoAlert::Core::Zlib
@@ -0,0 +1,208 @@
+// Copyright 2025 <github.com/razaqq>
+
+#include "Core/Bytes.hpp"
+#include "Core/Crc32.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define PA_CRC32_PCLMUL
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define PA_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#else
+	#define PA_TARGET_PCLMUL
+#endif
+
+
+using PotatoAlert::Core::Byte;
+
+namespace {
+
+static constexpr uint32_t Polynomial = 0xEDB88320;  // reflected 0x04C11DB7
+
+static constexpr std::array<std::array<uint32_t, 256>, 8> MakeTables()
+{
+	std::array<std::array<uint32_t, 256>, 8> tables = {};
+
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t crc = i;
+		for (int j = 0; j < 8; j++)
+		{
+			crc = (crc >> 1) ^ (Polynomial & (0u - (crc & 1u)));
+		}
+		tables[0][i] = crc;
+	}
+
+	// tables[n][i] is the crc of byte i followed by n zero bytes
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		for (size_t n = 1; n < tables.size(); n++)
+		{
+			tables[n][i] = (tables[n - 1][i] >> 8) ^ tables[0][tables[n - 1][i] & 0xFF];
+		}
+	}
+
+	return tables;
+}
+
+static constexpr std::array<std::array<uint32_t, 256>, 8> Tables = MakeTables();
+
+// expects and returns the inverted crc
+static uint32_t Crc32SliceBy8(uint32_t crc, const Byte* data, size_t size)
+{
+	while (size >= 8)
+	{
+		uint32_t low, high;
+		std::memcpy(&low, data, sizeof(low));
+		std::memcpy(&high, data + 4, sizeof(high));
+		low ^= crc;
+
+		crc = Tables[7][low & 0xFF] ^ Tables[6][(low >> 8) & 0xFF] ^ Tables[5][(low >> 16) & 0xFF] ^ Tables[4][low >> 24] ^
+			  Tables[3][high & 0xFF] ^ Tables[2][(high >> 8) & 0xFF] ^ Tables[1][(high >> 16) & 0xFF] ^ Tables[0][high >> 24];
+
+		data += 8;
+		size -= 8;
+	}
+
+	while (size > 0)
+	{
+		crc = (crc >> 8) ^ Tables[0][(crc ^ *data) & 0xFF];
+		data++;
+		size--;
+	}
+
+	return crc;
+}
+
+#ifdef PA_CRC32_PCLMUL
+
+static bool HasPclmul()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 1)) != 0 && (info[2] & (1 << 19)) != 0;  // PCLMULQDQ and SSE4.1
+#else
+	return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+// folds 4x128 bits at a time and reduces with barrett, see intel's "Fast CRC Computation for Generic Polynomials
+// Using PCLMULQDQ Instruction" for the derivation of the constants
+// expects and returns the inverted crc, size has to be a multiple of 16 and at least 64
+PA_TARGET_PCLMUL static uint32_t Crc32Pclmul(uint32_t crc, const Byte* data, size_t size)
+{
+	alignas(16) static constexpr uint64_t k1k2[] = { 0x0154442BD4, 0x01C6E41596 };
+	alignas(16) static constexpr uint64_t k3k4[] = { 0x01751997D0, 0x00CCAA009E };
+	alignas(16) static constexpr uint64_t k5k0[] = { 0x0163CD6124, 0x0000000000 };
+	alignas(16) static constexpr uint64_t poly[] = { 0x01DB710641, 0x01F7011641 };
+
+	__m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+	__m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+	__m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+	__m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+
+	__m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+	data += 64;
+	size -= 64;
+
+	// fold 512 bits in parallel
+	while (size >= 64)
+	{
+		const __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+		const __m128i x6 = _mm_clmulepi64_si128(x2, k, 0x00);
+		const __m128i x7 = _mm_clmulepi64_si128(x3, k, 0x00);
+		const __m128i x8 = _mm_clmulepi64_si128(x4, k, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k, 0x11);
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30)));
+
+		data += 64;
+		size -= 64;
+	}
+
+	// fold the 4 lanes into 128 bits
+	k = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+	auto fold = [&k](__m128i x, __m128i next) PA_TARGET_PCLMUL -> __m128i
+	{
+		const __m128i low = _mm_clmulepi64_si128(x, k, 0x00);
+		const __m128i high = _mm_clmulepi64_si128(x, k, 0x11);
+		return _mm_xor_si128(_mm_xor_si128(high, next), low);
+	};
+
+	x1 = fold(x1, x2);
+	x1 = fold(x1, x3);
+	x1 = fold(x1, x4);
+
+	// fold remaining 128 bit blocks
+	while (size >= 16)
+	{
+		x1 = fold(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+		data += 16;
+		size -= 16;
+	}
+
+	// fold 128 bits to 64 bits
+	const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+	x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+	k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask);
+	x1 = _mm_clmulepi64_si128(x1, k, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// barrett reduction to 32 bits
+	k = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+	x2 = _mm_and_si128(x1, mask);
+	x2 = _mm_clmulepi64_si128(x2, k, 0x10);
+	x2 = _mm_and_si128(x2, mask);
+	x2 = _mm_clmulepi64_si128(x2, k, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+#endif
+
+}  // namespace
+
+uint32_t PotatoAlert::Core::Crc32(uint32_t crc, std::span<const Byte> data)
+{
+	const Byte* ptr = data.data();
+	size_t size = data.size();
+	crc = ~crc;
+
+#ifdef PA_CRC32_PCLMUL
+	static const bool hasPclmul = HasPclmul();
+	if (hasPclmul && size >= 64)
+	{
+		const size_t blocks = size & ~static_cast<size_t>(15);
+		crc = Crc32Pclmul(crc, ptr, blocks);
+		ptr += blocks;
+		size -= blocks;
+	}
+#endif
+
+	return ~Crc32SliceBy8(crc, ptr, size);
+}
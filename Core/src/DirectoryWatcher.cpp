@@ -1,112 +1,312 @@
 // Copyright 2022 <github.com/razaqq>
 
-#include "Core/Directory.hpp"
 #include "Core/DirectoryWatcher.hpp"
 
-#include <QDateTime>
-#include <QDir>
-#include <QFileInfo>
-#include <QFileSystemWatcher>
+#include "Core/Encoding.hpp"
+#include "Core/File.hpp"
+#include "Core/Json.hpp"
+#include "Core/Log.hpp"
 
+#include <algorithm>
 #include <filesystem>
-#include <ranges>
+#include <iterator>
 #include <string>
-#include <unordered_set>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
 
 
 using PotatoAlert::Core::DirectoryWatcher;
+using PotatoAlert::Core::File;
+using PotatoAlert::Core::ParseJson;
+using PotatoAlert::Core::PathToUtf8;
+using PotatoAlert::Core::Result;
+using PotatoAlert::Core::Utf8ToPath;
+namespace fs = std::filesystem;
 
-DirectoryWatcher::DirectoryWatcher()
+namespace {
+
+constexpr int StateVersion = 1;
+
+}  // namespace
+
+void DirectoryWatcher::WatchDirectory(std::string_view dir)
 {
-	connect(
-		&m_watcher, &QFileSystemWatcher::directoryChanged,
-		this, &DirectoryWatcher::OnDirectoryChanged
-	);
+	WatchDirectory(fs::path(dir));
 }
 
-void DirectoryWatcher::ClearDirectories()
+void DirectoryWatcher::ForceFileChanged(std::string_view file)
 {
-	if (!m_watcher.directories().isEmpty())
-		m_watcher.removePaths(m_watcher.directories());
+	for (const fs::path& dir : Directories())
+	{
+		emit FileChanged(dir / file);
+	}
 }
 
-void DirectoryWatcher::WatchDirectory(const std::filesystem::path& dir)
+// compares the directory to its last listing and returns the changed files
+// a directory that was never listed before only records its files
+std::vector<fs::path> DirectoryWatcher::ScanDirectory(const fs::path& directory)
 {
-	const QDir directory(dir);
-	m_watcher.addPath(directory.absolutePath());
+	DirectoryState current;
+	std::error_code ec;
+	for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+	{
+		std::error_code entryEc;
+		if (!it->is_regular_file(entryEc))
+			continue;
 
-	const QFileInfoList watchedList = directory.entryInfoList(QDir::NoDotAndDotDot | QDir::Files);
+		const uint64_t size = it->file_size(entryEc);
+		const fs::file_time_type lastWriteTime = it->last_write_time(entryEc);
+		if (!entryEc)
+		{
+			current.emplace(it->path().filename(), FileState{ size, lastWriteTime.time_since_epoch().count() });
+		}
+	}
 
-	for (const QFileInfo& fileInfo : watchedList)
+	if (ec)
 	{
-		m_lastModified[fileInfo.absoluteFilePath()] = fileInfo.lastModified();
+		LOG_WARN("Failed to list directory {}: {}", directory, ec.message());
+		return {};
 	}
-}
 
-void DirectoryWatcher::WatchDirectory(std::string_view dir)
-{
-	const QString dirPath = QString(dir.data());
-	m_watcher.addPath(dirPath);
+	const auto [known, inserted] = m_directories.try_emplace(directory);
+	DirectoryState& state = known->second;
 
-	const QDir directory(dirPath);
-	const QFileInfoList watchedList = directory.entryInfoList(QDir::NoDotAndDotDot | QDir::Files);
+	std::vector<fs::path> changed;
+	if (!inserted)
+	{
+		for (const auto& [name, fileState] : current)
+		{
+			const auto it = state.find(name);
+			if (it == state.end() || it->second != fileState)
+			{
+				changed.emplace_back(directory / name);
+			}
+		}
 
-	for (const QFileInfo& fileInfo : watchedList)
+		// these files were removed
+		for (const auto& [name, _] : state)
+		{
+			if (!current.contains(name))
+			{
+				changed.emplace_back(directory / name);
+			}
+		}
+	}
+
+	if (inserted || !changed.empty())
 	{
-		m_lastModified[fileInfo.absoluteFilePath()] = fileInfo.lastModified();
+		state = std::move(current);
+		MarkStateChanged();
 	}
+	return changed;
 }
 
-void DirectoryWatcher::ForceDirectoryChanged()
+void DirectoryWatcher::UpdateFile(const fs::path& directory, const fs::path& file)
 {
-	for (const QString& dir : m_watcher.directories())
+	DirectoryState& state = m_directories[directory];
+
+	std::error_code ec;
+	const uint64_t size = fs::file_size(file, ec);
+	const fs::file_time_type lastWriteTime = ec ? fs::file_time_type() : fs::last_write_time(file, ec);
+	if (ec)
 	{
-		OnDirectoryChanged(dir);
+		state.erase(file.filename());
 	}
+	else
+	{
+		state.insert_or_assign(file.filename(), FileState{ size, lastWriteTime.time_since_epoch().count() });
+	}
+	MarkStateChanged();
 }
 
-void DirectoryWatcher::ForceFileChanged(std::string_view file)
+// the state is saved once the timer runs out, so bursts of changes do not rewrite the file every time
+void DirectoryWatcher::MarkStateChanged()
 {
-	for (const QString& dir : m_watcher.directories())
+	m_stateChanged = true;
+	if (!m_stateFile.empty() && !m_saveTimer.isActive())
 	{
-		emit FileChanged(QDir(dir + QDir::separator() + file.data()).filesystemAbsolutePath());
+		m_saveTimer.start();
 	}
 }
 
-void DirectoryWatcher::OnDirectoryChanged(const QString& path)
+bool DirectoryWatcher::LoadState(const fs::path& stateFile)
 {
-	emit DirectoryChanged(path.toStdString());
+	m_stateFile = stateFile;
+	if (!File::Exists(stateFile))
+		return true;
 
-	const QDir dir(path);
-	const QFileInfoList files = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::Files);
+	std::string json;
+	{
+		const File file = File::Open(stateFile, File::Flags::Open | File::Flags::Read);
+		if (!file || !file.ReadAllString(json))
+		{
+			LOG_ERROR("Failed to read directory state from {}: {}", stateFile, File::LastError());
+			return false;
+		}
+	}
 
-	auto beforeFiles = m_lastModified | std::views::keys | std::views::filter([&path](const QString& m) -> bool
+	PA_TRY_OR_ELSE(doc, ParseJson(json),
 	{
-		return m.startsWith(path);
-	}) | std::ranges::to<std::unordered_set<QString>>();
+		LOG_ERROR("Failed to parse directory state from {}: {}", stateFile, error);
+		return false;
+	});
+
+	if (!doc.IsObject() || !doc.HasMember("Version") || !doc["Version"].IsInt() || doc["Version"].GetInt() != StateVersion ||
+		!doc.HasMember("Directories") || !doc["Directories"].IsObject())
+	{
+		LOG_WARN("Ignoring directory state from {} with unknown format", stateFile);
+		return false;
+	}
+
+	for (const auto& dir : doc["Directories"].GetObject())
+	{
+		const Result<fs::path> directory = Utf8ToPath(std::string_view(dir.name.GetString(), dir.name.GetStringLength()));
+		if (!directory || !dir.value.IsObject())
+			continue;
+
+		DirectoryState& state = m_directories[*directory];
+		for (const auto& file : dir.value.GetObject())
+		{
+			const Result<fs::path> name = Utf8ToPath(std::string_view(file.name.GetString(), file.name.GetStringLength()));
+			const rapidjson::Value& value = file.value;
+			if (!name || !value.IsArray() || value.Size() != 2 || !value[0].IsUint64() || !value[1].IsInt64())
+				continue;
+
+			state.insert_or_assign(*name, FileState{ value[0].GetUint64(), value[1].GetInt64() });
+		}
+	}
+	return true;
+}
+
+// only the directories that are still watched are kept, so removed game installs do not linger in the file
+bool DirectoryWatcher::SaveState()
+{
+	m_saveTimer.stop();
+	if (m_stateFile.empty() || !m_stateChanged)
+		return true;
 
-	for (const QFileInfo& fileInfo : files)
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer writer(buffer);
+	writer.StartObject();
+	writer.Key("Version");
+	writer.Int(StateVersion);
+	writer.Key("Directories");
+	writer.StartObject();
+	for (const fs::path& directory : Directories())
 	{
-		const QString filePath = fileInfo.absoluteFilePath();
-		const QDateTime lastModified = fileInfo.lastModified();
+		const auto state = m_directories.find(directory);
+		const Result<std::string> dir = PathToUtf8(directory);
+		if (state == m_directories.end() || !dir)
+			continue;
 
-		if (!m_lastModified.contains(filePath) || m_lastModified[filePath] < lastModified)
+		writer.Key(dir->c_str(), dir->size());
+		writer.StartObject();
+		for (const auto& [name, fileState] : state->second)
 		{
-			m_lastModified[filePath] = lastModified;
-			emit FileChanged(QDir(filePath).filesystemAbsolutePath());
+			const Result<std::string> file = PathToUtf8(name);
+			if (!file)
+				continue;
+
+			writer.Key(file->c_str(), file->size());
+			writer.StartArray();
+			writer.Uint64(fileState.Size);
+			writer.Int64(fileState.LastWriteTime);
+			writer.EndArray();
 		}
+		writer.EndObject();
+	}
+	writer.EndObject();
+	writer.EndObject();
 
-		// remove it from the list if it still exists
-		if (beforeFiles.contains(filePath))
+	// write to a temporary file first, so a crash never leaves a torn state behind
+	fs::path tempFile = m_stateFile;
+	tempFile += ".tmp";
+	{
+		const File file = File::Open(tempFile, File::Flags::Write | File::Flags::Create | File::Flags::Truncate);
+		if (!file || !file.WriteString(std::string_view(buffer.GetString(), buffer.GetSize())))
 		{
-			beforeFiles.erase(filePath);
+			LOG_ERROR("Failed to write directory state to {}: {}", tempFile, File::LastError());
+			return false;
 		}
 	}
 
-	// these files were removed
-	for (const QString& file : beforeFiles)
+	std::error_code ec;
+	fs::rename(tempFile, m_stateFile, ec);
+	if (ec)
+	{
+		LOG_ERROR("Failed to move directory state into place: {}", ec.message());
+		return false;
+	}
+
+	m_stateChanged = false;
+	return true;
+}
+
+// an empty file only marks the directory as changed
+void DirectoryWatcher::QueueChange(const fs::path& directory, const fs::path& file)
+{
+	if (std::ranges::find(m_changedDirectories, directory) == m_changedDirectories.end())
+	{
+		m_changedDirectories.emplace_back(directory);
+	}
+
+	if (!file.empty() && m_queued.emplace(file).second)
+	{
+		m_changedFiles.emplace_back(file);
+	}
+
+	// the window starts with the first change, so a file that keeps changing can not hold back the others
+	if (!m_debounceTimer.isActive())
+	{
+		m_debounceTimer.start();
+	}
+}
+
+// the files that changed while the directory was not watched, they are emitted with the next burst
+void DirectoryWatcher::QueueCaughtUp(std::vector<fs::path> files)
+{
+	if (files.empty())
+		return;
+
+	m_caughtUpFiles.insert(m_caughtUpFiles.end(), std::make_move_iterator(files.begin()), std::make_move_iterator(files.end()));
+	if (!m_debounceTimer.isActive())
+	{
+		m_debounceTimer.start();
+	}
+}
+
+// drops the changes that were not emitted yet, they might belong to directories that are not watched anymore
+void DirectoryWatcher::ClearChanges()
+{
+	m_debounceTimer.stop();
+	m_changedDirectories.clear();
+	m_changedFiles.clear();
+	m_queued.clear();
+	m_caughtUpFiles.clear();
+}
+
+void DirectoryWatcher::EmitChanges()
+{
+	// the receivers might watch other directories, which must not touch the lists while they are emitted
+	const std::vector<fs::path> directories = std::exchange(m_changedDirectories, {});
+	const std::vector<fs::path> files = std::exchange(m_changedFiles, {});
+	const std::vector<fs::path> caughtUp = std::exchange(m_caughtUpFiles, {});
+	m_queued.clear();
+
+	for (const fs::path& directory : directories)
+	{
+		emit DirectoryChanged(directory);
+	}
+
+	for (const fs::path& file : files)
+	{
+		emit FileChanged(file);
+	}
+
+	if (!caughtUp.empty())
 	{
-		m_lastModified.erase(file);
-		emit FileChanged(QDir(file).filesystemAbsolutePath());
+		emit FilesCaughtUp(caughtUp);
 	}
 }
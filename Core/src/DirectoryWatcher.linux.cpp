@@ -0,0 +1,175 @@
+// Copyright 2025 <github.com/razaqq>
+
+#include "Core/DirectoryWatcher.hpp"
+
+#include "Core/Log.hpp"
+
+#include <QSocketNotifier>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+
+using PotatoAlert::Core::DirectoryWatcher;
+namespace fs = std::filesystem;
+
+namespace {
+
+// only finished writes, no IN_MODIFY, so a replay that is still being recorded does not wake us up at all
+constexpr uint32_t WatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR;
+
+std::string LastError()
+{
+	return std::error_code(errno, std::system_category()).message();
+}
+
+}  // namespace
+
+DirectoryWatcher::DirectoryWatcher()
+{
+	m_debounceTimer.setSingleShot(true);
+	m_debounceTimer.setInterval(DebounceInterval);
+	connect(&m_debounceTimer, &QTimer::timeout, this, &DirectoryWatcher::EmitChanges);
+
+	m_saveTimer.setSingleShot(true);
+	m_saveTimer.setInterval(SaveInterval);
+	connect(&m_saveTimer, &QTimer::timeout, this, &DirectoryWatcher::SaveState);
+
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify == -1)
+	{
+		LOG_ERROR("Failed to initialize inotify: {}", LastError());
+		return;
+	}
+
+	m_notifier = std::make_unique<QSocketNotifier>(m_inotify, QSocketNotifier::Read);
+	connect(m_notifier.get(), &QSocketNotifier::activated, this, &DirectoryWatcher::ReadEvents);
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+	SaveState();
+
+	m_notifier.reset();
+	if (m_inotify != -1)
+	{
+		close(m_inotify);
+	}
+}
+
+void DirectoryWatcher::ClearDirectories()
+{
+	for (const auto& [watch, _] : m_watches)
+	{
+		inotify_rm_watch(m_inotify, watch);
+	}
+	m_watches.clear();
+	ClearChanges();
+
+	// the directories that are not watched again are dropped from the state on the next save
+	MarkStateChanged();
+}
+
+std::vector<fs::path> DirectoryWatcher::Directories() const
+{
+	std::vector<fs::path> directories;
+	directories.reserve(m_watches.size());
+	for (const auto& [_, directory] : m_watches)
+	{
+		directories.emplace_back(directory);
+	}
+	return directories;
+}
+
+void DirectoryWatcher::WatchDirectory(const fs::path& dir)
+{
+	if (m_inotify == -1)
+		return;
+
+	std::error_code ec;
+	const fs::path directory = fs::absolute(dir, ec).lexically_normal();
+	if (ec)
+	{
+		LOG_ERROR("Failed to get absolute path of {}: {}", dir, ec.message());
+		return;
+	}
+
+	// watching the same directory again returns the same descriptor
+	const int watch = inotify_add_watch(m_inotify, directory.c_str(), WatchMask);
+	if (watch == -1)
+	{
+		LOG_ERROR("Failed to watch directory {}: {}", directory, LastError());
+		return;
+	}
+	m_watches[watch] = directory;
+
+	// catches up with the changes made while the directory was not watched, inotify only tells us about new ones
+	QueueCaughtUp(ScanDirectory(directory));
+}
+
+void DirectoryWatcher::ForceDirectoryChanged()
+{
+	for (const fs::path& directory : Directories())
+	{
+		QueueChange(directory, {});
+		for (const fs::path& file : ScanDirectory(directory))
+		{
+			QueueChange(directory, file);
+		}
+	}
+}
+
+void DirectoryWatcher::ReadEvents()
+{
+	alignas(inotify_event) char buffer[4096];
+
+	while (true)
+	{
+		const ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			if (length == -1 && errno != EAGAIN && errno != EINTR)
+			{
+				LOG_ERROR("Failed to read inotify events: {}", LastError());
+			}
+			return;
+		}
+
+		for (const char* ptr = buffer; ptr < buffer + length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+			ptr += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				LOG_WARN("The inotify queue overflowed, some file changes were lost");
+				ForceDirectoryChanged();
+				continue;
+			}
+
+			const auto it = m_watches.find(event->wd);
+			if (it == m_watches.end())
+				continue;
+
+			// the directory itself was removed or unmounted
+			if (event->mask & IN_IGNORED)
+			{
+				m_watches.erase(it);
+				continue;
+			}
+
+			if (event->mask & IN_ISDIR || event->len == 0)
+				continue;
+
+			const fs::path file = it->second / event->name;
+			UpdateFile(it->second, file);
+			QueueChange(it->second, file);
+		}
+	}
+}
@@ -0,0 +1,81 @@
+// Copyright 2022 <github.com/razaqq>
+
+#include "Core/DirectoryWatcher.hpp"
+
+#include <QDir>
+#include <QFileSystemWatcher>
+
+#include <filesystem>
+#include <vector>
+
+
+using PotatoAlert::Core::DirectoryWatcher;
+namespace fs = std::filesystem;
+
+DirectoryWatcher::DirectoryWatcher()
+{
+	m_debounceTimer.setSingleShot(true);
+	m_debounceTimer.setInterval(DebounceInterval);
+	connect(&m_debounceTimer, &QTimer::timeout, this, &DirectoryWatcher::EmitChanges);
+
+	m_saveTimer.setSingleShot(true);
+	m_saveTimer.setInterval(SaveInterval);
+	connect(&m_saveTimer, &QTimer::timeout, this, &DirectoryWatcher::SaveState);
+
+	connect(
+		&m_watcher, &QFileSystemWatcher::directoryChanged,
+		this, &DirectoryWatcher::OnDirectoryChanged
+	);
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+	SaveState();
+}
+
+void DirectoryWatcher::ClearDirectories()
+{
+	if (!m_watcher.directories().isEmpty())
+		m_watcher.removePaths(m_watcher.directories());
+	ClearChanges();
+
+	// the directories that are not watched again are dropped from the state on the next save
+	MarkStateChanged();
+}
+
+std::vector<fs::path> DirectoryWatcher::Directories() const
+{
+	std::vector<fs::path> directories;
+	for (const QString& dir : m_watcher.directories())
+	{
+		directories.emplace_back(QDir(dir).filesystemAbsolutePath());
+	}
+	return directories;
+}
+
+void DirectoryWatcher::WatchDirectory(const fs::path& dir)
+{
+	const QDir directory(dir);
+	m_watcher.addPath(directory.absolutePath());
+
+	// catches up with the changes made while the directory was not watched
+	QueueCaughtUp(ScanDirectory(directory.filesystemAbsolutePath()));
+}
+
+void DirectoryWatcher::ForceDirectoryChanged()
+{
+	for (const QString& dir : m_watcher.directories())
+	{
+		OnDirectoryChanged(dir);
+	}
+}
+
+void DirectoryWatcher::OnDirectoryChanged(const QString& path)
+{
+	const fs::path directory = QDir(path).filesystemAbsolutePath();
+	QueueChange(directory, {});
+	for (const fs::path& file : ScanDirectory(directory))
+	{
+		QueueChange(directory, file);
+	}
+}
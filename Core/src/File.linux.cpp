@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <cerrno>
 #include <cstdint>
 #include <filesystem>
 #include <string>
@@ -281,6 +282,66 @@ bool File::RawWriteString(Handle handle, std::string_view data, bool resetFilePo
 	return true;
 }
 
+template<is_byte T>
+bool File::RawWriteChunk(Handle handle, std::span<const T> data)
+{
+	if (handle == Handle::Null)
+	{
+		return false;
+	}
+
+	const int fd = UnwrapHandle<int>(handle);
+	size_t totalWritten = 0;
+	while (totalWritten < data.size())
+	{
+		const ssize_t bytesWritten = write(fd, std::data(data) + totalWritten, data.size() - totalWritten);
+		if (bytesWritten == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		totalWritten += static_cast<size_t>(bytesWritten);
+	}
+	return true;
+}
+template bool File::RawWriteChunk(Handle, std::span<const uint8_t>);
+template bool File::RawWriteChunk(Handle, std::span<const int8_t>);
+template bool File::RawWriteChunk(Handle, std::span<const std::byte>);
+
+bool File::RawTruncate(Handle handle)
+{
+	if (handle == Handle::Null)
+	{
+		return false;
+	}
+
+	const int fd = UnwrapHandle<int>(handle);
+	const off64_t pos = lseek64(fd, 0, SEEK_CUR);
+	if (pos == -1)
+	{
+		return false;
+	}
+
+	return ftruncate64(fd, pos) != -1;
+}
+
+bool File::RawAllocate(Handle handle, uint64_t size)
+{
+	if (handle == Handle::Null)
+	{
+		return false;
+	}
+
+	// unlike posix_fallocate this keeps the file size and never falls back to writing zeros,
+	// a filesystem without fallocate simply gets no reservation
+	if (fallocate(UnwrapHandle<int>(handle), FALLOC_FL_KEEP_SIZE, 0, static_cast<off64_t>(size)) == -1)
+	{
+		return errno == EOPNOTSUPP;
+	}
+	return true;
+}
+
 bool File::RawFlushBuffer(Handle handle)
 {
 	if (fsync(UnwrapHandle<int>(handle)) == -1)
@@ -8,6 +8,7 @@
 
 #include "win32.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -296,6 +297,54 @@ bool File::RawWriteString(Handle handle, std::string_view data, bool resetFilePo
 	return true;
 }
 
+template<is_byte T>
+bool File::RawWriteChunk(Handle handle, std::span<const T> data)
+{
+	if (handle == Handle::Null)
+	{
+		return false;
+	}
+
+	size_t totalWritten = 0;
+	while (totalWritten < data.size())
+	{
+		const DWORD toWrite = static_cast<DWORD>(std::min<size_t>(data.size() - totalWritten, MAXDWORD));
+		DWORD dwBytesWritten = 0;
+		if (!WriteFile(UnwrapHandle<HANDLE>(handle), data.data() + totalWritten, toWrite, &dwBytesWritten, nullptr))
+		{
+			return false;
+		}
+		totalWritten += dwBytesWritten;
+	}
+	return true;
+}
+template bool File::RawWriteChunk(Handle, std::span<const int8_t>);
+template bool File::RawWriteChunk(Handle, std::span<const std::byte>);
+template bool File::RawWriteChunk(Handle, std::span<const unsigned char>);
+template bool File::RawWriteChunk(Handle, std::span<const char>);
+
+bool File::RawTruncate(Handle handle)
+{
+	if (handle == Handle::Null)
+	{
+		return false;
+	}
+
+	return SetEndOfFile(UnwrapHandle<HANDLE>(handle));
+}
+
+bool File::RawAllocate(Handle handle, uint64_t size)
+{
+	if (handle == Handle::Null)
+	{
+		return false;
+	}
+
+	FILE_ALLOCATION_INFO info;
+	info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+	return SetFileInformationByHandle(UnwrapHandle<HANDLE>(handle), FileAllocationInfo, &info, sizeof(info));
+}
+
 bool File::RawFlushBuffer(Handle handle)
 {
 	return FlushFileBuffers(UnwrapHandle<HANDLE>(handle));
@@ -0,0 +1,219 @@
+// Copyright 2025 <github.com/razaqq>
+
+#include "Core/Instrumentor.hpp"
+
+#include "Core/AsciiTable.hpp"
+#include "Core/Format.hpp"
+#include "Core/Log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+using PotatoAlert::Core::Instrumentor;
+using PotatoAlert::Core::TraceBuffer;
+using PotatoAlert::Core::TraceClock;
+using PotatoAlert::Core::TraceEvent;
+
+namespace {
+
+constexpr auto FlushInterval = std::chrono::milliseconds(100);
+
+// marks the buffer of a thread as retired once the thread exits, the flusher still owns it until it was drained
+struct RetireOnExit
+{
+	std::shared_ptr<TraceBuffer> Buffer;
+
+	~RetireOnExit()
+	{
+		if (Buffer)
+			Buffer->Retired.store(true, std::memory_order_release);
+	}
+};
+
+thread_local RetireOnExit t_retireOnExit;
+
+double ToMicros(TraceClock::duration duration)
+{
+	return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+void AppendJsonString(std::string& out, std::string_view str)
+{
+	out.push_back('"');
+	for (const char c : str)
+	{
+		if (c == '"' || c == '\\')
+			out.push_back('\\');
+		out.push_back(c);
+	}
+	out.push_back('"');
+}
+
+bool WriteChunk(const PotatoAlert::Core::File& file, std::string_view chunk)
+{
+	return file.WriteChunk(std::span(reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size()));
+}
+
+}  // namespace
+
+thread_local TraceBuffer* Instrumentor::s_buffer = nullptr;
+
+Instrumentor::Instrumentor()
+{
+	m_flusher = std::thread(&Instrumentor::RunFlusher, this);
+}
+
+Instrumentor::~Instrumentor()
+{
+	{
+		std::unique_lock lock(m_flusherMutex);
+		m_isStopping = true;
+	}
+	m_flusherCondition.notify_all();
+	if (m_flusher.joinable())
+	{
+		m_flusher.join();
+	}
+
+	Flush();
+	EndTrace();
+	LogSummary();
+}
+
+bool Instrumentor::BeginTrace(const std::filesystem::path& path)
+{
+	std::unique_lock lock(m_flushMutex);
+	if (m_traceFile)
+		return false;
+
+	m_traceFile = File::Open(path, File::Flags::Write | File::Flags::Create | File::Flags::Truncate);
+	if (!m_traceFile)
+	{
+		LOG_ERROR("Failed to open trace file {}: {}", path, File::LastError());
+		return false;
+	}
+
+	m_traceHasEvents = false;
+	return WriteChunk(m_traceFile, R"({"displayTimeUnit":"ms","traceEvents":[)");
+}
+
+void Instrumentor::EndTrace()
+{
+	std::unique_lock lock(m_flushMutex);
+	if (!m_traceFile)
+		return;
+
+	WriteChunk(m_traceFile, "\n]}\n");
+	m_traceFile.Close();
+}
+
+TraceBuffer* Instrumentor::RegisterThread()
+{
+	std::unique_lock lock(m_buffersMutex);
+	std::shared_ptr<TraceBuffer>& buffer = m_buffers.emplace_back(std::make_shared<TraceBuffer>(m_nextThreadId++));
+	t_retireOnExit.Buffer = buffer;
+	return buffer.get();
+}
+
+void Instrumentor::RunFlusher()
+{
+	std::unique_lock lock(m_flusherMutex);
+	while (!m_isStopping)
+	{
+		m_flusherCondition.wait_for(lock, FlushInterval, [this]() { return m_isStopping; });
+
+		lock.unlock();
+		Flush();
+		lock.lock();
+	}
+}
+
+void Instrumentor::Flush()
+{
+	std::vector<std::shared_ptr<TraceBuffer>> buffers;
+	{
+		std::unique_lock lock(m_buffersMutex);
+		buffers = m_buffers;
+	}
+
+	std::unique_lock lock(m_flushMutex);
+	const bool tracing = static_cast<bool>(m_traceFile);
+	m_traceChunk.clear();
+
+	for (const std::shared_ptr<TraceBuffer>& buffer : buffers)
+	{
+		// checked before draining, so everything the thread pushed before it exited is drained below
+		const bool retired = buffer->Retired.load(std::memory_order_acquire);
+
+		buffer->Drain([this, tracing, &buffer](const TraceEvent& event)
+		{
+			const TraceClock::duration duration(event.End - event.Start);
+			m_stats[event.Name].Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+
+			if (tracing)
+			{
+				m_traceChunk.append(m_traceHasEvents ? ",\n" : "\n");
+				m_traceHasEvents = true;
+				m_traceChunk.append(R"({"name":)");
+				AppendJsonString(m_traceChunk, event.Name);
+				fmt::format_to(std::back_inserter(m_traceChunk), R"(,"ph":"X","ts":{:.3f},"dur":{:.3f},"pid":1,"tid":{}}})",
+					ToMicros(TraceClock::time_point(TraceClock::duration(event.Start)) - m_epoch),
+					ToMicros(duration),
+					buffer->ThreadId());
+			}
+		});
+		m_dropped += buffer->TakeDropped();
+
+		if (retired)
+		{
+			std::unique_lock buffersLock(m_buffersMutex);
+			std::erase(m_buffers, buffer);
+		}
+	}
+
+	if (tracing && !m_traceChunk.empty())
+	{
+		if (!WriteChunk(m_traceFile, m_traceChunk))
+		{
+			LOG_ERROR("Failed to write trace file: {}", File::LastError());
+		}
+	}
+}
+
+void Instrumentor::LogSummary() const
+{
+	if (m_stats.empty())
+		return;
+
+	const auto micros = [](uint64_t nanos)
+	{
+		return nanos / 1000;
+	};
+
+	AsciiTable<std::string, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t> table(
+		{ "Name", "Total", "Mean", "p50", "p90", "p99", "p99.9", "Max", "Runs" });
+	for (const auto& [name, durations] : m_stats)
+	{
+		table.AddRow(std::string(name), micros(durations.Sum()), micros(durations.Mean()), micros(durations.Percentile(50.0)),
+			micros(durations.Percentile(90.0)), micros(durations.Percentile(99.0)), micros(durations.Percentile(99.9)),
+			micros(durations.Max()), durations.Count());
+	}
+	table.SortByColumn<1>(SortOrder::Descending);
+
+	std::stringstream stream;
+	table.Print(stream);
+	LOG_INFO("\n{}", stream.str());
+
+	if (m_dropped > 0)
+	{
+		LOG_WARN("Dropped {} profiling events, the trace buffers were full", m_dropped);
+	}
+}
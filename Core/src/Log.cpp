@@ -2,6 +2,7 @@
 
 #include "Core/Log.hpp"
 
+#include <spdlog/async.h>
 #include <spdlog/pattern_formatter.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
@@ -10,6 +11,8 @@
 #include <QApplication>
 #include <QString>
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <memory>
 #include <string>
@@ -18,7 +21,18 @@
 
 using PotatoAlert::Core::Log;
 
+namespace {
+
+constexpr size_t QueueSize = 8192;
+constexpr auto FlushInterval = std::chrono::seconds(2);
+
+// defined before the loggers, so it is destroyed after them and writes what is still queued
+std::shared_ptr<spdlog::details::thread_pool> s_threadPool;
+
+}
+
 std::shared_ptr<spdlog::logger> Log::s_logger;
+std::shared_ptr<spdlog::logger> Log::s_errorLogger;
 
 namespace {
 
@@ -43,7 +57,8 @@ static void LogQtMessage(QtMsgType type, const QMessageLogContext& context, cons
 			break;
 	}
 
-	Log::GetLogger()->log(spdlog::source_loc{ context.file, context.line, context.function }, level, text.toStdString());
+	const std::shared_ptr<spdlog::logger>& logger = level >= spdlog::level::err ? Log::GetErrorLogger() : Log::GetLogger();
+	logger->log(spdlog::source_loc{ context.file, context.line, context.function }, level, text.toStdString());
 }
 
 }
@@ -110,11 +125,21 @@ void Log::Init(const std::filesystem::path& logFile)
 	fileSink->set_level(spdlog::level::info);
 
 	std::vector<spdlog::sink_ptr> sinks{ stdoutSink, fileSink };
-	s_logger = std::make_shared<spdlog::logger>("PotatoAlert", sinks.begin(), sinks.end());
+
+	// a full queue drops the oldest messages instead of blocking the thread that logs
+	s_threadPool = std::make_shared<spdlog::details::thread_pool>(QueueSize, 1);
+	s_logger = std::make_shared<spdlog::async_logger>("PotatoAlert", sinks.begin(), sinks.end(), s_threadPool, spdlog::async_overflow_policy::overrun_oldest);
+	// messages no sink wants are filtered before they are formatted and queued
+	s_logger->set_level(std::min(stdoutSink->level(), fileSink->level()));
+	s_logger->flush_on(spdlog::level::err);
+
+	// the sinks are thread safe, so the error logger writes to them directly from the thread that logs
+	s_errorLogger = std::make_shared<spdlog::logger>("PotatoAlert", sinks.begin(), sinks.end());
+	s_errorLogger->set_level(spdlog::level::err);
+	s_errorLogger->flush_on(spdlog::level::err);
 
 	spdlog::register_logger(s_logger);
-	s_logger->set_level(spdlog::level::trace);
-	s_logger->flush_on(spdlog::level::trace);
+	spdlog::flush_every(FlushInterval);
 
 	qInstallMessageHandler(LogQtMessage);
 }
@@ -0,0 +1,136 @@
+// Copyright 2025 <github.com/razaqq>
+
+#include "Core/Metrics.hpp"
+
+#include "Core/AsciiTable.hpp"
+#include "Core/File.hpp"
+#include "Core/Format.hpp"
+#include "Core/Log.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+
+using PotatoAlert::Core::AsciiTable;
+using PotatoAlert::Core::Counter;
+using PotatoAlert::Core::File;
+using PotatoAlert::Core::Gauge;
+using PotatoAlert::Core::Histogram;
+using PotatoAlert::Core::Metrics;
+
+namespace {
+
+template<typename T>
+T& GetOrAdd(std::map<std::string, std::unique_ptr<T>, std::less<>>& metrics, std::string_view name)
+{
+	auto it = metrics.find(name);
+	if (it == metrics.end())
+	{
+		it = metrics.emplace(std::string(name), std::make_unique<T>()).first;
+	}
+	return *it->second;
+}
+
+uint64_t Micros(uint64_t nanos)
+{
+	return nanos / 1000;
+}
+
+}  // namespace
+
+uint64_t Histogram::Percentile(double percentile) const
+{
+	const uint64_t count = Count();
+	if (count == 0)
+		return 0;
+
+	const double clamped = std::clamp(percentile, 0.0, 100.0);
+	const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(count))));
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BucketCount; i++)
+	{
+		seen += m_buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+		{
+			return std::min(BucketUpperBound(i), Max());
+		}
+	}
+	// the buckets are read while others might still record, so the count can be ahead of them
+	return Max();
+}
+
+Counter& Metrics::GetCounter(std::string_view name)
+{
+	std::unique_lock lock(m_mutex);
+	return GetOrAdd(m_counters, name);
+}
+
+Gauge& Metrics::GetGauge(std::string_view name)
+{
+	std::unique_lock lock(m_mutex);
+	return GetOrAdd(m_gauges, name);
+}
+
+Histogram& Metrics::GetHistogram(std::string_view name)
+{
+	std::unique_lock lock(m_mutex);
+	return GetOrAdd(m_histograms, name);
+}
+
+std::string Metrics::Format() const
+{
+	std::unique_lock lock(m_mutex);
+	std::stringstream stream;
+
+	if (!m_counters.empty() || !m_gauges.empty())
+	{
+		AsciiTable<std::string, std::string> table({ "Name", "Value" });
+		for (const auto& [name, counter] : m_counters)
+		{
+			table.AddRow(name, fmt::to_string(counter->Value()));
+		}
+		for (const auto& [name, gauge] : m_gauges)
+		{
+			table.AddRow(name, fmt::to_string(gauge->Value()));
+		}
+		table.Print(stream);
+	}
+
+	if (!m_histograms.empty())
+	{
+		AsciiTable<std::string, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t> table(
+			{ "Latency (us)", "Count", "Mean", "p50", "p90", "p99", "p99.9", "Max" });
+		for (const auto& [name, histogram] : m_histograms)
+		{
+			table.AddRow(name, histogram->Count(), Micros(histogram->Mean()), Micros(histogram->Percentile(50.0)),
+				Micros(histogram->Percentile(90.0)), Micros(histogram->Percentile(99.0)), Micros(histogram->Percentile(99.9)),
+				Micros(histogram->Max()));
+		}
+		table.Print(stream);
+	}
+
+	return stream.str();
+}
+
+void Metrics::Log() const
+{
+	LOG_INFO("Metrics:\n{}", Format());
+}
+
+bool Metrics::WriteToFile(const std::filesystem::path& path) const
+{
+	const File file = File::Open(path, File::Flags::Write | File::Flags::Create | File::Flags::Truncate);
+	if (!file)
+	{
+		LOG_ERROR("Failed to open metrics file {}: {}", path, File::LastError());
+		return false;
+	}
+	return file.WriteString(Format());
+}
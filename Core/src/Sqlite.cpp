@@ -7,13 +7,18 @@ PA_SUPPRESS_WARN_BEGIN
 #include <sqlite3.h>
 PA_SUPPRESS_WARN_END
 
+#include <algorithm>
 #include <cstdint>
 #include <filesystem>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
 #include <type_traits>
 
 
+using PotatoAlert::Core::Byte;
 using PotatoAlert::Core::SQLite;
 
 namespace {
@@ -60,17 +65,68 @@ int64_t SQLite::GetLastRowId() const
 	return sqlite3_last_insert_rowid(UnwrapHandle(m_handle));
 }
 
+bool SQLite::InTransaction() const
+{
+	return sqlite3_get_autocommit(UnwrapHandle(m_handle)) == 0;
+}
+
+bool SQLite::IsTemporary() const
+{
+	const char* fileName = sqlite3_db_filename(UnwrapHandle(m_handle), "main");
+	return fileName == nullptr || *fileName == '\0';
+}
+
 bool SQLite::RawExecute(Handle handle, std::string_view sql, int (*callback)(void* ctx, int columns, char** columnText, char** columnNames), void* context)
 {
 	return sqlite3_exec(UnwrapHandle(handle), std::string(sql).c_str(), callback, context, nullptr) == SQLITE_OK;
 }
 
+SQLite::CachedStatement SQLite::Prepare(std::string_view sql) const
+{
+	if (m_statementCache)
+	{
+		std::unique_lock lock(m_statementCache->Mutex);
+		if (auto it = m_statementCache->Statements.find(sql); it != m_statementCache->Statements.end())
+		{
+			std::unique_ptr<Statement> stmt = std::move(it->second.Stmt);
+			m_statementCache->Statements.erase(it);
+			return CachedStatement(m_statementCache.get(), sql, std::move(stmt));
+		}
+	}
+
+	return CachedStatement(m_statementCache.get(), sql, std::make_unique<Statement>(*this, sql, true));
+}
+
+SQLite::CachedStatement::~CachedStatement()
+{
+	if (m_cache == nullptr || !m_stmt || !*m_stmt || !m_stmt->Reset())
+		return;
+
+	std::unique_ptr<Statement> evicted;
+	std::unique_lock lock(m_cache->Mutex);
+	// if the query was used concurrently, the other statement might have been returned already
+	m_cache->Statements.try_emplace(std::string(m_sql), std::move(m_stmt), ++m_cache->Clock);
+
+	// evicts the least recently used statement, it is finalized after the lock is released
+	if (m_cache->Statements.size() > StatementCache::Capacity)
+	{
+		auto oldest = std::ranges::min_element(m_cache->Statements, {}, [](const auto& entry)
+		{
+			return entry.second.LastUse;
+		});
+		evicted = std::move(oldest->second.Stmt);
+		m_cache->Statements.erase(oldest);
+	}
+}
+
 // ----------------------------------------------
 
-SQLite::Statement::Statement(const SQLite& db, std::string_view sql) : m_db(db)
+SQLite::Statement::Statement(const SQLite& db, std::string_view sql, bool persistent)
 {
-	sqlite3_stmt* stmt;
-	m_valid = sqlite3_prepare_v2(UnwrapHandle(db.m_handle), sql.data(), -1, &stmt, nullptr) == SQLITE_OK;
+	sqlite3_stmt* stmt = nullptr;
+	const unsigned int flags = persistent ? SQLITE_PREPARE_PERSISTENT : 0;
+	m_valid = sql.size() <= static_cast<size_t>(std::numeric_limits<int>::max()) &&
+			  sqlite3_prepare_v3(UnwrapHandle(db.m_handle), sql.data(), static_cast<int>(sql.size()), flags, &stmt, nullptr) == SQLITE_OK;
 	m_stmt = stmt;
 	m_columnCount = sqlite3_column_count(stmt);
 }
@@ -93,6 +149,11 @@ bool SQLite::Statement::Bind(int index, uint32_t value) const
 	return sqlite3_bind_int(static_cast<sqlite3_stmt*>(m_stmt), index, static_cast<int>(value)) == SQLITE_OK;
 }
 
+bool SQLite::Statement::Bind(int index, int64_t value) const
+{
+	return sqlite3_bind_int64(static_cast<sqlite3_stmt*>(m_stmt), index, value) == SQLITE_OK;
+}
+
 bool SQLite::Statement::Bind(int index, double value) const
 {
 	return sqlite3_bind_double(static_cast<sqlite3_stmt*>(m_stmt), index, value) == SQLITE_OK;
@@ -110,7 +171,16 @@ bool SQLite::Statement::Bind(int index, const std::string& value) const
 
 bool SQLite::Statement::Bind(int index, std::string_view value) const
 {
-	return sqlite3_bind_text(static_cast<sqlite3_stmt*>(m_stmt), index, value.data(), -1, nullptr) == SQLITE_OK;
+	if (value.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+		return false;
+	return sqlite3_bind_text(static_cast<sqlite3_stmt*>(m_stmt), index, value.data(), static_cast<int>(value.size()), nullptr) == SQLITE_OK;
+}
+
+bool SQLite::Statement::Bind(int index, std::span<const Byte> value) const
+{
+	if (value.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+		return false;
+	return sqlite3_bind_blob(static_cast<sqlite3_stmt*>(m_stmt), index, value.data(), static_cast<int>(value.size()), nullptr) == SQLITE_OK;
 }
 
 bool SQLite::Statement::Bind(std::string_view name, int32_t value) const
@@ -131,6 +201,15 @@ bool SQLite::Statement::Bind(std::string_view name, uint32_t value) const
 	return false;
 }
 
+bool SQLite::Statement::Bind(std::string_view name, int64_t value) const
+{
+	if (const int index = sqlite3_bind_parameter_index(static_cast<sqlite3_stmt*>(m_stmt), name.data()))
+	{
+		return Bind(index, value);
+	}
+	return false;
+}
+
 bool SQLite::Statement::Bind(std::string_view name, double value) const
 {
 	if (const int index = sqlite3_bind_parameter_index(static_cast<sqlite3_stmt*>(m_stmt), name.data()))
@@ -167,6 +246,15 @@ bool SQLite::Statement::Bind(std::string_view name, std::string_view value) cons
 	return false;
 }
 
+bool SQLite::Statement::Bind(std::string_view name, std::span<const Byte> value) const
+{
+	if (const int index = sqlite3_bind_parameter_index(static_cast<sqlite3_stmt*>(m_stmt), name.data()))
+	{
+		return Bind(index, value);
+	}
+	return false;
+}
+
 void SQLite::Statement::ExecuteStep()
 {
 	switch (sqlite3_step(static_cast<sqlite3_stmt*>(m_stmt)))
@@ -174,18 +262,32 @@ void SQLite::Statement::ExecuteStep()
 		case SQLITE_DONE:
 			m_hasRow = false;
 			m_done = true;
+			m_failed = false;
 			break;
 		case SQLITE_ROW:
 			m_hasRow = true;
 			m_done = false;
+			m_failed = false;
 			break;
 		default:
 			m_hasRow = false;
 			m_done = true;
+			m_failed = true;
 			break;
 	}
 }
 
+bool SQLite::Statement::Reset()
+{
+	sqlite3_stmt* stmt = static_cast<sqlite3_stmt*>(m_stmt);
+	m_done = false;
+	m_hasRow = false;
+	m_failed = false;
+	// sqlite3_reset returns the error of the last step, which is not relevant for the reset itself
+	sqlite3_reset(stmt);
+	return sqlite3_clear_bindings(stmt) == SQLITE_OK;
+}
+
 bool SQLite::Statement::GetText(int index, std::string& outStr) const
 {
 	if (!m_hasRow || index < 0 || index > m_columnCount)
@@ -256,5 +358,23 @@ bool SQLite::Statement::GetDouble(int index, double& outDouble) const
 
 	sqlite3_stmt* stmt = static_cast<sqlite3_stmt*>(m_stmt);
 	outDouble = sqlite3_column_double(stmt, index);
-	return false;
+	return true;
+}
+
+bool SQLite::Statement::GetBlob(int index, std::span<const Byte>& outBlob) const
+{
+	if (!m_hasRow || index < 0 || index > m_columnCount)
+	{
+		return false;
+	}
+
+	sqlite3_stmt* stmt = static_cast<sqlite3_stmt*>(m_stmt);
+	if (sqlite3_column_type(stmt, index) != SQLITE_BLOB)
+	{
+		return false;
+	}
+
+	const Byte* blob = static_cast<const Byte*>(sqlite3_column_blob(stmt, index));
+	outBlob = std::span<const Byte>(blob, static_cast<size_t>(sqlite3_column_bytes(stmt, index)));
+	return true;
 }
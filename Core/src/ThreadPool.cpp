@@ -1,124 +1,411 @@
 // Copyright 2021 <github.com/razaqq>
 
-#include "Core/Defer.hpp"
 #include "Core/ThreadPool.hpp"
 
+#include <array>
+#include <atomic>
 #include <cassert>
-#include <future>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <vector>
 
 
+using PotatoAlert::Core::TaskPriority;
 using PotatoAlert::Core::ThreadPool;
+using PotatoAlert::Core::Detail::TaskNode;
 
-ThreadPool::ThreadPool(size_t threadCount) : m_inFlight(0)
+namespace {
+
+// recycles the blocks of finished tasks, tasks are usually allocated and freed at a high rate by the same threads
+struct TaskNodeCache
+{
+	static constexpr size_t MaxBlocks = 256;
+
+	std::vector<void*> Blocks;
+
+	~TaskNodeCache()
+	{
+		for (void* block : Blocks)
+		{
+			::operator delete(block, TaskNode::TaskNodeBlockSize);
+		}
+	}
+};
+
+thread_local TaskNodeCache t_taskNodeCache;
+
+// the chase-lev deque as described in "Correct and Efficient Work-Stealing for Weak Memory Models" by Lê et al.
+// only the owning worker pushes and pops at the bottom, any thread can steal from the top
+class WorkStealingDeque
+{
+public:
+	WorkStealingDeque() : m_array(new Array(InitialCapacity))
+	{
+		m_arrays.emplace_back(m_array.load(std::memory_order_relaxed));
+	}
+
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque(WorkStealingDeque&&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(WorkStealingDeque&&) = delete;
+
+	void Push(TaskNode* task)
+	{
+		const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		const int64_t top = m_top.load(std::memory_order_acquire);
+		Array* array = m_array.load(std::memory_order_relaxed);
+
+		if (bottom - top > array->Capacity - 1)
+		{
+			array = Grow(array, bottom, top);
+		}
+
+		array->Put(bottom, task);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	TaskNode* Pop()
+	{
+		const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		Array* array = m_array.load(std::memory_order_relaxed);
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		TaskNode* task = array->Get(bottom);
+		if (top == bottom)
+		{
+			// the last task, which a thief might be stealing at the same time
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				task = nullptr;
+			}
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+
+	TaskNode* Steal()
+	{
+		int64_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		TaskNode* task = m_array.load(std::memory_order_acquire)->Get(top);
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+		return task;
+	}
+
+private:
+	struct Array
+	{
+		explicit Array(int64_t capacity) : Capacity(capacity), Tasks(new std::atomic<TaskNode*>[static_cast<size_t>(capacity)]) {}
+
+		TaskNode* Get(int64_t index) const
+		{
+			return Tasks[static_cast<size_t>(index & (Capacity - 1))].load(std::memory_order_relaxed);
+		}
+
+		void Put(int64_t index, TaskNode* task) const
+		{
+			Tasks[static_cast<size_t>(index & (Capacity - 1))].store(task, std::memory_order_relaxed);
+		}
+
+		int64_t Capacity;
+		std::unique_ptr<std::atomic<TaskNode*>[]> Tasks;
+	};
+
+	Array* Grow(const Array* array, int64_t bottom, int64_t top)
+	{
+		Array* grown = m_arrays.emplace_back(std::make_unique<Array>(array->Capacity * 2)).get();
+		for (int64_t i = top; i < bottom; i++)
+		{
+			grown->Put(i, array->Get(i));
+		}
+		// thieves might still read from the old array, so it is only freed together with the deque
+		m_array.store(grown, std::memory_order_release);
+		return grown;
+	}
+
+	static constexpr int64_t InitialCapacity = 256;
+
+	alignas(64) std::atomic<int64_t> m_top = 0;
+	alignas(64) std::atomic<int64_t> m_bottom = 0;
+	alignas(64) std::atomic<Array*> m_array;
+	std::vector<std::unique_ptr<Array>> m_arrays;
+};
+
+}  // namespace
+
+void* TaskNode::operator new(size_t size)
+{
+	if (size <= TaskNodeBlockSize)
+	{
+		std::vector<void*>& blocks = t_taskNodeCache.Blocks;
+		if (!blocks.empty())
+		{
+			void* block = blocks.back();
+			blocks.pop_back();
+			return block;
+		}
+		return ::operator new(TaskNodeBlockSize);
+	}
+	return ::operator new(size);
+}
+
+void TaskNode::operator delete(void* ptr, size_t size)
+{
+	if (size <= TaskNodeBlockSize)
+	{
+		std::vector<void*>& blocks = t_taskNodeCache.Blocks;
+		if (blocks.size() < TaskNodeCache::MaxBlocks)
+		{
+			if (blocks.capacity() == 0)
+			{
+				blocks.reserve(TaskNodeCache::MaxBlocks);
+			}
+			blocks.emplace_back(ptr);
+			return;
+		}
+		::operator delete(ptr, TaskNodeBlockSize);
+		return;
+	}
+	::operator delete(ptr, size);
+}
+
+struct ThreadPool::Worker
 {
-	std::unique_lock<std::mutex> lock(m_queueMutex);
+	ThreadPool* Pool;
+	uint32_t Index;
+	// picks the first victim to steal from, so idle workers do not all go for the same deque
+	uint32_t RandomState;
+	std::array<WorkStealingDeque, PriorityCount> Deques;
+	std::thread Thread;
+};
 
-	m_threads.reserve(threadCount);
+thread_local ThreadPool::Worker* ThreadPool::s_currentWorker = nullptr;
 
-	for (size_t i = 0; i <= threadCount; i++)
-		StartWorker(i, lock);
+ThreadPool::ThreadPool(size_t threadCount)
+{
+	threadCount = std::max<size_t>(threadCount, 1);
+
+	m_workers.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; i++)
+	{
+		std::unique_ptr<Worker>& worker = m_workers.emplace_back(std::make_unique<Worker>());
+		worker->Pool = this;
+		worker->Index = static_cast<uint32_t>(i);
+		worker->RandomState = static_cast<uint32_t>(i) * 2654435761u + 1u;
+	}
+
+	// the workers steal from each other, so all of them have to exist before the first one starts
+	for (const std::unique_ptr<Worker>& worker : m_workers)
+	{
+		worker->Thread = std::thread(&ThreadPool::RunWorker, this, worker.get());
+	}
 }
 
 ThreadPool::~ThreadPool()
 {
-	std::unique_lock<std::mutex> lock(m_queueMutex);
-	m_isStopping = true;
-	m_conditionConsumers.notify_all();
-	m_conditionProducers.notify_all();
-	m_conditionConsumers.wait(lock, [this]() { return this->m_threads.empty(); });
+	{
+		std::unique_lock lock(m_sleepMutex);
+		m_isStopping = true;
+	}
+	m_sleepCondition.notify_all();
+
+	for (const std::unique_ptr<Worker>& worker : m_workers)
+	{
+		if (worker->Thread.joinable())
+		{
+			worker->Thread.join();
+		}
+	}
 	assert(m_inFlight == 0);
 }
 
 void ThreadPool::WaitUntilEmpty()
 {
-	std::unique_lock<std::mutex> lock(m_queueMutex);
-	m_conditionProducers.wait(lock, [this]() { return m_tasks.empty(); });
+	std::unique_lock lock(m_waitMutex);
+	m_waitCondition.wait(lock, [this]() { return m_queued.load() == 0; });
 }
 
 void ThreadPool::WaitUntilNothingInFlight()
 {
-	std::unique_lock<std::mutex> lock(m_inFlightMutex);
-	m_inFlightCondition.wait(lock, [this]() { return m_inFlight == 0; });
+	std::unique_lock lock(m_waitMutex);
+	m_waitCondition.wait(lock, [this]() { return m_inFlight.load() == 0; });
+}
+
+void ThreadPool::Push(TaskNode* task, TaskPriority priority)
+{
+	const size_t lane = static_cast<size_t>(priority);
+	assert(lane < PriorityCount);
+
+	m_inFlight.fetch_add(1, std::memory_order_relaxed);
+	// counted before it is visible, so the count of queued tasks never drops below zero
+	m_queuedByPriority[lane].fetch_add(1, std::memory_order_seq_cst);
+	m_queued.fetch_add(1, std::memory_order_seq_cst);
+
+	Worker* worker = s_currentWorker;
+	if (worker && worker->Pool == this)
+	{
+		worker->Deques[lane].Push(task);
+	}
+	else
+	{
+		std::unique_lock lock(m_injectionMutex);
+		m_injection[lane].emplace_back(task);
+		m_injectionSize[lane].fetch_add(1, std::memory_order_release);
+	}
+
+	// pairs with the sleeping workers checking the queued count, either they see the task or we see them sleeping
+	if (m_sleeping.load(std::memory_order_seq_cst) > 0)
+	{
+		std::unique_lock lock(m_sleepMutex);
+		m_sleepCondition.notify_one();
+	}
+}
+
+TaskNode* ThreadPool::PopInjected(size_t priority)
+{
+	if (m_injectionSize[priority].load(std::memory_order_acquire) == 0)
+	{
+		return nullptr;
+	}
+
+	std::unique_lock lock(m_injectionMutex);
+	std::deque<TaskNode*>& injection = m_injection[priority];
+	if (injection.empty())
+	{
+		return nullptr;
+	}
+
+	TaskNode* task = injection.front();
+	injection.pop_front();
+	m_injectionSize[priority].fetch_sub(1, std::memory_order_relaxed);
+	return task;
 }
 
-void ThreadPool::StartWorker(size_t id, const std::unique_lock<std::mutex>& lock)
+TaskNode* ThreadPool::FindTask(Worker* self, size_t priority)
 {
-	assert(lock.owns_lock() && lock.mutex() == &m_queueMutex);
-	assert(id <= m_threads.size());
+	if (TaskNode* task = self->Deques[priority].Pop())
+	{
+		return task;
+	}
 
-	auto workerFunc = [this, id]()
+	if (TaskNode* task = PopInjected(priority))
 	{
-		while (true)
+		return task;
+	}
+
+	// xorshift, only has to spread the victims a bit
+	uint32_t& state = self->RandomState;
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	const size_t count = m_workers.size();
+	const size_t start = state % count;
+	for (size_t i = 0; i < count; i++)
+	{
+		Worker* victim = m_workers[(start + i) % count].get();
+		if (victim == self)
 		{
-			std::function<void()> task;
-			bool notify;
+			continue;
+		}
 
-			{
-				std::unique_lock<std::mutex> l(m_queueMutex);
-				m_conditionConsumers.wait(l, [this]()
-				{
-					return m_isStopping || !m_tasks.empty();
-				});
-
-				// deal with downsizing of thread pool or shutdown
-				if (m_isStopping && m_tasks.empty())
-				{
-					// detach this worker, effectively marking it stopped
-					m_threads[id].detach();
-					// downsize the workers vector as much as possible
-					while (!m_threads.empty() && !m_threads.back().joinable())
-						m_threads.pop_back();
-					// if this is last worker, notify the destructor
-					if (m_threads.empty())
-						m_conditionConsumers.notify_all();
-					return;
-				}
-
-				if (!m_tasks.empty())
-				{
-					task = std::move(m_tasks.front());
-					m_tasks.pop();
-					notify = m_tasks.empty();
-				}
-				else
-				{
-					continue;
-				}
-			}
+		if (TaskNode* task = victim->Deques[priority].Steal())
+		{
+			return task;
+		}
+	}
+	return nullptr;
+}
 
-			PA_DEFER
-			{
-				if (std::atomic_fetch_sub_explicit(&m_inFlight, 1, std::memory_order_acq_rel) == 1)
-				{
-					std::unique_lock<std::mutex> l(m_inFlightMutex);
-					m_inFlightCondition.notify_all();
-				}
-			};
-
-			if (notify)
+void ThreadPool::OnTaskTaken(size_t priority)
+{
+	m_queuedByPriority[priority].fetch_sub(1, std::memory_order_relaxed);
+	if (m_queued.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		std::unique_lock lock(m_waitMutex);
+		m_waitCondition.notify_all();
+	}
+}
+
+void ThreadPool::OnTaskDone()
+{
+	if (m_inFlight.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		std::unique_lock lock(m_waitMutex);
+		m_waitCondition.notify_all();
+	}
+}
+
+void ThreadPool::RunWorker(Worker* self)
+{
+	s_currentWorker = self;
+
+	while (true)
+	{
+		// the lanes are checked from the highest priority down, empty ones are skipped without touching any deque
+		TaskNode* task = nullptr;
+		size_t priority = 0;
+		for (; priority < PriorityCount; priority++)
+		{
+			if (m_queuedByPriority[priority].load(std::memory_order_acquire) > 0)
 			{
-				std::unique_lock<std::mutex> l(m_queueMutex);
-				m_conditionProducers.notify_all();
+				task = FindTask(self, priority);
+				if (task)
+					break;
 			}
+		}
 
-			task();
+		if (task)
+		{
+			OnTaskTaken(priority);
+			task->Run();
+			delete task;
+			OnTaskDone();
+			continue;
 		}
-	};
 
-	if (id < m_threads.size())
-	{
-		std::thread& worker = m_threads[id];
-		// start only if not already running
-		if (!worker.joinable())
+		// a task might be queued but not visible yet or a steal lost a race, try again before going to sleep
+		if (m_queued.load(std::memory_order_seq_cst) > 0)
 		{
-			worker = std::thread(workerFunc);
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock lock(m_sleepMutex);
+		m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+		m_sleepCondition.wait(lock, [this]()
+		{
+			return m_isStopping || m_queued.load(std::memory_order_seq_cst) > 0;
+		});
+		m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+
+		// tasks which are still running might push new ones, those are run by their own worker
+		if (m_isStopping && m_queued.load(std::memory_order_seq_cst) == 0)
+		{
+			s_currentWorker = nullptr;
+			return;
 		}
-	}
-	else
-	{
-		m_threads.emplace_back(workerFunc);
 	}
 }
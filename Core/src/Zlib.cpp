@@ -3,19 +3,40 @@
 #define ZLIB_CONST
 
 #include "Core/Bytes.hpp"
+#include "Core/Defer.hpp"
+#include "Core/Metrics.hpp"
 #include "Core/Zlib.hpp"
 
 #include "zlib.h"
 
-#include <cstring>
+#include <array>
+#include <functional>
 #include <span>
 #include <vector>
 
 
-std::vector<Byte> PotatoAlert::Core::Zlib::Inflate(std::span<const Byte> in, bool hasHeader)
+using PotatoAlert::Core::Byte;
+
+std::vector<Byte> PotatoAlert::Core::Zlib::Inflate(std::span<const Byte> in, bool hasHeader, std::span<const Byte> dictionary)
 {
 	std::vector<Byte> out;
-	unsigned char chunk[2048];
+
+	const bool success = InflateChunked(in, [&out](std::span<const Byte> chunk) -> bool
+	{
+		out.insert(out.end(), chunk.begin(), chunk.end());
+		return true;
+	}, hasHeader, dictionary);
+
+	if (!success)
+	{
+		out.resize(0);
+	}
+	return out;
+}
+
+bool PotatoAlert::Core::Zlib::InflateChunked(std::span<const Byte> in, const std::function<bool(std::span<const Byte>)>& consumer, bool hasHeader, std::span<const Byte> dictionary)
+{
+	std::array<Byte, 32 * 1024> chunk;
 
 	z_stream stream = {};
 	int ret = 0;
@@ -24,35 +45,83 @@ std::vector<Byte> PotatoAlert::Core::Zlib::Inflate(std::span<const Byte> in, boo
 	else
 		ret = inflateInit2(&stream, -15);
 
+	if (ret != Z_OK)
+	{
+		return false;
+	}
+	PA_DEFER
+	{
+		inflateEnd(&stream);
+	};
+
 	stream.next_in = reinterpret_cast<const Bytef*>(in.data());
 	stream.avail_in = static_cast<uInt>(in.size());
 
 	do {
-		do {
-			stream.next_out = chunk;
-			stream.avail_out = sizeof(chunk);
+		stream.next_out = chunk.data();
+		stream.avail_out = static_cast<uInt>(chunk.size());
 
-			ret = inflate(&stream, Z_NO_FLUSH);
-			switch (ret)
+		ret = inflate(&stream, Z_NO_FLUSH);
+		if (ret == Z_NEED_DICT && !dictionary.empty())
+		{
+			// fails with Z_DATA_ERROR if it is not the dictionary the stream was deflated with
+			if (inflateSetDictionary(&stream, dictionary.data(), static_cast<uInt>(dictionary.size())) != Z_OK)
 			{
-				case Z_OK:
-				case Z_STREAM_END:
-					break;
-
-				default:
-					out.resize(0);
-					goto exit;
+				return false;
 			}
+			ret = inflate(&stream, Z_NO_FLUSH);
+		}
 
-			size_t size = sizeof(chunk) - stream.avail_out;
+		switch (ret)
+		{
+			case Z_OK:
+			case Z_STREAM_END:
+				break;
 
-			size_t pos = out.size();
-			out.resize(out.size() + size);
-			std::memcpy(out.data() + pos, chunk, size);
-		} while (stream.avail_out == 0);
+			default:
+				return false;
+		}
+
+		const size_t size = chunk.size() - stream.avail_out;
+		if (size > 0 && !consumer(std::span<const Byte>{ chunk.data(), size }))
+		{
+			return false;
+		}
 	} while (ret != Z_STREAM_END);
 
-exit:
-	inflateEnd(&stream);
+	PA_METRIC_COUNT("zlib.bytes_inflated", stream.total_out);
+	return true;
+}
+
+std::vector<Byte> PotatoAlert::Core::Zlib::Deflate(std::span<const Byte> in, int level, std::span<const Byte> dictionary)
+{
+	z_stream stream = {};
+	if (deflateInit(&stream, level) != Z_OK)
+	{
+		return {};
+	}
+	PA_DEFER
+	{
+		deflateEnd(&stream);
+	};
+
+	if (!dictionary.empty() && deflateSetDictionary(&stream, dictionary.data(), static_cast<uInt>(dictionary.size())) != Z_OK)
+	{
+		return {};
+	}
+
+	// the bound is large enough to deflate everything in a single call
+	std::vector<Byte> out(deflateBound(&stream, static_cast<uLong>(in.size())));
+	stream.next_in = reinterpret_cast<const Bytef*>(in.data());
+	stream.avail_in = static_cast<uInt>(in.size());
+	stream.next_out = out.data();
+	stream.avail_out = static_cast<uInt>(out.size());
+
+	if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
+	{
+		return {};
+	}
+
+	out.resize(stream.total_out);
 	return out;
 }
@@ -2,12 +2,16 @@
 #pragma once
 
 #include "Core/Bytes.hpp"
+#include "Core/Format.hpp"
+#include "Core/Result.hpp"
 
 #include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -18,6 +22,8 @@ using UnpackError = std::string;
 template<typename T>
 using UnpackResult = Core::Result<T, UnpackError>;
 
+#define PA_UNPACK_ERROR(...) (::std::unexpected(::PotatoAlert::GameFileUnpack::UnpackError(fmt::format(__VA_ARGS__))))
+
 static constexpr uint32_t HeaderSize = 0x38;
 static constexpr uint32_t HeaderDataOffset = 0x10;  // size until version
 struct IdxHeader
@@ -44,7 +50,7 @@ static_assert(sizeof(IdxHeader) == HeaderSize);
 static constexpr uint32_t NodeSize = 0x20;
 struct Node
 {
-	std::string Name;
+	std::string_view Name;  // points into the idx data
 	uint64_t Id;
 	uint64_t Parent;
 
@@ -71,12 +77,13 @@ struct FileRecord
 static constexpr uint32_t VolumeSize = 0x18;
 struct Volume
 {
-	std::string Name;
+	std::string_view Name;  // points into the idx data
 	uint64_t Id;
 
 	static UnpackResult<Volume> Parse(std::span<const Core::Byte> data, uint64_t offset, std::span<const Core::Byte> fullData);
 };
 
+// nodes and volumes reference the data passed to Parse, which therefore has to outlive the IdxFile
 struct IdxFile
 {
 	std::string_view PkgName;
@@ -105,19 +112,26 @@ private:
 	TreeNode& CreatePath(std::string_view path);
 };
 
+class IdxCache;
+
 class Unpacker
 {
 public:
-	explicit Unpacker(std::filesystem::path pkgPath, std::filesystem::path idxPath);
+	// if a cache file is given, the parsed idx files are persisted there and only re-parsed when they changed
+	explicit Unpacker(std::filesystem::path pkgPath, std::filesystem::path idxPath, std::filesystem::path cacheFile = {});
+	~Unpacker();
 	UnpackResult<void> Parse();
-	UnpackResult<void> Extract(std::string_view node, const std::filesystem::path& dst, bool preservePath = true) const;
+	// if verifyCrc is set, the crc32 of every extracted file is checked against its record
+	UnpackResult<void> Extract(std::string_view node, const std::filesystem::path& dst, bool preservePath = true, bool verifyCrc = false) const;
 
 private:
 	DirectoryTree m_directoryTree;
+	std::unique_ptr<IdxCache> m_cache;  // if valid, lookups are served from it and the tree stays empty
 	std::filesystem::path m_pkgPath;
 	std::filesystem::path m_idxPath;
+	std::filesystem::path m_cacheFile;
 
-	UnpackResult<void> ExtractFile(const FileRecord& fileRecord, const std::filesystem::path& dst) const;
+	UnpackResult<void> ExtractFile(const FileRecord& fileRecord, const std::filesystem::path& dst, bool verifyCrc) const;
 };
 
 }  // namespace PotatoAlert::GameFileUnpack
@@ -0,0 +1,83 @@
+// Copyright 2025 <github.com/razaqq>
+#pragma once
+
+#include "Core/Bytes.hpp"
+#include "Core/File.hpp"
+#include "Core/FileMapping.hpp"
+
+#include "GameFileUnpack/GameFileUnpack.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace PotatoAlert::GameFileUnpack {
+
+// identifies the state of a single .idx file, if any of these change the cache is invalidated
+struct IdxSource
+{
+	std::string Name;  // relative to the idx directory, with '/' as separator
+	uint64_t Size;
+	int64_t LastWriteTime;
+	uint32_t MurmurHash;
+
+	bool operator==(const IdxSource&) const = default;
+
+	static UnpackResult<IdxSource> Read(const std::filesystem::path& idxPath, const std::filesystem::path& file);
+};
+
+// a snapshot of the merged file records of all .idx files, stored as
+//
+//   CacheHeader
+//   CacheSource[SourceCount]
+//   CacheRecord[RecordCount]
+//   char[StringTableSize]
+//
+// all strings are offsets into the string table and the records are sorted by path,
+// so the file can be mapped and looked up as is, without building a directory tree from it
+class IdxCache
+{
+public:
+	static constexpr uint32_t Version = 2;
+
+	IdxCache() = default;
+	IdxCache(IdxCache&& src) noexcept;
+	IdxCache(const IdxCache&) = delete;
+	IdxCache& operator=(IdxCache&& src) noexcept;
+	IdxCache& operator=(const IdxCache&) = delete;
+	~IdxCache();
+
+	// maps the cache file and validates it against the current state of the idx files
+	static UnpackResult<IdxCache> Open(const std::filesystem::path& cacheFile, std::span<const IdxSource> sources);
+	static UnpackResult<void> Write(const std::filesystem::path& cacheFile, std::span<const IdxSource> sources, std::span<const FileRecord> records);
+
+	[[nodiscard]] size_t RecordCount() const
+	{
+		return m_recordCount;
+	}
+
+	[[nodiscard]] FileRecord Record(size_t index) const;
+	[[nodiscard]] std::string_view Path(size_t index) const;
+
+	// the indices [first, last) of the file at path or of all files below it, empty if there are none
+	[[nodiscard]] std::pair<size_t, size_t> Find(std::string_view path) const;
+
+private:
+	Core::File m_file;
+	Core::FileMapping m_mapping;
+	const Core::Byte* m_view = nullptr;
+	size_t m_viewSize = 0;
+
+	size_t m_recordCount = 0;
+	std::span<const Core::Byte> m_records;
+	std::string_view m_strings;
+
+	void Close();
+};
+
+}  // namespace PotatoAlert::GameFileUnpack
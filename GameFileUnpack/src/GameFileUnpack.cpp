@@ -1,51 +1,63 @@
 // Copyright 2022 <github.com/razaqq>
 
 #include "Core/Bytes.hpp"
+#include "Core/Crc32.hpp"
+#include "Core/Defer.hpp"
 #include "Core/File.hpp"
 #include "Core/FileMagic.hpp"
 #include "Core/FileMapping.hpp"
 #include "Core/Format.hpp"
 #include "Core/Log.hpp"
+#include "Core/Parallel.hpp"
 #include "Core/Result.hpp"
 #include "Core/String.hpp"
+#include "Core/ThreadPool.hpp"
 #include "Core/Zlib.hpp"
 
 #include "GameFileUnpack/GameFileUnpack.hpp"
+#include "GameFileUnpack/IdxCache.hpp"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <expected>
 #include <filesystem>
 #include <optional>
 #include <string>
 #include <span>
+#include <utility>
 #include <vector>
 
 
 using PotatoAlert::Core::Byte;
+using PotatoAlert::Core::Crc32;
 using PotatoAlert::Core::File;
 using PotatoAlert::Core::FileMagic;
 using PotatoAlert::Core::FileMapping;
 using PotatoAlert::Core::Take;
 using PotatoAlert::Core::TakeInto;
-using PotatoAlert::Core::TakeString;
 using PotatoAlert::GameFileUnpack::DirectoryTree;
 using TreeNode = DirectoryTree::TreeNode;
+using PotatoAlert::GameFileUnpack::IdxCache;
 using PotatoAlert::GameFileUnpack::IdxFile;
 using PotatoAlert::GameFileUnpack::IdxHeader;
+using PotatoAlert::GameFileUnpack::IdxSource;
 using PotatoAlert::GameFileUnpack::Node;
 using PotatoAlert::GameFileUnpack::FileRecord;
+using PotatoAlert::GameFileUnpack::HeaderSize;
 using PotatoAlert::GameFileUnpack::Unpacker;
 using PotatoAlert::GameFileUnpack::UnpackResult;
 using PotatoAlert::GameFileUnpack::Volume;
 
 namespace fs = std::filesystem;
 
-#define PA_UNPACK_ERROR(...) (::std::unexpected(::PotatoAlert::GameFileUnpack::UnpackError(fmt::format(__VA_ARGS__))))
-
 namespace {
 
-static bool ReadNullTerminatedString(std::span<const Byte> data, uint64_t offset, std::string& out)
+static constexpr uint64_t MappingAlignment = 64 * 1024;  // allocation granularity on windows, a multiple of the page size elsewhere
+
+// the returned view includes the terminating \0 and points into data, so it is only valid as long as data is
+static bool ReadNullTerminatedString(std::span<const Byte> data, uint64_t offset, std::string_view& out)
 {
 	size_t length = 0;
 	for (uint64_t i = offset; i < data.size(); i++)
@@ -62,14 +74,107 @@ static bool ReadNullTerminatedString(std::span<const Byte> data, uint64_t offset
 		return false;
 	}
 
-	std::span stringData = data.subspan(offset, length);
-	if (!TakeString(stringData, out, length))
+	out = std::string_view(reinterpret_cast<const char*>(data.data() + offset), length);
+	return true;
+}
+
+static UnpackResult<std::vector<FileRecord>> ParseIdxFile(const fs::path& path)
+{
+	const File file = File::Open(path, File::Flags::Open | File::Flags::Read);
+	if (!file)
 	{
-		LOG_ERROR("Failed to read string");
-		return false;
+		return PA_UNPACK_ERROR("Failed to open idxFile for reading: {}", File::LastError());
 	}
 
-	return true;
+	const uint64_t fileSize = file.Size();
+	if (fileSize < HeaderSize)
+	{
+		return PA_UNPACK_ERROR("Invalid IdxFile size {}", fileSize);
+	}
+
+	FileMapping mapping = FileMapping::Open(file, FileMapping::Flags::Read, fileSize);
+	if (!mapping)
+	{
+		return PA_UNPACK_ERROR("Failed to create idxFile mapping: {}", FileMapping::LastError());
+	}
+
+	const void* dataPtr = mapping.Map(FileMapping::Flags::Read, 0, fileSize);
+	if (dataPtr == nullptr)
+	{
+		return PA_UNPACK_ERROR("Failed to map idxFile into memory: {}", FileMapping::LastError());
+	}
+	PA_DEFER
+	{
+		mapping.Unmap(dataPtr, fileSize);
+	};
+
+	// node names are views into the mapping, the records get their own copies of the paths
+	PA_TRY(idxFile, IdxFile::Parse(std::span{ static_cast<const Byte*>(dataPtr), fileSize }));
+	for (FileRecord& fileRecord : idxFile.Files)
+	{
+		fileRecord.PkgName = idxFile.PkgName;
+	}
+	return std::move(idxFile.Files);
+}
+
+static UnpackResult<void> VerifyCrc(const FileRecord& fileRecord, uint32_t crc, bool verifyCrc)
+{
+	if (verifyCrc && crc != fileRecord.Crc32)
+	{
+		return PA_UNPACK_ERROR("File '{}' has invalid crc32 {:08X} != {:08X}", fileRecord.Path, crc, fileRecord.Crc32);
+	}
+	return {};
+}
+
+// inflates straight into the file through a fixed size buffer, so memory usage does not depend on the file size
+static UnpackResult<void> InflateFileData(const fs::path& file, const FileRecord& fileRecord, std::span<const Byte> data, bool verifyCrc)
+{
+	const File outFile = File::Open(file, File::Flags::Open | File::Flags::Write | File::Flags::Create);
+	if (!outFile)
+	{
+		return PA_UNPACK_ERROR("Failed to open outfile {} for writing: {}", file, File::LastError());
+	}
+
+	// this is only a hint to the filesystem to avoid fragmentation, so failing is fine
+	if (!outFile.Allocate(fileRecord.UncompressedSize))
+	{
+		LOG_TRACE("Failed to preallocate {} bytes for {}: {}", fileRecord.UncompressedSize, file, File::LastError());
+	}
+
+	// the crc is updated chunk by chunk while the inflated data is still in cache
+	uint32_t crc = 0;
+	uint64_t inflatedSize = 0;
+	bool writeFailed = false;
+	const bool inflated = PotatoAlert::Core::Zlib::InflateChunked(data, [&](std::span<const Byte> chunk) -> bool
+	{
+		if (verifyCrc)
+			crc = Crc32(crc, chunk);
+		inflatedSize += chunk.size();
+		if (inflatedSize > fileRecord.UncompressedSize || !outFile.WriteChunk(chunk))
+		{
+			writeFailed = inflatedSize <= fileRecord.UncompressedSize;
+			return false;
+		}
+		return true;
+	}, false);
+
+	if (writeFailed)
+	{
+		return PA_UNPACK_ERROR("Failed to write data to outfile {} - {}", file, File::LastError());
+	}
+
+	if (!inflated || inflatedSize != fileRecord.UncompressedSize)
+	{
+		return PA_UNPACK_ERROR("File '{}' had invalid size {} != {} after decompression", fileRecord.Path, inflatedSize, fileRecord.UncompressedSize);
+	}
+
+	// drop anything left over from a previous, larger version of this file
+	if (!outFile.Truncate())
+	{
+		return PA_UNPACK_ERROR("Failed to truncate outfile {} - {}", file, File::LastError());
+	}
+
+	return VerifyCrc(fileRecord, crc, verifyCrc);
 }
 
 static UnpackResult<void> WriteFileData(const fs::path& file, std::span<const Byte> data)
@@ -139,10 +244,13 @@ DirectoryTree::TreeNode& DirectoryTree::CreatePath(std::string_view path)
 	return *current;
 }
 
-Unpacker::Unpacker(fs::path pkgPath, fs::path idxPath) : m_pkgPath(std::move(pkgPath)), m_idxPath(std::move(idxPath))
+Unpacker::Unpacker(fs::path pkgPath, fs::path idxPath, fs::path cacheFile)
+	: m_pkgPath(std::move(pkgPath)), m_idxPath(std::move(idxPath)), m_cacheFile(std::move(cacheFile))
 {
 }
 
+Unpacker::~Unpacker() = default;
+
 UnpackResult<void> Unpacker::Parse()
 {
 	if (!fs::exists(m_idxPath))
@@ -157,62 +265,137 @@ UnpackResult<void> Unpacker::Parse()
 		return PA_UNPACK_ERROR("Failed to iterate IdxPath: {}", ec.message());
 	}
 
+	std::vector<fs::path> idxFiles;
 	for (const fs::directory_entry& entry : it)
 	{
 		if (entry.is_regular_file() && entry.path().extension() == ".idx")
 		{
-			if (File file = File::Open(entry.path(), File::Flags::Open | File::Flags::Read))
+			idxFiles.emplace_back(entry.path());
+		}
+	}
+	std::ranges::sort(idxFiles);
+
+	std::vector<IdxSource> sources;
+	if (!m_cacheFile.empty())
+	{
+		sources.reserve(idxFiles.size());
+		for (const fs::path& idxFile : idxFiles)
+		{
+			PA_TRY(source, IdxSource::Read(m_idxPath, idxFile));
+			sources.emplace_back(std::move(source));
+		}
+
+		if (fs::exists(m_cacheFile))
+		{
+			// the records stay in the mapped cache, so a hit costs no more than validating it
+			if (UnpackResult<IdxCache> cache = IdxCache::Open(m_cacheFile, sources))
 			{
-				if (std::vector<Byte> data; file.ReadAll(data))
-				{
-					PA_TRY(idxFile, IdxFile::Parse(data));
-					for (FileRecord& fileRecord : idxFile.Files)
-					{
-						fileRecord.PkgName = idxFile.PkgName;
-						m_directoryTree.Insert(fileRecord);
-					}
-				}
-				else
-				{
-					return PA_UNPACK_ERROR("Failed to read idxFile: {}", File::LastError());
-				}
+				m_cache = std::make_unique<IdxCache>(std::move(cache.value()));
+				return {};
 			}
 			else
 			{
-				return PA_UNPACK_ERROR("Failed to open idxFile for reading: {}", File::LastError());
+				LOG_INFO("Idx cache {} is invalid, parsing idx files: {}", m_cacheFile, cache.error());
 			}
 		}
 	}
 
+	// every idx file is parsed into its own record table straight from the mapped file
+	Core::ThreadPool threadPool;
+	std::vector<UnpackResult<std::vector<FileRecord>>> parsed(idxFiles.size());
+	Core::ParallelTransform(threadPool, std::span(idxFiles), std::span(parsed), ParseIdxFile, 1);
+
+	std::vector<std::vector<FileRecord>> fileRecords;
+	std::vector<size_t> offsets;
+	fileRecords.reserve(parsed.size());
+	offsets.reserve(parsed.size());
+	size_t recordCount = 0;
+	for (UnpackResult<std::vector<FileRecord>>& result : parsed)
+	{
+		PA_TRY(table, std::move(result));
+		offsets.emplace_back(recordCount);
+		recordCount += table.size();
+		fileRecords.emplace_back(std::move(table));
+	}
+
+	// merge the tables into one, each table is moved into its own slice
+	std::vector<FileRecord> records(recordCount);
+	Core::ParallelFor(threadPool, 0, fileRecords.size(), [&fileRecords, &records, &offsets](size_t i)
+	{
+		std::ranges::move(fileRecords[i], records.begin() + static_cast<ptrdiff_t>(offsets[i]));
+	}, 1);
+
+	for (const FileRecord& fileRecord : records)
+	{
+		m_directoryTree.Insert(fileRecord);
+	}
+
+	if (!m_cacheFile.empty())
+	{
+		// a missing cache only costs time on the next parse, so don't fail because of it
+		PA_TRYV_OR_ELSE(IdxCache::Write(m_cacheFile, sources, records),
+		{
+			LOG_WARN("Failed to write idx cache {}: {}", m_cacheFile, error);
+		});
+	}
+
 	return {};
 }
 
-UnpackResult<void> Unpacker::Extract(std::string_view nodeName, const fs::path& dst, bool preservePath) const
+UnpackResult<void> Unpacker::Extract(std::string_view nodeName, const fs::path& dst, bool preservePath, bool verifyCrc) const
 {
-	const std::optional<DirectoryTree::TreeNode> nodeResult = m_directoryTree.Find(nodeName);
-	if (!nodeResult)
+	std::vector<FileRecord> files;
+	if (m_cache)
 	{
-		return PA_UNPACK_ERROR("There exists no node with name {} in directory tree", nodeName);
+		const auto [first, last] = m_cache->Find(nodeName);
+		files.reserve(last - first);
+		for (size_t i = first; i < last; i++)
+		{
+			files.emplace_back(m_cache->Record(i));
+		}
 	}
-	TreeNode rootNode = nodeResult.value();
-
-	std::vector<TreeNode*> stack = { &rootNode };
-
-	while (!stack.empty())
+	else if (const std::optional<DirectoryTree::TreeNode> nodeResult = m_directoryTree.Find(nodeName))
 	{
-		TreeNode* node = stack.back();
-		stack.pop_back();
-		for (auto& child : node->Nodes | std::views::values)
+		std::vector<const TreeNode*> stack = { &nodeResult.value() };
+		while (!stack.empty())
 		{
-			stack.push_back(&child);
+			const TreeNode* node = stack.back();
+			stack.pop_back();
+			for (const TreeNode& child : node->Nodes | std::views::values)
+			{
+				stack.push_back(&child);
+			}
+
+			if (node->File)
+			{
+				files.emplace_back(node->File.value());
+			}
 		}
+	}
+
+	if (files.empty())
+	{
+		return PA_UNPACK_ERROR("There exists no node with name {} in directory tree", nodeName);
+	}
 
-		if (node->File)
+	// output paths and directories are created one file at a time by the source,
+	// reading, inflating and writing the files runs in parallel with a bounded number of them in flight
+	Core::ThreadPool threadPool;
+	size_t next = 0;
+	std::optional<UnpackError> error;  // only written by whoever sets failed first
+	std::atomic<bool> failed = false;
+
+	Core::ParallelPipeline(threadPool, threadPool.ThreadCount() * 2,
+		[&]() -> std::optional<std::pair<const FileRecord*, fs::path>>
 		{
+			if (next == files.size() || failed.load(std::memory_order_acquire))
+				return std::nullopt;
+
+			const FileRecord& file = files[next++];
 			fs::path filePath;
 			if (!preservePath)
 			{
-				const fs::path rel = fs::relative(node->File->Path, nodeName);
+				const fs::path rel = fs::relative(file.Path, nodeName);
 				if (rel == fs::path("."))
 					filePath = dst / fs::path(nodeName).filename();
 				else
@@ -220,7 +403,7 @@ UnpackResult<void> Unpacker::Extract(std::string_view nodeName, const fs::path&
 			}
 			else
 			{
-				filePath = dst / node->File->Path;
+				filePath = dst / file.Path;
 			}
 
 			// create output directories if they don't exist yet
@@ -232,47 +415,74 @@ UnpackResult<void> Unpacker::Extract(std::string_view nodeName, const fs::path&
 				fs::create_directories(outDir, ec);
 				if (ec)
 				{
-					return PA_UNPACK_ERROR("Failed to create game file scripts directory: {}", ec);
+					if (!failed.exchange(true, std::memory_order_acq_rel))
+					{
+						error = fmt::format("Failed to create game file scripts directory: {}", ec);
+					}
+					return std::nullopt;
 				}
 			}
 
-			PA_TRYV(ExtractFile(node->File.value(), filePath));
-		}
-	}
+			return std::pair{ &file, std::move(filePath) };
+		},
+		[&](UnpackResult<void>&& result)
+		{
+			if (!result && !failed.exchange(true, std::memory_order_acq_rel))
+			{
+				error = std::move(result.error());
+			}
+		},
+		[this, verifyCrc](std::pair<const FileRecord*, fs::path>&& job)
+		{
+			return ExtractFile(*job.first, job.second, verifyCrc);
+		});
 
+	if (error)
+	{
+		return PA_UNPACK_ERROR("{}", *error);
+	}
 	return {};
 }
 
-UnpackResult<void> Unpacker::ExtractFile(const FileRecord& fileRecord, const fs::path& dst) const
+UnpackResult<void> Unpacker::ExtractFile(const FileRecord& fileRecord, const fs::path& dst, bool verifyCrc) const
 {
 	if (const File inFile = File::Open(m_pkgPath / fileRecord.PkgName, File::Flags::Open | File::Flags::Read))
 	{
 		uint64_t fileSize = inFile.Size();
+		if (fileRecord.Offset + fileRecord.Size > fileSize)
+		{
+			return PA_UNPACK_ERROR("Got offset ({} - {}) out of size bounds ({})",
+				fileRecord.Offset, fileRecord.Offset + fileRecord.Size, fileSize);
+		}
+
+		if (fileRecord.Size == 0)
+		{
+			PA_TRYV(VerifyCrc(fileRecord, 0, verifyCrc));
+			return WriteFileData(dst, std::span<const Byte>{});
+		}
+
 		if (FileMapping mapping = FileMapping::Open(inFile, FileMapping::Flags::Read, fileSize))
 		{
-			if (const void* dataPtr = mapping.Map(FileMapping::Flags::Read, 0, fileSize))
+			// only map the range of this record, the offset has to be aligned to the allocation granularity
+			const uint64_t mapOffset = fileRecord.Offset - fileRecord.Offset % MappingAlignment;
+			const size_t mapSize = static_cast<size_t>(fileRecord.Offset - mapOffset + fileRecord.Size);
+			if (const void* dataPtr = mapping.Map(FileMapping::Flags::Read, mapOffset, mapSize))
 			{
-				if (fileRecord.Offset + fileRecord.Size > fileSize)
+				PA_DEFER
 				{
-					return PA_UNPACK_ERROR("Got offset ({} - {}) out of size bounds ({})",
-						fileRecord.Offset, fileRecord.Offset + fileRecord.Size, fileSize);
-				}
+					mapping.Unmap(dataPtr, mapSize);
+				};
+
+				const std::span data = std::span{ static_cast<const Byte*>(dataPtr), mapSize }.subspan(fileRecord.Offset - mapOffset);
 
 				// check if data is compressed and inflate
-				const std::span data{ static_cast<const Byte*>(dataPtr), fileSize };
 				if (fileRecord.Size != fileRecord.UncompressedSize)
 				{
-					std::vector<Byte> inflated = Core::Zlib::Inflate(
-						data.subspan(fileRecord.Offset, fileRecord.Size), false
-					);
-					if (inflated.size() != fileRecord.UncompressedSize)
-					{
-						return PA_UNPACK_ERROR("File '{}' had invalid size {} != {} after decompression", fileRecord.Path, inflated.size(), fileRecord.UncompressedSize);
-					}
-					return WriteFileData(dst, std::span{ inflated });
+					return InflateFileData(dst, fileRecord, data, verifyCrc);
 				}
 
-				return WriteFileData(dst, data.subspan(fileRecord.Offset, fileRecord.Size));
+				PA_TRYV(VerifyCrc(fileRecord, verifyCrc ? Crc32(data) : 0, verifyCrc));
+				return WriteFileData(dst, data);
 			}
 			return PA_UNPACK_ERROR("Failed to map PkgFile into memory: {}", FileMapping::LastError());
 		}
@@ -346,7 +556,7 @@ UnpackResult<Node> Node::Parse(std::span<const Byte> data, uint64_t offset, std:
 		return PA_UNPACK_ERROR("Node has invalid name length {} != {}", nameLength, node.Name.size());
 	}
 
-	node.Name.pop_back();  // remove the double \0, otherwise we get issues down the line
+	node.Name.remove_suffix(1);  // remove the double \0, otherwise we get issues down the line
 
 	if (!TakeInto(data, node.Id))
 		return PA_UNPACK_ERROR("Failed read node.Id");
@@ -383,11 +593,10 @@ UnpackResult<FileRecord> FileRecord::Parse(std::span<const Byte> data, const std
 	std::vector<std::string_view> paths;
 	uint64_t current = fileRecord.NodeId;
 
-	while (nodes.contains(current))
+	for (auto it = nodes.find(current); it != nodes.end(); it = nodes.find(current))
 	{
-		const Node& node = nodes.at(current);
-		current = node.Parent;
-		paths.emplace_back(node.Name);
+		current = it->second.Parent;
+		paths.emplace_back(it->second.Name);
 	}
 
 	std::ranges::reverse(paths);
@@ -430,7 +639,7 @@ UnpackResult<Volume> Volume::Parse(std::span<const Byte> data, uint64_t offset,
 		return PA_UNPACK_ERROR("Volume has invalid name length {} != {}", nameLength, volume.Name.size());
 	}
 
-	volume.Name.pop_back();  // remove the double \0, otherwise we get issues down the line
+	volume.Name.remove_suffix(1);  // remove the double \0, otherwise we get issues down the line
 
 	TakeInto(data, volume.Id);
 
@@ -474,12 +683,16 @@ UnpackResult<IdxFile> IdxFile::Parse(std::span<const Byte> data)
 	PA_TRY(fileRecordData, getData(header.FileRecordTablePtr + HeaderDataOffset, header.FileCount * FileRecordSize));
 	PA_TRY(volumeData, getData(header.VolumeTablePtr + HeaderDataOffset, header.VolumeCount * VolumeSize));
 
+	file.Nodes.reserve(header.NodeCount);
+	file.Files.reserve(header.FileCount);
+	file.Volumes.reserve(header.VolumeCount);
+
 	// parse nodes
 	for (uint32_t i = 0; i < header.NodeCount; i++)
 	{
 		const uint64_t offset = header.NodeTablePtr + HeaderDataOffset + i * NodeSize;
 		PA_TRY(node, Node::Parse(Take(nodeData, NodeSize), offset, originalData));
-		file.Nodes[node.Id] = node;
+		file.Nodes.insert_or_assign(node.Id, node);
 	}
 
 	// parse file records
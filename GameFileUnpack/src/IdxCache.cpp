@@ -0,0 +1,467 @@
+// Copyright 2025 <github.com/razaqq>
+
+#include "Core/Bytes.hpp"
+#include "Core/File.hpp"
+#include "Core/FileMagic.hpp"
+#include "Core/FileMapping.hpp"
+#include "Core/Format.hpp"
+#include "Core/Result.hpp"
+
+#include "GameFileUnpack/GameFileUnpack.hpp"
+#include "GameFileUnpack/IdxCache.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+using PotatoAlert::Core::Byte;
+using PotatoAlert::Core::File;
+using PotatoAlert::Core::FileMagic;
+using PotatoAlert::Core::FileMapping;
+using PotatoAlert::Core::Take;
+using PotatoAlert::Core::TakeInto;
+using PotatoAlert::GameFileUnpack::FileRecord;
+using PotatoAlert::GameFileUnpack::IdxCache;
+using PotatoAlert::GameFileUnpack::IdxHeader;
+using PotatoAlert::GameFileUnpack::IdxSource;
+using PotatoAlert::GameFileUnpack::UnpackResult;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct CacheHeader
+{
+	Byte Magic[4];
+	uint32_t Version;
+	uint32_t SourceCount;
+	uint32_t RecordCount;
+	uint64_t StringTableSize;
+};
+static_assert(sizeof(CacheHeader) == 0x18);
+
+struct CacheSource
+{
+	uint64_t NameOffset;
+	uint64_t NameLength;
+	uint64_t Size;
+	int64_t LastWriteTime;
+	uint32_t MurmurHash;
+	uint32_t Padding;
+};
+static_assert(sizeof(CacheSource) == 0x28);
+
+struct CacheRecord
+{
+	uint64_t PkgNameOffset;
+	uint64_t PkgNameLength;
+	uint64_t PathOffset;
+	uint64_t PathLength;
+	uint64_t NodeId;
+	uint64_t VolumeId;
+	uint64_t Offset;
+	uint64_t CompressionInfo;
+	uint32_t Size;
+	uint32_t Crc32;
+	uint64_t UncompressedSize;
+};
+static_assert(sizeof(CacheRecord) == 0x50);
+
+static constexpr Byte CacheMagic[4] = { 'P', 'A', 'I', 'C' };
+
+// keys are views into the strings that are added, so those have to outlive the table
+class StringTable
+{
+public:
+	std::pair<uint64_t, uint64_t> Add(std::string_view str)
+	{
+		if (auto it = m_offsets.find(str); it != m_offsets.end())
+		{
+			return { it->second, str.size() };
+		}
+
+		const uint64_t offset = m_data.size();
+		m_data.append(str);
+		m_offsets.emplace(str, offset);
+		return { offset, str.size() };
+	}
+
+	[[nodiscard]] std::string_view Data() const
+	{
+		return m_data;
+	}
+
+private:
+	std::string m_data;
+	std::unordered_map<std::string_view, uint64_t> m_offsets;
+};
+
+template<typename T>
+static void Append(std::vector<Byte>& out, const T& value)
+{
+	const size_t pos = out.size();
+	out.resize(pos + sizeof(T));
+	std::memcpy(out.data() + pos, &value, sizeof(T));
+}
+
+static UnpackResult<std::string_view> GetString(std::string_view strings, uint64_t offset, uint64_t length)
+{
+	if (offset > strings.size() || length > strings.size() - offset)
+	{
+		return PA_UNPACK_ERROR("Cache string ({} - {}) out of string table bounds ({})", offset, offset + length, strings.size());
+	}
+	return strings.substr(offset, length);
+}
+
+}  // namespace
+
+UnpackResult<IdxSource> IdxSource::Read(const fs::path& idxPath, const fs::path& file)
+{
+	std::error_code ec;
+	const uint64_t size = fs::file_size(file, ec);
+	if (ec)
+	{
+		return PA_UNPACK_ERROR("Failed to get size of idxFile {}: {}", file, ec);
+	}
+
+	const fs::file_time_type lastWriteTime = fs::last_write_time(file, ec);
+	if (ec)
+	{
+		return PA_UNPACK_ERROR("Failed to get last write time of idxFile {}: {}", file, ec);
+	}
+
+	const File idxFile = File::Open(file, File::Flags::Open | File::Flags::Read);
+	if (!idxFile)
+	{
+		return PA_UNPACK_ERROR("Failed to open idxFile for reading: {}", File::LastError());
+	}
+
+	std::vector<Byte> headerData;
+	if (size < HeaderSize || !idxFile.Read(headerData, HeaderSize))
+	{
+		return PA_UNPACK_ERROR("Failed to read header of idxFile {}: {}", file, File::LastError());
+	}
+	PA_TRY(header, IdxHeader::Parse(headerData));
+
+	return IdxSource
+	{
+		.Name = fs::relative(file, idxPath).generic_string(),
+		.Size = size,
+		.LastWriteTime = lastWriteTime.time_since_epoch().count(),
+		.MurmurHash = header.MurmurHash,
+	};
+}
+
+IdxCache::IdxCache(IdxCache&& src) noexcept
+	: m_file(std::move(src.m_file)),
+	  m_mapping(std::move(src.m_mapping)),
+	  m_view(std::exchange(src.m_view, nullptr)),
+	  m_viewSize(std::exchange(src.m_viewSize, 0)),
+	  m_recordCount(std::exchange(src.m_recordCount, 0)),
+	  m_records(std::exchange(src.m_records, {})),
+	  m_strings(std::exchange(src.m_strings, {}))
+{
+}
+
+IdxCache& IdxCache::operator=(IdxCache&& src) noexcept
+{
+	if (this != &src)
+	{
+		Close();
+		m_file = std::move(src.m_file);
+		m_mapping = std::move(src.m_mapping);
+		m_view = std::exchange(src.m_view, nullptr);
+		m_viewSize = std::exchange(src.m_viewSize, 0);
+		m_recordCount = std::exchange(src.m_recordCount, 0);
+		m_records = std::exchange(src.m_records, {});
+		m_strings = std::exchange(src.m_strings, {});
+	}
+	return *this;
+}
+
+IdxCache::~IdxCache()
+{
+	Close();
+}
+
+void IdxCache::Close()
+{
+	if (m_view != nullptr)
+	{
+		m_mapping.Unmap(m_view, m_viewSize);
+		m_view = nullptr;
+		m_viewSize = 0;
+	}
+	m_recordCount = 0;
+	m_records = {};
+	m_strings = {};
+}
+
+UnpackResult<IdxCache> IdxCache::Open(const fs::path& cacheFile, std::span<const IdxSource> sources)
+{
+	IdxCache cache;
+
+	cache.m_file = File::Open(cacheFile, File::Flags::Open | File::Flags::Read);
+	if (!cache.m_file)
+	{
+		return PA_UNPACK_ERROR("Failed to open idx cache for reading: {}", File::LastError());
+	}
+
+	const uint64_t fileSize = cache.m_file.Size();
+	if (fileSize < sizeof(CacheHeader))
+	{
+		return PA_UNPACK_ERROR("Invalid idx cache size {}", fileSize);
+	}
+
+	cache.m_mapping = FileMapping::Open(cache.m_file, FileMapping::Flags::Read, fileSize);
+	if (!cache.m_mapping)
+	{
+		return PA_UNPACK_ERROR("Failed to create idx cache file mapping: {}", FileMapping::LastError());
+	}
+
+	cache.m_view = static_cast<const Byte*>(cache.m_mapping.Map(FileMapping::Flags::Read, 0, fileSize));
+	if (cache.m_view == nullptr)
+	{
+		return PA_UNPACK_ERROR("Failed to map idx cache into memory: {}", FileMapping::LastError());
+	}
+	cache.m_viewSize = fileSize;
+
+	std::span data{ cache.m_view, cache.m_viewSize };
+
+	if (!FileMagic<CacheMagic[0], CacheMagic[1], CacheMagic[2], CacheMagic[3]>(data))
+	{
+		return PA_UNPACK_ERROR("Invalid idx cache magic");
+	}
+
+	CacheHeader header;
+	std::memcpy(&header, cache.m_view, sizeof(CacheHeader));
+	data = std::span{ cache.m_view, cache.m_viewSize }.subspan(sizeof(CacheHeader));
+
+	if (header.Version != Version)
+	{
+		return PA_UNPACK_ERROR("Idx cache has version {} != {}", header.Version, Version);
+	}
+
+	const uint64_t expectedSize = sizeof(CacheHeader) + header.SourceCount * sizeof(CacheSource) +
+		header.RecordCount * sizeof(CacheRecord) + header.StringTableSize;
+	if (fileSize != expectedSize)
+	{
+		return PA_UNPACK_ERROR("Idx cache has invalid size {} != {}", fileSize, expectedSize);
+	}
+
+	std::span sourceData = Take(data, header.SourceCount * sizeof(CacheSource));
+	cache.m_records = Take(data, header.RecordCount * sizeof(CacheRecord));
+	cache.m_recordCount = header.RecordCount;
+	cache.m_strings = std::string_view(reinterpret_cast<const char*>(data.data()), data.size());
+
+	if (header.SourceCount != sources.size())
+	{
+		return PA_UNPACK_ERROR("Idx cache has {} sources, but found {} idx files", header.SourceCount, sources.size());
+	}
+
+	for (const IdxSource& source : sources)
+	{
+		CacheSource cached;
+		TakeInto(sourceData, cached);
+		PA_TRY(name, GetString(cache.m_strings, cached.NameOffset, cached.NameLength));
+
+		if (name != source.Name || cached.Size != source.Size || cached.LastWriteTime != source.LastWriteTime ||
+			cached.MurmurHash != source.MurmurHash)
+		{
+			return PA_UNPACK_ERROR("Idx cache is outdated, idxFile {} changed", source.Name);
+		}
+	}
+
+	// a corrupt record must invalidate the whole cache, otherwise it would be extracted with an empty path
+	// this only reads the mapped records, the lookups later on rely on them being sorted
+	std::string_view previousPath;
+	for (size_t i = 0; i < cache.m_recordCount; i++)
+	{
+		CacheRecord cached;
+		std::memcpy(&cached, cache.m_records.data() + i * sizeof(CacheRecord), sizeof(CacheRecord));
+		PA_TRY(pkgName, GetString(cache.m_strings, cached.PkgNameOffset, cached.PkgNameLength));
+		PA_TRY(path, GetString(cache.m_strings, cached.PathOffset, cached.PathLength));
+		if (pkgName.empty() || path.empty())
+		{
+			return PA_UNPACK_ERROR("Idx cache record {} has an empty path", i);
+		}
+		if (i > 0 && path < previousPath)
+		{
+			return PA_UNPACK_ERROR("Idx cache record {} is not sorted by path", i);
+		}
+		previousPath = path;
+	}
+
+	return cache;
+}
+
+UnpackResult<void> IdxCache::Write(const fs::path& cacheFile, std::span<const IdxSource> sources, std::span<const FileRecord> records)
+{
+	StringTable strings;
+	std::vector<Byte> data;
+	data.reserve(sizeof(CacheHeader) + sources.size() * sizeof(CacheSource) + records.size() * sizeof(CacheRecord));
+
+	CacheHeader header =
+	{
+		.Magic = { CacheMagic[0], CacheMagic[1], CacheMagic[2], CacheMagic[3] },
+		.Version = Version,
+		.SourceCount = static_cast<uint32_t>(sources.size()),
+		.RecordCount = static_cast<uint32_t>(records.size()),
+		.StringTableSize = 0,
+	};
+	Append(data, header);
+
+	for (const IdxSource& source : sources)
+	{
+		const auto [nameOffset, nameLength] = strings.Add(source.Name);
+		Append(data, CacheSource
+		{
+			.NameOffset = nameOffset,
+			.NameLength = nameLength,
+			.Size = source.Size,
+			.LastWriteTime = source.LastWriteTime,
+			.MurmurHash = source.MurmurHash,
+			.Padding = 0,
+		});
+	}
+
+	std::vector<const FileRecord*> sorted;
+	sorted.reserve(records.size());
+	for (const FileRecord& record : records)
+	{
+		sorted.emplace_back(&record);
+	}
+	std::ranges::stable_sort(sorted, {}, [](const FileRecord* record) -> std::string_view { return record->Path; });
+
+	for (const FileRecord* recordPtr : sorted)
+	{
+		const FileRecord& record = *recordPtr;
+		const auto [pkgNameOffset, pkgNameLength] = strings.Add(record.PkgName);
+		const auto [pathOffset, pathLength] = strings.Add(record.Path);
+		Append(data, CacheRecord
+		{
+			.PkgNameOffset = pkgNameOffset,
+			.PkgNameLength = pkgNameLength,
+			.PathOffset = pathOffset,
+			.PathLength = pathLength,
+			.NodeId = record.NodeId,
+			.VolumeId = record.VolumeId,
+			.Offset = record.Offset,
+			.CompressionInfo = record.CompressionInfo,
+			.Size = record.Size,
+			.Crc32 = record.Crc32,
+			.UncompressedSize = record.UncompressedSize,
+		});
+	}
+
+	header.StringTableSize = strings.Data().size();
+	std::memcpy(data.data(), &header, sizeof(CacheHeader));
+	data.insert(data.end(), strings.Data().begin(), strings.Data().end());
+
+	// write to a temporary file first, so a crash never leaves a torn cache behind
+	fs::path tempFile = cacheFile;
+	tempFile += ".tmp";
+	{
+		const File file = File::Open(tempFile, File::Flags::Write | File::Flags::Create | File::Flags::Truncate);
+		if (!file || !file.Write<Byte>(data))
+		{
+			return PA_UNPACK_ERROR("Failed to write idx cache {}: {}", tempFile, File::LastError());
+		}
+	}
+
+	std::error_code ec;
+	fs::rename(tempFile, cacheFile, ec);
+	if (ec)
+	{
+		return PA_UNPACK_ERROR("Failed to move idx cache into place: {}", ec);
+	}
+
+	return {};
+}
+
+FileRecord IdxCache::Record(size_t index) const
+{
+	CacheRecord cached;
+	std::memcpy(&cached, m_records.data() + index * sizeof(CacheRecord), sizeof(CacheRecord));
+
+	// the string offsets of all records were validated by Open
+	return FileRecord
+	{
+		.PkgName = std::string(m_strings.substr(cached.PkgNameOffset, cached.PkgNameLength)),
+		.Path = std::string(m_strings.substr(cached.PathOffset, cached.PathLength)),
+		.NodeId = cached.NodeId,
+		.VolumeId = cached.VolumeId,
+		.Offset = cached.Offset,
+		.CompressionInfo = cached.CompressionInfo,
+		.Size = cached.Size,
+		.Crc32 = cached.Crc32,
+		.UncompressedSize = cached.UncompressedSize,
+		.Padding = 0,
+	};
+}
+
+std::string_view IdxCache::Path(size_t index) const
+{
+	uint64_t offset;
+	uint64_t length;
+	std::memcpy(&offset, m_records.data() + index * sizeof(CacheRecord) + offsetof(CacheRecord, PathOffset), sizeof(offset));
+	std::memcpy(&length, m_records.data() + index * sizeof(CacheRecord) + offsetof(CacheRecord, PathLength), sizeof(length));
+	return m_strings.substr(offset, length);
+}
+
+std::pair<size_t, size_t> IdxCache::Find(std::string_view path) const
+{
+	while (path.ends_with('/'))
+	{
+		path.remove_suffix(1);
+	}
+
+	auto lowerBound = [this](std::string_view value) -> size_t
+	{
+		size_t first = 0;
+		size_t count = m_recordCount;
+		while (count > 0)
+		{
+			const size_t step = count / 2;
+			if (Path(first + step) < value)
+			{
+				first += step + 1;
+				count -= step + 1;
+			}
+			else
+			{
+				count = step;
+			}
+		}
+		return first;
+	};
+
+	if (path.empty())
+	{
+		return { 0, m_recordCount };
+	}
+
+	// a file, otherwise all paths starting with the directory follow each other in the sorted records
+	if (const size_t file = lowerBound(path); file < m_recordCount && Path(file) == path)
+	{
+		return { file, file + 1 };
+	}
+
+	const std::string directory = fmt::format("{}/", path);
+	const size_t first = lowerBound(directory);
+	size_t last = first;
+	while (last < m_recordCount && Path(last).starts_with(directory))
+	{
+		last++;
+	}
+	return { first, last };
+}
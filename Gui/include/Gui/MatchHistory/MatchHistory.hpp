@@ -1,6 +1,7 @@
 // Copyright 2022 <github.com/razaqq>
 #pragma once
 
+#include "Client/AsyncDatabaseManager.hpp"
 #include "Client/DatabaseManager.hpp"
 #include "Client/ServiceProvider.hpp"
 #include "Client/StatsParser.hpp"
@@ -43,7 +44,7 @@ public:
 	}
 
 private:
-	void LoadMatches() const;
+	void LoadMatches();
 	void Refresh() const;
 
 private:
@@ -57,11 +58,13 @@ private:
 	QLabel* m_entryCount = new QLabel();
 	Pagination* m_pagination = new Pagination();
 	int m_page = 0;
+	Client::DatabaseTask m_loadTask;
+	Client::DatabaseTask m_lookupTask;
 	static constexpr int EntriesPerPage = 100;
 
 signals:
 	void ReplaySelected(const Client::StatsParser::MatchType& match);
-	void ReplaySummarySelected(const Client::Match& match);
+	void ReplaySummarySelected(const Client::MatchListEntry& match);
 };
 
 }  // namespace PotatoAlert::Gui
@@ -155,7 +155,7 @@ void MainWindow::ConnectSignals()
 		SwitchTab(MenuEntry::MatchHistory);
 	});
 
-	connect(m_matchHistory, &MatchHistory::ReplaySummarySelected, [this](const Client::Match& match)
+	connect(m_matchHistory, &MatchHistory::ReplaySummarySelected, [this](const Client::MatchListEntry& match)
 	{
 		m_activeWidget->setVisible(false);
 		m_replaySummary->SetReplaySummary(match);
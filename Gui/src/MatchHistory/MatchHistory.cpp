@@ -4,6 +4,7 @@
 #include "Core/Instrumentor.hpp"
 #include "Core/Log.hpp"
 
+#include "Client/AsyncDatabaseManager.hpp"
 #include "Client/Config.hpp"
 #include "Client/DatabaseManager.hpp"
 #include "Client/ServiceProvider.hpp"
@@ -24,12 +25,14 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <optional>
+#include <unordered_set>
 #include <vector>
 
 
+using PotatoAlert::Client::AsyncDatabaseManager;
 using PotatoAlert::Client::Config;
 using PotatoAlert::Client::ConfigKey;
-using PotatoAlert::Client::DatabaseManager;
 using PotatoAlert::Client::StatsParser::MatchContext;
 using PotatoAlert::Client::StatsParser::ParseMatch;
 using PotatoAlert::Client::StringTable::GetString;
@@ -49,7 +52,25 @@ MatchHistory::MatchHistory(const Client::ServiceProvider& serviceProvider, QWidg
 	ReplaySummaryButtonDelegate* summaryButtonDelegate = new ReplaySummaryButtonDelegate();
 	connect(summaryButtonDelegate, &ReplaySummaryButtonDelegate::ReplaySummarySelected, [this](const QModelIndex& index)
 	{
-		emit ReplaySummarySelected(m_model->GetMatch(m_sortFilter->mapToSource(index).row()));
+		Client::MatchListEntry match = m_model->GetMatch(m_sortFilter->mapToSource(index).row());
+
+		// achievements and ribbons are not part of the list, only load them when the summary is opened
+		m_lookupTask.Cancel();
+		m_lookupTask = m_services.Get<AsyncDatabaseManager>().GetReplaySummaryAsync(match.Id, this,
+			[this, match](Client::SqlResult<std::optional<ReplaySummary>> replaySummary) mutable
+		{
+			if (!replaySummary)
+			{
+				LOG_ERROR("Failed to get replay summary from database: {}", replaySummary.error());
+				return;
+			}
+			if (*replaySummary)
+			{
+				match.ReplaySummary = std::move(**replaySummary);
+			}
+
+			emit ReplaySummarySelected(match);
+		});
 	});
 
 	m_view->setModel(m_sortFilter);
@@ -58,7 +79,6 @@ MatchHistory::MatchHistory(const Client::ServiceProvider& serviceProvider, QWidg
 
 	m_view->Init();
 
-	// maybe we should do this async
 	LoadMatches();
 
 	QHBoxLayout* horLayout = new QHBoxLayout();
@@ -114,32 +134,39 @@ MatchHistory::MatchHistory(const Client::ServiceProvider& serviceProvider, QWidg
 		QuestionDialog* dialog = new QuestionDialog(lang, this, GetString(lang, StringTableKey::HISTORY_DELETE_QUESTION));
 		if (dialog->Run() == QuestionAnswer::Yes)
 		{
-			std::vector<int> removedMatches{};
+			std::vector<uint32_t> removedIds{};
 
 			for (const QItemSelectionRange& s : sourceSelection)
 			{
 				if (s.isValid() && s.left() == 0)
 				{
-					int row = s.top();
-					removedMatches.emplace_back(row);
-
-					const uint32_t matchId = m_model->GetMatch(row).Id;
-					PA_TRYV_OR_ELSE(m_services.Get<DatabaseManager>().DeleteMatch(matchId),
-					{
-						LOG_ERROR("Failed to delete match from match history: {}", error);
-					});
+					removedIds.emplace_back(m_model->GetMatch(s.top()).Id);
 				}
 			}
 
-			std::ranges::sort(removedMatches, [](int a, int b){ return a > b; });
-			for (int i : removedMatches)
+			// the rows might have moved until the matches are deleted, so they are looked up by id again
+			m_services.Get<AsyncDatabaseManager>().DeleteMatchesAsync(removedIds, this,
+				[this, removedIds](const Client::SqlResult<void>& result)
 			{
-				m_filter->Remove(m_model->GetMatch(i));
-				m_model->DeleteMatch(i);
-			}
+				if (!result)
+				{
+					LOG_ERROR("Failed to delete matches from match history: {}", result.error());
+					return;
+				}
+
+				const std::unordered_set<uint32_t> ids(removedIds.begin(), removedIds.end());
+				for (size_t i = m_model->MatchCount(); i > 0; i--)
+				{
+					if (ids.contains(m_model->GetMatch(i - 1).Id))
+					{
+						m_filter->Remove(m_model->GetMatch(i - 1));
+						m_model->DeleteMatch(i - 1);
+					}
+				}
 
-			m_view->selectionModel()->clearSelection();
-			Refresh();
+				m_view->selectionModel()->clearSelection();
+				Refresh();
+			});
 		}
 	});
 
@@ -152,16 +179,34 @@ MatchHistory::MatchHistory(const Client::ServiceProvider& serviceProvider, QWidg
 
 	connect(m_view, &QTableView::doubleClicked, [this](const QModelIndex& index)
 	{
-		const Client::Match& match = m_model->GetMatch(m_sortFilter->mapToSource(index).row());
-		const bool showKarma = m_services.Get<Config>().Get<ConfigKey::ShowKarma>();
-		const bool fontShadow = m_services.Get<Config>().Get<ConfigKey::FontShadow>();
-		const int fontScaling = m_services.Get<Config>().Get<ConfigKey::FontScaling>();
-		PA_TRY_OR_ELSE(res, ParseMatch(match.Json, MatchContext{}, { showKarma, fontShadow, (float)fontScaling / 100.0f }),
+		const uint32_t id = m_model->GetMatch(m_sortFilter->mapToSource(index).row()).Id;
+
+		// the server response is not part of the list, only load it when the match is opened
+		m_lookupTask.Cancel();
+		m_lookupTask = m_services.Get<AsyncDatabaseManager>().GetMatchJsonAsync(id, this,
+			[this, id](const Client::SqlResult<std::optional<std::string>>& json)
 		{
-			LOG_ERROR("Failed to parse match as JSON: {}", error);
-			return;
+			if (!json)
+			{
+				LOG_ERROR("Failed to get match json from database: {}", json.error());
+				return;
+			}
+			if (!*json)
+			{
+				LOG_ERROR("Match with id {} does not exist in database", id);
+				return;
+			}
+
+			const bool showKarma = m_services.Get<Config>().Get<ConfigKey::ShowKarma>();
+			const bool fontShadow = m_services.Get<Config>().Get<ConfigKey::FontShadow>();
+			const int fontScaling = m_services.Get<Config>().Get<ConfigKey::FontScaling>();
+			PA_TRY_OR_ELSE(res, ParseMatch(**json, MatchContext{}, { showKarma, fontShadow, (float)fontScaling / 100.0f }),
+			{
+				LOG_ERROR("Failed to parse match as JSON: {}", error);
+				return;
+			});
+			emit ReplaySelected(res.Match);
 		});
-		emit ReplaySelected(res.Match);
 	});
 
 	connect(m_view->selectionModel(), &QItemSelectionModel::selectionChanged, [this](const QItemSelection& selected, [[maybe_unused]] const QItemSelection& deselection)
@@ -207,28 +252,45 @@ int MatchHistory::PageCount() const
 
 void MatchHistory::AddMatch(const Client::Match& match) const
 {
-	m_model->AddMatch(match);
+	const Client::MatchListEntry entry = Client::MatchListEntry::FromMatch(match);
+	m_model->AddMatch(entry);
 	// rebuild the filter, otherwise a new ship type might be added, but there is no filter for it
 	// meaning it would be unselected and thus the new match would not show up
-	m_filter->Add(match);
+	m_filter->Add(entry);
 	Refresh();
 }
 
-void MatchHistory::LoadMatches() const
+void MatchHistory::LoadMatches()
 {
-	PA_PROFILE_SCOPE();
-
 	LOG_TRACE("Loading MatchHistory...");
-	PA_TRY_OR_ELSE(matches, m_services.Get<Client::DatabaseManager>().GetMatches(),
+	m_loadTask = m_services.Get<AsyncDatabaseManager>().GetMatchListAsync({}, this,
+		[this](Client::SqlResult<std::vector<Client::MatchListEntry>> result)
 	{
-		LOG_ERROR("Failed to get matches from database: {}", error);
-		return;
-	});
-	LOG_TRACE("Loaded MatchHistory");
+		PA_PROFILE_SCOPE("MatchHistory::LoadMatches");
 
-	m_filter->BuildFilter(matches);
-	m_model->SetMatches(std::move(matches));
-	Refresh();
+		if (!result)
+		{
+			LOG_ERROR("Failed to get matches from database: {}", result.error());
+			return;
+		}
+		LOG_TRACE("Loaded MatchHistory with {} matches", result->size());
+
+		// matches added while loading might not be part of the result yet
+		std::vector<Client::MatchListEntry> added(m_model->GetMatches().begin(), m_model->GetMatches().end());
+		std::erase_if(added, [&result](const Client::MatchListEntry& match)
+		{
+			return std::ranges::any_of(*result, [&match](const Client::MatchListEntry& m) { return m.Id == match.Id; });
+		});
+
+		m_model->SetMatches(std::move(*result));
+		for (const Client::MatchListEntry& match : added)
+		{
+			m_model->AddMatch(match);
+		}
+
+		m_filter->BuildFilter(m_model->GetMatches());
+		Refresh();
+	});
 }
 
 void MatchHistory::SetReplaySummary(uint32_t id, const ReplaySummary& summary) const
@@ -252,6 +314,8 @@ bool MatchHistory::eventFilter(QObject* watched, QEvent* event)
 
 void MatchHistory::hideEvent([[maybe_unused]] QHideEvent* event)
 {
+	// a match or summary which is still loading would open after the user already left the match history
+	m_lookupTask.Cancel();
 	m_filter->setVisible(false);
 }
 
@@ -1,8 +1,11 @@
 // Copyright 2020 <github.com/razaqq>
 
+#include "Client/AppDirectories.hpp"
 #include "Client/Config.hpp"
 #include "Client/ServiceProvider.hpp"
 
+#include "Core/Metrics.hpp"
+
 #include "Gui/NativeWindow.hpp"
 #include "Gui/TitleBar.hpp"
 
@@ -18,8 +21,10 @@
 #include <QWindow>
 
 
+using PotatoAlert::Client::AppDirectories;
 using PotatoAlert::Client::Config;
 using PotatoAlert::Client::ConfigKey;
+using PotatoAlert::Core::Metrics;
 using PotatoAlert::Gui::NativeWindow;
 
 NativeWindow::NativeWindow(const Client::ServiceProvider& serviceProvider, QMainWindow* mainWindow, QWidget* parent) : QWidget(parent), m_services(serviceProvider), m_mainWindow(mainWindow)
@@ -131,12 +136,20 @@ void NativeWindow::Init()
 		QMenu* trayMenu = new QMenu(this);
 		QAction* closeAction = new QAction("Exit", this);
 		QAction* openAction = new QAction("Open", this);
+		QAction* metricsAction = new QAction("Write Metrics", this);
 		trayMenu->addAction(openAction);
+		trayMenu->addAction(metricsAction);
 		trayMenu->addAction(closeAction);
 		trayMenu->setLayoutDirection(Qt::LayoutDirection::RightToLeft);
 		trayIcon->setContextMenu(trayMenu);
 
 		connect(openAction, &QAction::triggered, this, &NativeWindow::show);
+		// so bug reports can include the latencies the user actually saw
+		connect(metricsAction, &QAction::triggered, [this]()
+		{
+			Metrics::Instance().Log();
+			Metrics::Instance().WriteToFile(m_services.Get<AppDirectories>().AppDir / "metrics.txt");
+		});
 		connect(closeAction, &QAction::triggered, []()
 		{
 			QApplication::exit(0);
@@ -2,11 +2,14 @@
 
 #include "Core/ApplicationGuard.hpp"
 #include "Core/Directory.hpp"
+#include "Core/Instrumentor.hpp"
+#include "Core/Metrics.hpp"
 #include "Core/Process.hpp"
 #include "Core/StandardPaths.hpp"
 #include "Core/Sqlite.hpp"
 
 #include "Client/AppDirectories.hpp"
+#include "Client/AsyncDatabaseManager.hpp"
 #include "Client/Config.hpp"
 #include "Client/DatabaseManager.hpp"
 #include "Client/FontLoader.hpp"
@@ -29,6 +32,7 @@
 
 
 using PotatoAlert::Client::AppDirectories;
+using PotatoAlert::Client::AsyncDatabaseManager;
 using PotatoAlert::Client::Config;
 using PotatoAlert::Client::ConfigKey;
 using PotatoAlert::Client::DatabaseManager;
@@ -65,6 +69,7 @@ int main(int argc, char* argv[])
 	serviceProvider.Add(appDirs);
 
 	PotatoAlert::Core::Log::Init(appDirs.LogFile);
+	PA_PROFILE_TRACE(appDirs.AppDir / "PotatoAlert.trace.json");
 
 	Config config(appDirs.ConfigFile);
 	serviceProvider.Add(config);
@@ -90,6 +95,8 @@ int main(int argc, char* argv[])
 
 	DatabaseManager dbm(db);
 	serviceProvider.Add(dbm);
+	AsyncDatabaseManager asyncDbm(dbm);
+	serviceProvider.Add(asyncDbm);
 
 	QApplication::setQuitOnLastWindowClosed(false);
 
@@ -125,5 +132,7 @@ int main(int argc, char* argv[])
 	if (QApplication::arguments().contains("--changelog"))
 		;  // TODO: add changelog
 
-	return QApplication::exec();
+	const int result = QApplication::exec();
+	PotatoAlert::Core::Metrics::Instance().Log();
+	return result;
 }
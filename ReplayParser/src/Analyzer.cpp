@@ -2,6 +2,7 @@
 
 #include "Core/Bytes.hpp"
 #include "Core/Instrumentor.hpp"
+#include "Core/Log.hpp"
 #include "Core/Sha256.hpp"
 
 #include "ReplayAnalyzerRust.hpp"
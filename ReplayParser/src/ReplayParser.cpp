@@ -7,6 +7,7 @@
 #include "Core/FileMapping.hpp"
 #include "Core/Instrumentor.hpp"
 #include "Core/Json.hpp"
+#include "Core/Metrics.hpp"
 #include "Core/Zlib.hpp"
 
 #include "ReplayParser/GameFiles.hpp"
@@ -181,6 +182,7 @@ ReplayResult<Replay> Replay::FromFile(const fs::path& filePath, const fs::path&
 		PA_TRY(packet, ParsePacket(out, replay.m_packetParser, replay.Meta.ClientVersionFromExe));
 		replay.Packets.emplace_back(std::move(packet));
 	} while (!out.empty());
+	PA_METRIC_COUNT("replay.packets_parsed", replay.Packets.size());
 
 	// sort the packets by game time
 	// std::ranges::sort(replay.Packets, [](const PacketType& a, const PacketType& b)
@@ -195,6 +197,7 @@ ReplayResult<Replay> Replay::FromFile(const fs::path& filePath, const fs::path&
 
 ReplayResult<ReplaySummary> rp::AnalyzeReplay(const fs::path& file, const fs::path& gameFilePath)
 {
+	PA_METRIC_LATENCY("replay.analyze");
 	PA_TRY(replay, Replay::FromFile(file, gameFilePath));
 	PA_TRY(summary, replay.Analyze());
 	return summary;
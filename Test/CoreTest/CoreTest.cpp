@@ -2,28 +2,46 @@
 
 #include "Core/ByteReader.hpp"
 #include "Core/Blowfish.hpp"
+#include "Core/CancellationToken.hpp"
+#include "Core/Crc32.hpp"
 #include "Core/Directory.hpp"
+#include "Core/DirectoryWatcher.hpp"
 #include "Core/File.hpp"
 #include "Core/FileMapping.hpp"
+#include "Core/Json.hpp"
+#include "Core/Metrics.hpp"
+#include "Core/Parallel.hpp"
 #include "Core/PeFileVersion.hpp"
 #include "Core/PeReader.hpp"
 #include "Core/Process.hpp"
 #include "Core/Semaphore.hpp"
 #include "Core/Sha1.hpp"
 #include "Core/Sha256.hpp"
+#include "Core/Sqlite.hpp"
 #include "Core/String.hpp"
+#include "Core/ThreadPool.hpp"
 #include "Core/Time.hpp"
 #include "Core/Version.hpp"
 #include "Core/Zlib.hpp"
 
+#include <QCoreApplication>
+
 #include <catch2/catch_test_macros.hpp>
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <string>
 #include <span>
 #include <ranges>
+#include <thread>
 #include <vector>
 
 
@@ -60,6 +78,43 @@ static fs::path GetFile(std::string_view name)
 	ExitCurrentProcess(1);
 }
 
+static fs::path GetTempDirectory(std::string_view name)
+{
+	const fs::path dir = fs::temp_directory_path() / "PotatoAlert" / "CoreTest" / name;
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	return dir;
+}
+
+static void WriteFile(const fs::path& path, std::string_view content)
+{
+	const File file = File::Open(path, File::Flags::Write | File::Flags::Create | File::Flags::Truncate);
+	REQUIRE(file);
+	REQUIRE(file.WriteString(content));
+}
+
+// the watcher emits its changes from the event loop of the application
+static void ProcessEvents(std::chrono::milliseconds duration)
+{
+	const auto end = std::chrono::steady_clock::now() + duration;
+	while (std::chrono::steady_clock::now() < end)
+	{
+		QCoreApplication::processEvents();
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+}
+
+static std::vector<std::string> FileNames(const std::vector<fs::path>& files)
+{
+	std::vector<std::string> names;
+	for (const fs::path& file : files)
+	{
+		names.emplace_back(file.filename().string());
+	}
+	std::ranges::sort(names);
+	return names;
+}
+
 }
 
 TEST_CASE( "ByteReaderTest" )
@@ -152,6 +207,118 @@ TEST_CASE( "BlowFishDecryptTest" )
 	REQUIRE(std::equal(out.begin(), out.end(), solution.begin(), solution.end()));
 }
 
+TEST_CASE( "Crc32Test" )
+{
+	REQUIRE(Crc32(std::span<const Byte>{}) == 0);
+	REQUIRE(Crc32(FromString<Byte>("123456789")) == 0xCBF43926);
+	REQUIRE(Crc32(FromString<Byte>("The quick brown fox jumps over the lazy dog")) == 0x414FA339);
+
+	// long enough to take the vectorized path, with an unaligned tail
+	std::vector<Byte> data(4099);
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<Byte>(i * 31);
+	}
+	REQUIRE(Crc32(data) == 0x7CBC6960);
+
+	const std::span<const Byte> span{ data };
+	REQUIRE(Crc32(Crc32(span.subspan(0, 1001)), span.subspan(1001)) == 0x7CBC6960);
+}
+
+TEST_CASE( "DirectoryWatcherDebounceTest" )
+{
+	char name[] = "CoreTest";
+	char* argv[] = { name, nullptr };
+	int argc = 1;
+	QCoreApplication app(argc, argv);
+
+	const fs::path dir = GetTempDirectory("DirectoryWatcherDebounce");
+	const fs::path replays = dir / "replays";
+	REQUIRE(fs::create_directories(replays));
+	WriteFile(replays / "deleted.wowsreplay", "deleted");
+
+	DirectoryWatcher watcher;
+	std::vector<fs::path> changed;
+	QObject::connect(&watcher, &DirectoryWatcher::FileChanged, [&changed](const fs::path& file)
+	{
+		changed.emplace_back(file);
+	});
+	watcher.WatchDirectory(replays);
+
+	// all writes fall into the window of the first one
+	for (int i = 0; i < 5; i++)
+	{
+		WriteFile(replays / "written.wowsreplay", std::string(i + 1, 'x'));
+		ProcessEvents(DirectoryWatcher::DebounceInterval / 10);
+	}
+	ProcessEvents(DirectoryWatcher::DebounceInterval * 3);
+	REQUIRE(FileNames(changed) == std::vector<std::string>{ "written.wowsreplay" });
+	REQUIRE(changed.front() == replays / "written.wowsreplay");
+
+	// the replay is moved in from a directory that is not watched
+	changed.clear();
+	WriteFile(dir / "moved.wowsreplay", "moved");
+	fs::rename(dir / "moved.wowsreplay", replays / "moved.wowsreplay");
+	REQUIRE(fs::remove(replays / "deleted.wowsreplay"));
+	ProcessEvents(DirectoryWatcher::DebounceInterval * 3);
+	REQUIRE(FileNames(changed) == std::vector<std::string>{ "deleted.wowsreplay", "moved.wowsreplay" });
+}
+
+TEST_CASE( "DirectoryWatcherStateTest" )
+{
+	char name[] = "CoreTest";
+	char* argv[] = { name, nullptr };
+	int argc = 1;
+	QCoreApplication app(argc, argv);
+
+	const fs::path dir = GetTempDirectory("DirectoryWatcherState");
+	const fs::path replays = dir / "replays";
+	const fs::path stateFile = dir / "DirectoryState.json";
+	REQUIRE(fs::create_directories(replays));
+	WriteFile(replays / "changed.wowsreplay", "changed");
+	WriteFile(replays / "removed.wowsreplay", "removed");
+	WriteFile(replays / "unchanged.wowsreplay", "unchanged");
+
+	// every run is a new watcher, which saves the state when it is destroyed
+	const auto watch = [&replays, &stateFile]() -> std::vector<std::string>
+	{
+		DirectoryWatcher watcher;
+		REQUIRE(watcher.LoadState(stateFile));
+
+		std::vector<fs::path> caughtUp;
+		bool fileChanged = false;
+		QObject::connect(&watcher, &DirectoryWatcher::FilesCaughtUp, [&caughtUp](const std::vector<fs::path>& files)
+		{
+			caughtUp.insert(caughtUp.end(), files.begin(), files.end());
+		});
+		QObject::connect(&watcher, &DirectoryWatcher::FileChanged, [&fileChanged](const fs::path&)
+		{
+			fileChanged = true;
+		});
+
+		watcher.WatchDirectory(replays);
+		ProcessEvents(DirectoryWatcher::DebounceInterval * 3);
+		REQUIRE_FALSE(fileChanged);
+		return FileNames(caughtUp);
+	};
+
+	// the first run only records the files
+	REQUIRE(watch().empty());
+	REQUIRE(fs::exists(stateFile));
+	REQUIRE_FALSE(fs::exists(fs::path(stateFile) += ".tmp"));
+
+	WriteFile(replays / "changed.wowsreplay", "changed while closed");
+	REQUIRE(fs::remove(replays / "removed.wowsreplay"));
+	WriteFile(replays / "added.wowsreplay", "added");
+	REQUIRE(watch() == std::vector<std::string>{ "added.wowsreplay", "changed.wowsreplay", "removed.wowsreplay" });
+	REQUIRE(watch().empty());
+
+	WriteFile(stateFile, R"({"Version":0,"Directories":{}})");
+	REQUIRE_FALSE(DirectoryWatcher().LoadState(stateFile));
+	WriteFile(stateFile, "not json");
+	REQUIRE_FALSE(DirectoryWatcher().LoadState(stateFile));
+}
+
 TEST_CASE( "FileMappingTest" )
 {
 	File file = File::Open(GetFile("lorem.txt"), File::Flags::Open | File::Flags::Read);
@@ -174,6 +341,191 @@ TEST_CASE( "FileMappingTest" )
 	fileMapping.Close();
 }
 
+namespace {
+
+enum class JsonTestMode
+{
+	Pvp,
+	Pve,
+};
+
+PA_JSON_SERIALIZE_ENUM(JsonTestMode,
+{
+	{ JsonTestMode::Pvp, "pvp" },
+	{ JsonTestMode::Pve, "pve" },
+})
+
+struct JsonTestPlayer
+{
+	std::string Name;
+	uint8_t Tier;
+	std::optional<std::string> Clan;
+};
+
+struct JsonTestMatch
+{
+	JsonTestMode Mode;
+	std::vector<JsonTestPlayer> Players;
+	std::array<int, 3> Color;
+	double Winrate;
+	bool Ranked = false;
+	JsonRaw Raw;
+};
+
+// read into its value and captured as text in the same pass
+struct JsonTestCapture
+{
+	std::optional<JsonTestPlayer> Player;
+	std::string Json;
+};
+
+}
+
+template<>
+struct PotatoAlert::Core::JsonObject<JsonTestPlayer>
+{
+	static constexpr auto Fields = std::make_tuple(
+		JsonField("name", &JsonTestPlayer::Name),
+		JsonField("tier", &JsonTestPlayer::Tier),
+		JsonField("clan", &JsonTestPlayer::Clan)
+	);
+};
+
+template<>
+struct PotatoAlert::Core::JsonObject<JsonTestMatch>
+{
+	static constexpr auto Fields = std::make_tuple(
+		JsonField("mode", &JsonTestMatch::Mode),
+		JsonField("players", &JsonTestMatch::Players),
+		JsonField("color", &JsonTestMatch::Color),
+		JsonField("winrate", &JsonTestMatch::Winrate),
+		JsonField("ranked", &JsonTestMatch::Ranked, false),
+		JsonField("raw", &JsonTestMatch::Raw)
+	);
+};
+
+template<>
+struct PotatoAlert::Core::JsonSax<JsonTestCapture>
+{
+	static Sax::Sink SinkFor(JsonTestCapture& capture)
+	{
+		return { &capture.Player, &Sax::OpsFor<std::optional<JsonTestPlayer>>, &capture.Json };
+	}
+};
+
+TEST_CASE( "JsonTest" )
+{
+	const std::string json = R"({"mode":"pve","unknown":{"a":[1,2]},"players":[{"name":"a\"b","tier":10,"clan":null},{"name":"c","tier":11,"clan":"TAG"}],)"
+		R"("color":[1,2,3],"winrate":55,"raw":{"x":[true,null,"y"]}})";
+
+	{
+		JsonTestMatch match;
+		REQUIRE(ReadJson(json, match));
+		REQUIRE(match.Mode == JsonTestMode::Pve);
+		REQUIRE(match.Players.size() == 2);
+		REQUIRE(match.Players[0].Name == "a\"b");
+		REQUIRE(match.Players[0].Tier == 10);
+		REQUIRE(!match.Players[0].Clan);
+		REQUIRE(match.Players[1].Clan == "TAG");
+		REQUIRE(match.Color == std::array{ 1, 2, 3 });
+		REQUIRE(match.Winrate == 55.0);
+		REQUIRE(!match.Ranked);
+		REQUIRE(match.Raw.Json == R"({"x":[true,null,"y"]})");
+	}
+
+	{
+		std::string insitu = json;
+		JsonTestMatch match;
+		REQUIRE(ReadJsonInSitu(insitu.data(), match));
+		REQUIRE(match.Players[0].Name == "a\"b");
+		REQUIRE(match.Raw.Json == R"({"x":[true,null,"y"]})");
+	}
+
+	{
+		JsonTestMatch match;
+		REQUIRE(ReadJson(R"({"mode":"pvp"})", match).error() == "Json object has no key 'players'");
+		REQUIRE(ReadJson(R"({"mode":"ranked"})", match).error() == "Unexpected json string for key 'mode'");
+		REQUIRE(ReadJson(R"({"mode":"pvp","players":[{"name":"a","tier":256}]})", match).error() == "Unexpected json integer for key 'tier'");
+		REQUIRE(ReadJson(R"({"mode":"pvp","players":[],"color":[1,2,3,4]})", match).error() == "Unexpected json integer in array after key 'color'");
+		REQUIRE(ReadJson(R"({"mode":"pvp","players":[],"color":[1,2]})", match).error() == "Unexpected json array length 2 after key 'color'");
+		REQUIRE(!ReadJson(R"({"mode":"pvp",)", match));
+	}
+
+	{
+		std::string insitu = R"({"name":"a\"b","tier":10,"clan":null,"unknown":[1]})";
+		JsonTestCapture capture;
+		REQUIRE(ReadJsonInSitu(insitu.data(), capture));
+		REQUIRE(capture.Player);
+		REQUIRE(capture.Player->Name == "a\"b");
+		REQUIRE(capture.Player->Tier == 10);
+		REQUIRE(capture.Json == R"({"name":"a\"b","tier":10,"clan":null,"unknown":[1]})");
+
+		REQUIRE(ReadJson("null", capture));
+		REQUIRE(!capture.Player);
+		REQUIRE(capture.Json == "null");
+		REQUIRE(ReadJson(R"({"name":"a"})", capture).error() == "Json object has no key 'tier'");
+	}
+}
+
+TEST_CASE( "MetricsTest" )
+{
+	{
+		// every value falls into a bucket whose bounds contain it
+		for (const uint64_t value : { 0ull, 1ull, 15ull, 16ull, 17ull, 31ull, 32ull, 1000ull, 123456789ull, ~0ull })
+		{
+			const size_t index = Histogram::BucketIndex(value);
+			REQUIRE(index < Histogram::BucketCount);
+			REQUIRE(Histogram::BucketUpperBound(index) >= value);
+			REQUIRE((index == 0 || Histogram::BucketUpperBound(index - 1) < value));
+		}
+	}
+
+	{
+		Histogram histogram;
+		REQUIRE(histogram.Percentile(50.0) == 0);
+
+		for (uint64_t i = 1; i <= 1000; i++)
+		{
+			histogram.Record(i);
+		}
+		REQUIRE(histogram.Count() == 1000);
+		REQUIRE(histogram.Min() == 1);
+		REQUIRE(histogram.Max() == 1000);
+		REQUIRE(histogram.Mean() == 500);
+
+		// the buckets are at most 1/16 of their power of two wide
+		const auto near = [](uint64_t actual, uint64_t expected)
+		{
+			return actual >= expected && actual <= expected + expected / 16;
+		};
+		REQUIRE(near(histogram.Percentile(50.0), 500));
+		REQUIRE(near(histogram.Percentile(90.0), 900));
+		REQUIRE(near(histogram.Percentile(99.0), 990));
+		REQUIRE(histogram.Percentile(100.0) == 1000);
+	}
+
+	{
+		Counter& counter = Metrics::Instance().GetCounter("test.counter");
+		REQUIRE(&counter == &Metrics::Instance().GetCounter("test.counter"));
+		PA_METRIC_COUNT("test.counter", 5);
+		counter.Add();
+		REQUIRE(counter.Value() == 6);
+
+		PA_METRIC_GAUGE_SET("test.gauge", 3);
+		PA_METRIC_GAUGE_ADD("test.gauge", -5);
+		REQUIRE(Metrics::Instance().GetGauge("test.gauge").Value() == -2);
+
+		{
+			PA_METRIC_LATENCY("test.latency");
+		}
+		REQUIRE(Metrics::Instance().GetHistogram("test.latency").Count() == 1);
+
+		const std::string formatted = Metrics::Instance().Format();
+		REQUIRE(formatted.find("test.counter") != std::string::npos);
+		REQUIRE(formatted.find("test.latency") != std::string::npos);
+	}
+}
+
 TEST_CASE( "MutexTest" )
 {
 	constexpr std::string_view SemName = "TEST_SEMAPHORE";
@@ -224,6 +576,89 @@ TEST_CASE( "MutexTest" )
 	Semaphore::Remove(SemName);
 }
 
+TEST_CASE( "ParallelTest" )
+{
+	ThreadPool pool(4);
+
+	{
+		std::vector<int> values(10000, 0);
+		ParallelFor(pool, 0, values.size(), [&values](size_t i) { values[i] = static_cast<int>(i); });
+		std::vector<int> expected(values.size());
+		std::iota(expected.begin(), expected.end(), 0);
+		REQUIRE(values == expected);
+
+		// empty ranges and ranges smaller than the grain
+		ParallelFor(pool, 5, 5, [](size_t) { REQUIRE(false); });
+		std::atomic<size_t> calls = 0;
+		ParallelFor(pool, 0, 3, [&calls](size_t) { calls++; }, 100);
+		REQUIRE(calls == 3);
+	}
+
+	{
+		const uint64_t sum = ParallelReduce(pool, 1, 100001, uint64_t{ 0 },
+			[](size_t i) { return static_cast<uint64_t>(i); },
+			[](uint64_t a, uint64_t b) { return a + b; }, 7);
+		REQUIRE(sum == 5000050000);
+
+		// the partial results are combined in order, so non-commutative reductions work too
+		const std::string joined = ParallelReduce(pool, 0, 26, std::string(),
+			[](size_t i) { return std::string(1, static_cast<char>('a' + i)); },
+			[](std::string a, const std::string& b) { return a + b; }, 3);
+		REQUIRE(joined == "abcdefghijklmnopqrstuvwxyz");
+	}
+
+	{
+		std::vector<int> input(1000);
+		std::iota(input.begin(), input.end(), 0);
+		std::vector<int> output(input.size());
+		ParallelTransform(pool, std::span(input), std::span(output), [](int v) { return v * 2; });
+		REQUIRE(std::ranges::equal(output, input | std::views::transform([](int v) { return v * 2; })));
+	}
+
+	{
+		// the sink sees the items in the order of the source and never more than maxInFlight are pending
+		constexpr size_t MaxInFlight = 3;
+		int next = 0;
+		std::atomic<size_t> pending = 0;
+		std::atomic<size_t> maxPending = 0;
+		std::vector<std::string> sunk;
+		ParallelPipeline(pool, MaxInFlight,
+			[&]() -> std::optional<int>
+			{
+				if (next == 200)
+					return std::nullopt;
+				const size_t now = ++pending;
+				size_t max = maxPending.load();
+				while (now > max && !maxPending.compare_exchange_weak(max, now)) {}
+				return next++;
+			},
+			[&](std::string s)
+			{
+				sunk.emplace_back(std::move(s));
+				pending--;
+			},
+			[](int v) { return v * 3; },
+			[](int v) { return std::to_string(v); });
+
+		REQUIRE(sunk.size() == 200);
+		for (size_t i = 0; i < sunk.size(); i++)
+		{
+			REQUIRE(sunk[i] == std::to_string(i * 3));
+		}
+		REQUIRE(maxPending <= MaxInFlight);
+	}
+
+	{
+		// nested loops finish even though the outer loop occupies every worker
+		std::atomic<size_t> calls = 0;
+		ParallelFor(pool, 0, 16, [&](size_t)
+		{
+			ParallelFor(pool, 0, 100, [&calls](size_t) { calls++; }, 10);
+		}, 1);
+		REQUIRE(calls == 1600);
+	}
+}
+
 TEST_CASE( "PeReaderTest" )
 {
 	File file = File::Open(GetFile("FooBar.exe"), File::Flags::Read | File::Flags::Open);
@@ -296,6 +731,61 @@ TEST_CASE( "Sha256Test" )
 	REQUIRE(hash2 == "d7a8fbb307d7809469ca9abcb0082e4f8d5651e46d3cdb762d02d0bf37c9e592");
 }
 
+TEST_CASE( "SQLiteStatementCacheTest" )
+{
+	SQLite db = SQLite::Open(":memory:", SQLite::Flags::ReadWrite | SQLite::Flags::Create | SQLite::Flags::Memory);
+	REQUIRE(db);
+	REQUIRE(db.Execute("CREATE TABLE test (Id INTEGER PRIMARY KEY, Name TEXT)"));
+
+	static constexpr std::string_view insertQuery = "INSERT INTO test (Name) VALUES (:Name)";
+	static constexpr std::string_view selectQuery = "SELECT Name FROM test WHERE Id = :Id";
+
+	for (std::string_view name : { "first", "second", "third" })
+	{
+		SQLite::CachedStatement stmt = db.Prepare(insertQuery);
+		REQUIRE(stmt);
+		REQUIRE(stmt->Bind(":Name", name));
+		stmt->ExecuteStep();
+		REQUIRE(stmt->IsDone());
+	}
+
+	{
+		// the same query in use twice at the same time has to give two independent statements
+		SQLite::CachedStatement stmt1 = db.Prepare(selectQuery);
+		SQLite::CachedStatement stmt2 = db.Prepare(selectQuery);
+		REQUIRE((stmt1 && stmt2));
+		REQUIRE(&*stmt1 != &*stmt2);
+		REQUIRE(stmt1->Bind(":Id", 1));
+		REQUIRE(stmt2->Bind(":Id", 2));
+		stmt1->ExecuteStep();
+		stmt2->ExecuteStep();
+
+		std::string name1, name2;
+		REQUIRE(stmt1->GetText(0, name1));
+		REQUIRE(stmt2->GetText(0, name2));
+		REQUIRE(name1 == "first");
+		REQUIRE(name2 == "second");
+	}
+
+	{
+		// a statement from the cache has to be reset and have no bindings left
+		SQLite::CachedStatement stmt = db.Prepare(selectQuery);
+		REQUIRE(stmt);
+		REQUIRE_FALSE(stmt->IsDone());
+		stmt->ExecuteStep();
+		REQUIRE_FALSE(stmt->HasRow());
+
+		REQUIRE(stmt->Reset());
+		REQUIRE(stmt->Bind(":Id", 3));
+		stmt->ExecuteStep();
+		std::string name;
+		REQUIRE(stmt->GetText(0, name));
+		REQUIRE(name == "third");
+	}
+
+	db.Close();
+}
+
 TEST_CASE( "StringTest" )
 {
 	REQUIRE(String::Trim(" test \n\t") == "test");
@@ -356,6 +846,86 @@ TEST_CASE( "StringTest" )
 	REQUIRE(String::EndsWith("text", ""));
 }
 
+TEST_CASE( "ThreadPoolTest" )
+{
+	{
+		ThreadPool pool(4);
+		std::future<std::string> res = pool.Enqueue([](int a, const std::string& b) { return b + std::to_string(a); }, 42, "x");
+		REQUIRE(res.get() == "x42");
+
+		std::future<int> moveOnly = pool.Enqueue([ptr = std::make_unique<int>(7)]() { return *ptr; });
+		REQUIRE(moveOnly.get() == 7);
+
+		// larger than the recycled task blocks
+		std::array<int, 64> large{};
+		large[63] = 5;
+		REQUIRE(pool.Enqueue([large]() { return large[63]; }).get() == 5);
+	}
+
+	{
+		// tasks submitted from workers go to their own deque and get stolen by the others
+		std::atomic<int> count = 0;
+		ThreadPool pool(4);
+		for (int i = 0; i < 100; i++)
+		{
+			pool.Submit([&pool, &count]()
+			{
+				for (int j = 0; j < 100; j++)
+				{
+					pool.Submit([&count]() { count++; });
+				}
+			});
+		}
+		pool.WaitUntilNothingInFlight();
+		REQUIRE(count == 10000);
+	}
+
+	{
+		// the remaining tasks are run before the pool is destroyed
+		std::atomic<int> count = 0;
+		{
+			ThreadPool pool(2);
+			for (int i = 0; i < 1000; i++)
+			{
+				pool.Submit([&count]() { count++; });
+			}
+		}
+		REQUIRE(count == 1000);
+	}
+
+	{
+		// with the only worker blocked, the queued tasks run by priority once it is free again
+		ThreadPool pool(1);
+		std::promise<void> gate;
+		std::shared_future<void> gateFuture = gate.get_future().share();
+		std::future<void> blocker = pool.Enqueue([gateFuture]() { gateFuture.wait(); });
+
+		std::mutex mutex;
+		std::vector<TaskPriority> order;
+		for (TaskPriority priority : { TaskPriority::Low, TaskPriority::Normal, TaskPriority::High, TaskPriority::Low, TaskPriority::High })
+		{
+			pool.Submit(priority, [&mutex, &order, priority]()
+			{
+				std::unique_lock lock(mutex);
+				order.emplace_back(priority);
+			});
+		}
+		gate.set_value();
+		pool.WaitUntilNothingInFlight();
+		const std::vector expected = { TaskPriority::High, TaskPriority::High, TaskPriority::Normal, TaskPriority::Low, TaskPriority::Low };
+		REQUIRE(order == expected);
+	}
+
+	{
+		// cancelled tasks are still run, so their futures are fulfilled
+		ThreadPool pool(1);
+		CancellationToken token;
+		token.Cancel();
+		std::future<bool> res = pool.Enqueue(TaskPriority::Low, token, [](const CancellationToken& t, int) { return t.IsCancelled(); }, 1);
+		REQUIRE(res.get());
+	}
+}
+
 TEST_CASE( "TimeTest" )
 {
 	{
@@ -487,4 +1057,30 @@ TEST_CASE( "ZlibTest" )
 
 	REQUIRE(vec.size() == string.size());
 	CHECK(std::memcmp(vec.data(), string.data(), vec.size()) == 0);
+
+	std::vector<Byte> chunked;
+	REQUIRE(Zlib::InflateChunked(binary, [&chunked](std::span<const Byte> chunk) -> bool
+	{
+		chunked.insert(chunked.end(), chunk.begin(), chunk.end());
+		return true;
+	}));
+	REQUIRE(chunked == vec);
+
+	REQUIRE_FALSE(Zlib::InflateChunked(std::span{ binary }.subspan(0, 100), [](std::span<const Byte>) -> bool
+	{
+		return true;
+	}));
+
+	const std::span<const Byte> bytes(reinterpret_cast<const Byte*>(string.data()), string.size());
+	const std::vector<Byte> deflated = Zlib::Deflate(bytes);
+	REQUIRE_FALSE(deflated.empty());
+	CHECK(Zlib::Inflate(deflated) == vec);
+
+	const std::span<const Byte> dictionary = bytes.subspan(0, 200);
+	const std::vector<Byte> deflatedDict = Zlib::Deflate(bytes, 9, dictionary);
+	REQUIRE_FALSE(deflatedDict.empty());
+	CHECK(deflatedDict.size() < deflated.size());
+	CHECK(Zlib::Inflate(deflatedDict, true, dictionary) == vec);
+	CHECK(Zlib::Inflate(deflatedDict).empty());
+	CHECK(Zlib::Inflate(deflatedDict, true, bytes.subspan(1, 200)).empty());
 }
@@ -0,0 +1,724 @@
+// Copyright 2025 <github.com/razaqq>
+
+#include "Client/AsyncDatabaseManager.hpp"
+#include "Client/DatabaseManager.hpp"
+#include "Client/MatchStatistics.hpp"
+
+#include "Core/Format.hpp"
+#include "Core/Log.hpp"
+#include "Core/Sqlite.hpp"
+#include "Core/StandardPaths.hpp"
+#include "Core/Version.hpp"
+
+#include "ReplayParser/ReplayParser.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/reporters/catch_reporter_event_listener.hpp>
+#include <catch2/reporters/catch_reporter_registrars.hpp>
+
+#include <QCoreApplication>
+#include <QObject>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+using PotatoAlert::Client::AsyncDatabaseManager;
+using PotatoAlert::Client::DatabaseManager;
+using PotatoAlert::Client::DatabaseStatistics;
+using PotatoAlert::Client::DatabaseTask;
+using PotatoAlert::Client::Match;
+using PotatoAlert::Client::MatchListCursor;
+using PotatoAlert::Client::MatchListEntry;
+using PotatoAlert::Client::MatchListFilter;
+using PotatoAlert::Client::MatchStatistics;
+using PotatoAlert::Client::NonAnalyzedMatch;
+using PotatoAlert::Client::SqlResult;
+using PotatoAlert::Client::StatisticsGrouping;
+using PotatoAlert::Client::TableSize;
+using PotatoAlert::Core::SQLite;
+using PotatoAlert::Core::Version;
+using PotatoAlert::ReplayParser::AchievementType;
+using PotatoAlert::ReplayParser::MatchOutcome;
+using PotatoAlert::ReplayParser::RibbonType;
+using PotatoAlert::ReplayParser::ReplaySummary;
+
+namespace {
+
+// every test case gets an empty directory, which also holds the backups of the migrations
+static fs::path GetDatabasePath(std::string_view name)
+{
+	const fs::path dir = fs::temp_directory_path() / "PotatoAlert" / "DatabaseTest" / name;
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	return dir / "match_history.db";
+}
+
+static std::string MakeMatchJson(std::string_view player, std::string_view clanTag, std::string_view ship, std::string_view enemy)
+{
+	return fmt::format(
+		R"({{"team1":{{"players":[{{"name":"{}","clan":{{"tag":"{}","name":"Clan {}"}},"ship":{{"name":"{}"}}}}]}},)"
+		R"("team2":{{"players":[{{"name":"{}","clan":null,"ship":{{"name":"Iowa"}}}}]}}}})",
+		player, clanTag, clanTag, ship, enemy);
+}
+
+static Match MakeMatch(std::string_view hash, std::string_view date, std::string_view ship, std::string_view map, std::string_view player)
+{
+	Match match;
+	match.Hash = hash;
+	match.ReplayName = fmt::format("{}.wowsreplay", hash);
+	match.Date = date;
+	match.Ship = ship;
+	match.ShipNation = "japan";
+	match.ShipClass = "Battleship";
+	match.ShipTier = 10;
+	match.Map = map;
+	match.MatchGroup = "pvp";
+	match.StatsMode = "current";
+	match.Player = player;
+	match.Region = "eu";
+	match.Json = MakeMatchJson(player, "PA", ship, "Enemy");
+	match.ArenaInfo = R"({"mapName":"test"})";
+	match.Analyzed = false;
+	return match;
+}
+
+// match<i> is played by Player<i> one minute after the previous one, every 3rd on the Yamato and every 2nd on Ocean
+static std::vector<Match> MakeMatches(uint32_t count)
+{
+	std::vector<Match> matches;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const std::string_view ship = i % 3 == 0 ? "Yamato" : "Shimakaze";
+		const std::string_view map = i % 2 == 0 ? "Ocean" : "Islands";
+		matches.emplace_back(MakeMatch(fmt::format("match{}", i), fmt::format("2024-01-01 {:02}:{:02}:00", i / 60, i % 60),
+			ship, map, fmt::format("Player{}", i)));
+	}
+	return matches;
+}
+
+static size_t GetMatchCount(const DatabaseManager& dbm, const MatchListFilter& filter = {})
+{
+	SqlResult<size_t> count = dbm.GetMatchCount(filter);
+	REQUIRE(count);
+	return *count;
+}
+
+static bool MatchExists(const DatabaseManager& dbm, std::string_view hash)
+{
+	SqlResult<bool> exists = dbm.MatchExists(hash);
+	REQUIRE(exists);
+	return *exists;
+}
+
+static std::optional<MatchStatistics> FindStatistics(const DatabaseManager& dbm, StatisticsGrouping grouping, std::string_view key)
+{
+	SqlResult<std::vector<MatchStatistics>> statistics = dbm.GetMatchStatistics(grouping);
+	REQUIRE(statistics);
+	auto it = std::ranges::find(*statistics, key, &MatchStatistics::Key);
+	if (it == statistics->end())
+	{
+		return std::nullopt;
+	}
+	return *it;
+}
+
+static std::vector<std::string> SearchHashes(const DatabaseManager& dbm, std::string_view query)
+{
+	SqlResult<std::vector<MatchListEntry>> entries = dbm.SearchMatches(query, 1000);
+	REQUIRE(entries);
+	std::vector<std::string> hashes;
+	for (const MatchListEntry& entry : *entries)
+	{
+		hashes.emplace_back(entry.Hash);
+	}
+	return hashes;
+}
+
+// the quick check runs on the writer thread once it is idle after startup
+static std::optional<bool> WaitForQuickCheck(const DatabaseManager& dbm)
+{
+	for (int i = 0; i < 500; i++)
+	{
+		SqlResult<DatabaseStatistics> statistics = dbm.GetDatabaseStatistics();
+		REQUIRE(statistics);
+		if (statistics->QuickCheckPassed)
+		{
+			return statistics->QuickCheckPassed;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	return std::nullopt;
+}
+
+// the results of the async queries are queued to the thread of the application
+static bool ProcessEventsUntil(const std::function<bool()>& done)
+{
+	for (int i = 0; i < 500; i++)
+	{
+		QCoreApplication::processEvents();
+		if (done())
+		{
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return false;
+}
+
+// reads the first column of the first row on a separate connection, like any other reader of the database
+static std::string ReadValue(const fs::path& dbPath, std::string_view query)
+{
+	SQLite db = SQLite::Open(dbPath, SQLite::Flags::ReadOnly);
+	REQUIRE(db);
+	SQLite::Statement stmt(db, query);
+	REQUIRE(stmt);
+	stmt.ExecuteStep();
+	std::string value;
+	REQUIRE(stmt.HasRow());
+	REQUIRE(stmt.GetText(0, value));
+	return value;
+}
+
+}
+
+class TestRunListener : public Catch::EventListenerBase
+{
+public:
+	using Catch::EventListenerBase::EventListenerBase;
+
+	void testRunStarting(Catch::TestRunInfo const&) override
+	{
+		PotatoAlert::Core::Log::Init(PotatoAlert::Core::AppDataPath("PotatoAlert") / "DatabaseTest.log");
+	}
+};
+CATCH_REGISTER_LISTENER(TestRunListener)
+
+TEST_CASE("DatabaseTest_MatchListTest")
+{
+	SQLite db = SQLite::Open(GetDatabasePath("MatchList"), SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+	REQUIRE(db);
+	DatabaseManager dbm(db);
+
+	std::vector<Match> matches = MakeMatches(300);
+	REQUIRE(dbm.AddMatches(matches));
+
+	// the pages follow each other without gaps or duplicates, newest first
+	std::vector<std::string> hashes;
+	std::optional<MatchListCursor> cursor;
+	while (true)
+	{
+		SqlResult<std::vector<MatchListEntry>> page = dbm.GetMatchList(MatchListFilter{}, 64, cursor);
+		REQUIRE(page);
+		REQUIRE(page->size() <= 64);
+		if (page->empty())
+			break;
+
+		for (const MatchListEntry& entry : *page)
+		{
+			hashes.emplace_back(entry.Hash);
+		}
+		cursor = MatchListCursor{ page->back().Date, page->back().Id };
+	}
+	REQUIRE(hashes.size() == 300);
+	for (size_t i = 0; i < hashes.size(); i++)
+	{
+		REQUIRE(hashes[i] == fmt::format("match{}", 299 - i));
+	}
+
+	SqlResult<std::vector<MatchListEntry>> list = dbm.GetMatchList(MatchListFilter{ .Maps = { "Ocean" } }, 10);
+	REQUIRE(list);
+	REQUIRE(list->size() == 10);
+	REQUIRE(list->front().Hash == "match298");
+	REQUIRE(std::ranges::all_of(*list, [](const MatchListEntry& entry) { return entry.Map == "Ocean"; }));
+
+	REQUIRE(GetMatchCount(dbm, MatchListFilter{ .Ships = { "Yamato" } }) == 100);
+	REQUIRE(GetMatchCount(dbm, MatchListFilter{ .Ships = { "Yamato" }, .Maps = { "Ocean" } }) == 50);
+	REQUIRE(GetMatchCount(dbm, MatchListFilter{ .Ships = { "Yamato", "Shimakaze" }, .Players = { "Player1", "Player2" } }) == 2);
+	REQUIRE(GetMatchCount(dbm, MatchListFilter{ .DateFrom = "2024-01-01 01:00:00", .DateTo = "2024-01-01 01:59:59" }) == 60);
+}
+
+TEST_CASE("DatabaseTest_WriterTest")
+{
+	// writes from several threads are serialized by the writer, while the readers see every committed match
+	auto writeConcurrently = [](const DatabaseManager& dbm)
+	{
+		std::atomic<size_t> failed = 0;
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < 4; t++)
+		{
+			threads.emplace_back([&dbm, &failed, t]()
+			{
+				for (uint32_t i = 0; i < 50; i++)
+				{
+					Match match = MakeMatch(fmt::format("match{}_{}", t, i), fmt::format("2024-01-0{} 00:{:02}:00", t + 1, i), "Yamato", "Ocean", "Player");
+					if (!dbm.AddMatch(match) || match.Id == 0)
+					{
+						failed++;
+					}
+
+					SqlResult<bool> exists = dbm.MatchExists(match.Hash);
+					if (!exists || !*exists)
+					{
+						failed++;
+					}
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		return failed.load();
+	};
+
+	const fs::path dbPath = GetDatabasePath("Writer");
+	{
+		SQLite db = SQLite::Open(dbPath, SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+		REQUIRE(db);
+		DatabaseManager dbm(db);
+		REQUIRE(ReadValue(dbPath, "PRAGMA journal_mode") == "wal");
+
+		REQUIRE(writeConcurrently(dbm) == 0);
+		REQUIRE(GetMatchCount(dbm) == 200);
+	}
+
+	// in-memory databases cannot be opened again, the readers share the connection of the writer
+	SQLite memory = SQLite::Open(":memory:", SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+	REQUIRE(memory);
+	DatabaseManager dbm(memory);
+	REQUIRE(writeConcurrently(dbm) == 0);
+	REQUIRE(GetMatchCount(dbm) == 200);
+}
+
+TEST_CASE("DatabaseTest_BulkWriteTest")
+{
+	SQLite db = SQLite::Open(GetDatabasePath("BulkWrite"), SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+	REQUIRE(db);
+	DatabaseManager dbm(db);
+
+	std::vector<Match> matches = MakeMatches(300);
+	REQUIRE(dbm.AddMatches(matches));
+	REQUIRE(std::ranges::all_of(matches, [](const Match& match) { return match.Id != 0; }));
+	REQUIRE(GetMatchCount(dbm) == 300);
+
+	// a bulk write is applied to all matches or to none
+	std::vector<Match> duplicates = { MakeMatch("new", "2024-02-01 00:00:00", "Yamato", "Ocean", "Player"), matches[0] };
+	REQUIRE_FALSE(dbm.AddMatches(duplicates));
+	REQUIRE_FALSE(MatchExists(dbm, "new"));
+	REQUIRE(GetMatchCount(dbm) == 300);
+
+	std::vector<ReplaySummary> summaries;
+	for (uint32_t i = 0; i < 30; i++)
+	{
+		ReplaySummary summary;
+		summary.Hash = matches[i].Hash;
+		summary.Outcome = i % 3 == 0 ? MatchOutcome::Loss : MatchOutcome::Win;
+		summary.DamageDealt = 1000.0f;
+		summary.DamageTaken = 500.0f;
+		summaries.emplace_back(std::move(summary));
+	}
+	REQUIRE(dbm.SetMatchReplaySummaries(summaries));
+
+	SqlResult<std::optional<Match>> match = dbm.GetMatch(matches[0].Id);
+	REQUIRE(match);
+	REQUIRE(match->has_value());
+	REQUIRE(match->value().Analyzed);
+	REQUIRE(match->value().ReplaySummary.Outcome == MatchOutcome::Loss);
+
+	SqlResult<std::vector<NonAnalyzedMatch>> nonAnalyzed = dbm.GetNonAnalyzedMatches();
+	REQUIRE(nonAnalyzed);
+	REQUIRE(nonAnalyzed->size() == 270);
+
+	std::vector<uint32_t> ids;
+	for (uint32_t i = 0; i < 150; i++)
+	{
+		ids.emplace_back(matches[i].Id);
+	}
+	REQUIRE(dbm.DeleteMatches(ids));
+
+	REQUIRE(GetMatchCount(dbm) == 150);
+	REQUIRE_FALSE(MatchExists(dbm, "match7"));
+	REQUIRE(MatchExists(dbm, "match150"));
+}
+
+TEST_CASE("DatabaseTest_MigrationTest")
+{
+	const fs::path dbPath = GetDatabasePath("Migration");
+
+	// the schema of version 1.0, with the json as text and the replay summary as json
+	{
+		SQLite db = SQLite::Open(dbPath, SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+		REQUIRE(db);
+		REQUIRE(db.Execute(
+			"CREATE TABLE matches (Id INTEGER PRIMARY KEY, Hash TEXT UNIQUE, ReplayName TEXT, Date TEXT, Ship TEXT, "
+			"ShipNation TEXT, ShipClass TEXT, ShipTier INTEGER, Map TEXT, MatchGroup TEXT, StatsMode TEXT, Player TEXT, "
+			"Region TEXT, Json TEXT, ArenaInfo TEXT, Analyzed INTEGER DEFAULT FALSE, ReplaySummary TEXT);"
+			"CREATE TABLE schemaInfo (Id INTEGER PRIMARY KEY, Version TEXT);"
+			"INSERT INTO schemaInfo (Id, Version) VALUES (1, '1.0');"));
+
+		SQLite::Statement insertStmt(db,
+			"INSERT INTO matches (Hash, ReplayName, Date, Ship, Map, MatchGroup, Player, Json, ArenaInfo, Analyzed, ReplaySummary) "
+			"VALUES (:Hash, :Hash, :Date, :Ship, :Map, 'pvp', :Player, :Json, '{}', :Analyzed, :ReplaySummary)");
+		REQUIRE(insertStmt);
+
+		auto insert = [&](std::string_view hash, std::string_view date, std::string_view ship, std::string_view map,
+						  std::string_view player, std::optional<std::string_view> replaySummary)
+		{
+			const std::string json = MakeMatchJson(player, "OLD", ship, "Enemy");
+			insertStmt.Reset();
+			insertStmt.Bind(":Hash", hash);
+			insertStmt.Bind(":Date", date);
+			insertStmt.Bind(":Ship", ship);
+			insertStmt.Bind(":Map", map);
+			insertStmt.Bind(":Player", player);
+			insertStmt.Bind(":Json", std::string_view(json));
+			insertStmt.Bind(":Analyzed", static_cast<int32_t>(replaySummary.has_value()));
+			if (replaySummary)
+			{
+				insertStmt.Bind(":ReplaySummary", *replaySummary);
+			}
+			insertStmt.ExecuteStep();
+			REQUIRE_FALSE(insertStmt.HasFailed());
+		};
+
+		insert("analyzed", "2023-05-01 18:00:00", "Yamato", "Ocean", "Alice",
+			R"({"outcome":"win","damage_dealt":1500.5,"damage_taken":250.5,"damage_spotting":100.5,"damage_potential":9000.5,"achievements":{},"ribbons":{}})");
+		insert("nonAnalyzed", "2023-05-02 18:00:00", "Shimakaze", "Islands", "Bob", std::nullopt);
+		insert("brokenSummary", "2023-05-03 18:00:00", "Yamato", "Islands", "Carol", "not json");
+	}
+
+	SQLite db = SQLite::Open(dbPath, SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+	REQUIRE(db);
+	DatabaseManager dbm(db);
+
+	// 1.1 compressed the json
+	SqlResult<std::optional<Match>> match = dbm.GetMatch("analyzed");
+	REQUIRE(match);
+	REQUIRE(match->has_value());
+	REQUIRE(match->value().Json == MakeMatchJson("Alice", "OLD", "Yamato", "Enemy"));
+	REQUIRE(match->value().ArenaInfo == "{}");
+	REQUIRE(match->value().Analyzed);
+	REQUIRE(ReadValue(dbPath, "SELECT typeof(Json) FROM matches WHERE Hash = 'analyzed'") == "blob");
+
+	// 1.2 moved the replay summary into its columns, a summary that cannot be parsed is migrated empty
+	SqlResult<std::optional<ReplaySummary>> summary = dbm.GetReplaySummary(match->value().Id);
+	REQUIRE(summary);
+	REQUIRE(summary->has_value());
+	REQUIRE(summary->value().Outcome == MatchOutcome::Win);
+	REQUIRE(summary->value().DamageDealt == 1500.5f);
+	REQUIRE(summary->value().DamageTaken == 250.5f);
+	REQUIRE(summary->value().DamageSpotting == 100.5f);
+	REQUIRE(summary->value().DamagePotential == 9000.5f);
+
+	SqlResult<std::optional<Match>> broken = dbm.GetMatch("brokenSummary");
+	REQUIRE(broken);
+	REQUIRE(broken->has_value());
+	REQUIRE(broken->value().ReplaySummary.DamageDealt == 0.0f);
+
+	// 1.3 built the statistics of the existing matches
+	std::optional<MatchStatistics> all = FindStatistics(dbm, StatisticsGrouping::All, "");
+	REQUIRE(all);
+	REQUIRE(all->Matches == 3);
+	REQUIRE(all->Analyzed == 2);
+	REQUIRE(all->Wins == 1);
+	REQUIRE(all->DamageDealt == 1500.5);
+
+	std::optional<MatchStatistics> yamato = FindStatistics(dbm, StatisticsGrouping::Ship, "Yamato");
+	REQUIRE(yamato);
+	REQUIRE(yamato->Matches == 2);
+
+	// 1.4 indexed the existing matches for search
+	REQUIRE(SearchHashes(dbm, "Alice") == std::vector<std::string>{ "analyzed" });
+	REQUIRE(SearchHashes(dbm, "Islands") == std::vector<std::string>{ "brokenSummary", "nonAnalyzed" });
+	REQUIRE(SearchHashes(dbm, "OLD").size() == 3);
+
+	REQUIRE(WaitForQuickCheck(dbm) == true);
+
+	REQUIRE(Version(ReadValue(dbPath, "SELECT Version FROM schemaInfo")) == Version(1, 4));
+
+	// new matches are compressed as well and only decompressed when they are read
+	Match added = MakeMatch("added", "2024-01-01 00:00:00", "Montana", "Ocean", "Dave");
+	REQUIRE(dbm.AddMatch(added));
+	REQUIRE(ReadValue(dbPath, "SELECT typeof(Json) FROM matches WHERE Hash = 'added'") == "blob");
+	SqlResult<std::optional<std::string>> json = dbm.GetMatchJson("added");
+	REQUIRE(json);
+	REQUIRE(json->value_or("") == added.Json);
+}
+
+TEST_CASE("DatabaseTest_ReplaySummaryTest")
+{
+	SQLite db = SQLite::Open(GetDatabasePath("ReplaySummary"), SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+	REQUIRE(db);
+	DatabaseManager dbm(db);
+
+	Match match = MakeMatch("match", "2024-01-01 00:00:00", "Yamato", "Ocean", "Player");
+	REQUIRE(dbm.AddMatch(match));
+
+	SqlResult<std::optional<ReplaySummary>> summary = dbm.GetReplaySummary(match.Id);
+	REQUIRE(summary);
+	REQUIRE_FALSE(summary->has_value());
+
+	// the awards are stored in their own table and read back with the summary
+	ReplaySummary written;
+	written.Hash = match.Hash;
+	written.Outcome = MatchOutcome::Win;
+	written.DamageDealt = 123456.5f;
+	written.DamageTaken = 23456.5f;
+	written.DamageSpotting = 3456.5f;
+	written.DamagePotential = 456789.5f;
+	written.Achievements = { { AchievementType::DevastatingStrike, 1 }, { AchievementType::HighCaliber, 2 } };
+	written.Ribbons = { { RibbonType::Artillery, 42 } };
+	REQUIRE(dbm.SetMatchReplaySummary(match.Id, written));
+
+	summary = dbm.GetReplaySummary(match.Id);
+	REQUIRE(summary);
+	REQUIRE(summary->has_value());
+	REQUIRE(summary->value().Hash == match.Hash);
+	REQUIRE(summary->value().Outcome == MatchOutcome::Win);
+	REQUIRE(summary->value().DamageDealt == 123456.5f);
+	REQUIRE(summary->value().DamageTaken == 23456.5f);
+	REQUIRE(summary->value().DamageSpotting == 3456.5f);
+	REQUIRE(summary->value().DamagePotential == 456789.5f);
+	REQUIRE(summary->value().Achievements == written.Achievements);
+	REQUIRE(summary->value().Ribbons == written.Ribbons);
+
+	REQUIRE(dbm.SetMatchNonAnalyzed(match.Id));
+	summary = dbm.GetReplaySummary(match.Id);
+	REQUIRE(summary);
+	REQUIRE_FALSE(summary->has_value());
+}
+
+TEST_CASE("DatabaseTest_StatisticsTest")
+{
+	SQLite db = SQLite::Open(GetDatabasePath("Statistics"), SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+	REQUIRE(db);
+	DatabaseManager dbm(db);
+
+	std::vector<Match> matches = MakeMatches(300);
+	REQUIRE(dbm.AddMatches(matches));
+
+	// inserting updates the statistics of every grouping
+	std::optional<MatchStatistics> all = FindStatistics(dbm, StatisticsGrouping::All, "");
+	REQUIRE(all);
+	REQUIRE(all->Matches == 300);
+	REQUIRE(all->Analyzed == 0);
+
+	std::optional<MatchStatistics> yamato = FindStatistics(dbm, StatisticsGrouping::Ship, "Yamato");
+	REQUIRE(yamato);
+	REQUIRE(yamato->Matches == 100);
+
+	std::optional<MatchStatistics> ocean = FindStatistics(dbm, StatisticsGrouping::Map, "Ocean");
+	REQUIRE(ocean);
+	REQUIRE(ocean->Matches == 150);
+
+	// setting the summaries counts the matches as analyzed
+	std::vector<ReplaySummary> summaries;
+	for (uint32_t i = 0; i < 30; i++)
+	{
+		ReplaySummary summary;
+		summary.Hash = matches[i].Hash;
+		summary.Outcome = i % 3 == 0 ? MatchOutcome::Loss : MatchOutcome::Win;
+		summary.DamageDealt = 1000.0f;
+		summary.DamageTaken = 500.0f;
+		summaries.emplace_back(std::move(summary));
+	}
+	REQUIRE(dbm.SetMatchReplaySummaries(summaries));
+
+	all = FindStatistics(dbm, StatisticsGrouping::All, "");
+	REQUIRE(all);
+	REQUIRE(all->Analyzed == 30);
+	REQUIRE(all->Wins == 20);
+	REQUIRE(all->Losses == 10);
+	REQUIRE(all->DamageDealt == 30000.0);
+	REQUIRE(all->PerGame(all->DamageTaken) == 500.0);
+
+	yamato = FindStatistics(dbm, StatisticsGrouping::Ship, "Yamato");
+	REQUIRE(yamato);
+	REQUIRE(yamato->Analyzed == 10);
+	REQUIRE(yamato->Losses == 10);
+	REQUIRE(yamato->WinRate() == 0.0);
+
+	// updating a match moves it to the groups of its new values
+	SqlResult<std::optional<Match>> match = dbm.GetMatch(matches[0].Id);
+	REQUIRE(match);
+	REQUIRE(match->has_value());
+	Match updated = match->value();
+	REQUIRE(updated.Analyzed);
+	updated.Ship = "Montana";
+	REQUIRE(dbm.UpdateMatch(updated.Id, updated));
+
+	yamato = FindStatistics(dbm, StatisticsGrouping::Ship, "Yamato");
+	REQUIRE(yamato);
+	REQUIRE(yamato->Matches == 99);
+	REQUIRE(yamato->Analyzed == 9);
+
+	std::optional<MatchStatistics> montana = FindStatistics(dbm, StatisticsGrouping::Ship, "Montana");
+	REQUIRE(montana);
+	REQUIRE(montana->Matches == 1);
+	REQUIRE(montana->Analyzed == 1);
+	REQUIRE(montana->Losses == 1);
+	REQUIRE(montana->DamageDealt == 1000.0);
+
+	REQUIRE(dbm.SetMatchNonAnalyzed(updated.Id));
+	montana = FindStatistics(dbm, StatisticsGrouping::Ship, "Montana");
+	REQUIRE(montana);
+	REQUIRE(montana->Analyzed == 0);
+	REQUIRE(montana->DamageDealt == 0.0);
+
+	// deleting removes the matches from the statistics
+	std::vector<uint32_t> ids;
+	for (uint32_t i = 0; i < 150; i++)
+	{
+		ids.emplace_back(matches[i].Id);
+	}
+	REQUIRE(dbm.DeleteMatches(ids));
+
+	all = FindStatistics(dbm, StatisticsGrouping::All, "");
+	REQUIRE(all);
+	REQUIRE(all->Matches == 150);
+	REQUIRE(all->Analyzed == 0);
+	REQUIRE(all->Wins == 0);
+	REQUIRE(all->DamageDealt == 0.0);
+
+	// groups without any matches left are removed
+	REQUIRE_FALSE(FindStatistics(dbm, StatisticsGrouping::Ship, "Montana"));
+
+	yamato = FindStatistics(dbm, StatisticsGrouping::Ship, "Yamato");
+	REQUIRE(yamato);
+	REQUIRE(yamato->Matches == 50);
+}
+
+TEST_CASE("DatabaseTest_SearchTest")
+{
+	SQLite db = SQLite::Open(GetDatabasePath("Search"), SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+	REQUIRE(db);
+	DatabaseManager dbm(db);
+
+	std::vector<Match> matches = MakeMatches(300);
+	REQUIRE(dbm.AddMatches(matches));
+
+	// every word has to match a player, clan, ship or map, newest first
+	REQUIRE(SearchHashes(dbm, "Player7") == std::vector<std::string>{ "match7" });
+	REQUIRE(SearchHashes(dbm, "Player29*").size() == 11);
+	REQUIRE(SearchHashes(dbm, "Player29*").front() == "match299");
+	REQUIRE(SearchHashes(dbm, "Player7 Ocean").empty());
+	REQUIRE(SearchHashes(dbm, "Player7 Islands") == std::vector<std::string>{ "match7" });
+	REQUIRE(SearchHashes(dbm, "PA Yamato").size() == 100);
+
+	// updates and deletes are reflected in the index
+	Match updated = matches[7];
+	updated.Map = "Ocean";
+	REQUIRE(dbm.UpdateMatch(updated.Id, updated));
+	REQUIRE(SearchHashes(dbm, "Player7 Ocean") == std::vector<std::string>{ "match7" });
+
+	std::vector<uint32_t> ids;
+	for (uint32_t i = 0; i < 150; i++)
+	{
+		ids.emplace_back(matches[i].Id);
+	}
+	REQUIRE(dbm.DeleteMatches(ids));
+
+	REQUIRE(SearchHashes(dbm, "Player7").empty());
+	REQUIRE(SearchHashes(dbm, "Player299") == std::vector<std::string>{ "match299" });
+	REQUIRE(SearchHashes(dbm, "Enemy").size() == 150);
+}
+
+TEST_CASE("DatabaseTest_MaintenanceTest")
+{
+	const fs::path dbPath = GetDatabasePath("Maintenance");
+
+	SQLite db = SQLite::Open(dbPath, SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+	REQUIRE(db);
+	DatabaseManager dbm(db);
+
+	// new databases use incremental auto vacuum right away, without waiting for the rebuild of the maintenance
+	REQUIRE(ReadValue(dbPath, "PRAGMA auto_vacuum") == "2");
+	REQUIRE(WaitForQuickCheck(dbm) == true);
+
+	std::vector<Match> matches = MakeMatches(300);
+	REQUIRE(dbm.AddMatches(matches));
+
+	SqlResult<DatabaseStatistics> statistics = dbm.GetDatabaseStatistics();
+	REQUIRE(statistics);
+	REQUIRE(statistics->PageSize > 0);
+	REQUIRE(statistics->PageCount > 0);
+	REQUIRE(statistics->QuickCheckPassed == true);
+	REQUIRE_FALSE(statistics->Tables.empty());
+	REQUIRE(std::ranges::is_sorted(statistics->Tables, std::ranges::greater{}, &TableSize::Size));
+	REQUIRE(std::ranges::find(statistics->Tables, "matches", &TableSize::Name) != statistics->Tables.end());
+}
+
+TEST_CASE("DatabaseTest_AsyncTest")
+{
+	char name[] = "DatabaseTest";
+	char* argv[] = { name, nullptr };
+	int argc = 1;
+	QCoreApplication app(argc, argv);
+
+	SQLite db = SQLite::Open(GetDatabasePath("Async"), SQLite::Flags::ReadWrite | SQLite::Flags::Create);
+	REQUIRE(db);
+	DatabaseManager dbm(db);
+
+	std::vector<Match> matches = MakeMatches(300);
+	REQUIRE(dbm.AddMatches(matches));
+
+	// a single worker runs the queries in order, so a finished query means all earlier ones are done
+	AsyncDatabaseManager async(dbm, 1);
+	QObject context;
+
+	std::optional<SqlResult<std::vector<MatchListEntry>>> list;
+	async.GetMatchListAsync(MatchListFilter{}, &context, [&list, thread = std::this_thread::get_id()](SqlResult<std::vector<MatchListEntry>> result)
+	{
+		REQUIRE(std::this_thread::get_id() == thread);
+		list = std::move(result);
+	});
+	REQUIRE(ProcessEventsUntil([&list]() { return list.has_value(); }));
+	REQUIRE(*list);
+	REQUIRE(list->value().size() == 300);
+	REQUIRE(list->value().front().Hash == "match299");
+
+	// cancelled queries never call back
+	bool cancelledCalled = false;
+	DatabaseTask cancelled = async.SearchMatchesAsync("Player7", 10, &context, [&cancelledCalled](SqlResult<std::vector<MatchListEntry>>)
+	{
+		cancelledCalled = true;
+	});
+	cancelled.Cancel();
+	REQUIRE(cancelled.IsCancelled());
+
+	// neither do queries whose context was destroyed before the result arrived
+	bool destroyedCalled = false;
+	{
+		auto destroyed = std::make_unique<QObject>();
+		async.AddMatchAsync(MakeMatch("async", "2024-02-01 00:00:00", "Yamato", "Ocean", "Player"), destroyed.get(),
+			[&destroyedCalled](SqlResult<std::optional<Match>>)
+		{
+			destroyedCalled = true;
+		});
+	}
+
+	std::optional<SqlResult<std::optional<std::string>>> json;
+	async.GetMatchJsonAsync(matches[0].Id, &context, [&json](SqlResult<std::optional<std::string>> result)
+	{
+		json = std::move(result);
+	});
+	REQUIRE(ProcessEventsUntil([&json]() { return json.has_value(); }));
+	REQUIRE(*json);
+	REQUIRE(json->value() == matches[0].Json);
+
+	REQUIRE_FALSE(cancelledCalled);
+	REQUIRE_FALSE(destroyedCalled);
+	REQUIRE(MatchExists(dbm, "async"));
+}
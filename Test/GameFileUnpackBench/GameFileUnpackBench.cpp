@@ -0,0 +1,607 @@
+// Copyright 2025 <github.com/razaqq>
+
+#include "Core/AsciiTable.hpp"
+#include "Core/Bytes.hpp"
+#include "Core/Crc32.hpp"
+#include "Core/Defer.hpp"
+#include "Core/Directory.hpp"
+#include "Core/File.hpp"
+#include "Core/Format.hpp"
+#include "Core/Json.hpp"
+#include "Core/Zlib.hpp"
+
+#include "GameFileUnpack/GameFileUnpack.hpp"
+
+#include <zlib.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+using PotatoAlert::Core::AsciiTable;
+using PotatoAlert::Core::Byte;
+using PotatoAlert::Core::Crc32;
+using PotatoAlert::Core::File;
+using PotatoAlert::GameFileUnpack::DirectoryTree;
+using PotatoAlert::GameFileUnpack::FileRecord;
+using PotatoAlert::GameFileUnpack::IdxFile;
+using PotatoAlert::GameFileUnpack::Unpacker;
+
+namespace {
+
+struct Options
+{
+	size_t FileCount = 20000;
+	size_t FileSize = 16 * 1024;  // average uncompressed size of a synthetic file
+	size_t Iterations = 5;
+	uint32_t Seed = 1337;
+	fs::path JsonOutput;
+};
+
+struct BenchResult
+{
+	std::string Name;
+	size_t Iterations;
+	double Seconds;     // total over all iterations
+	uint64_t Bytes;     // per iteration
+	uint64_t Items;     // per iteration
+
+	[[nodiscard]] double MegaBytesPerSecond() const
+	{
+		return static_cast<double>(Bytes) * static_cast<double>(Iterations) / Seconds / 1e6;
+	}
+
+	[[nodiscard]] double ItemsPerSecond() const
+	{
+		return static_cast<double>(Items) * static_cast<double>(Iterations) / Seconds;
+	}
+
+	[[nodiscard]] double NanosecondsPerItem() const
+	{
+		return Seconds * 1e9 / (static_cast<double>(Items) * static_cast<double>(Iterations));
+	}
+};
+
+// runs func once to warm up caches and then measures the given number of iterations
+// func reports failures itself and returns false, which stops the benchmark without a result
+template<typename Func>
+static bool Measure(std::vector<BenchResult>& results, std::string_view name, size_t iterations, uint64_t bytes, uint64_t items, Func&& func)
+{
+	if (!func())
+		return false;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++)
+	{
+		if (!func())
+			return false;
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	results.emplace_back(BenchResult{ std::string(name), iterations, elapsed.count(), bytes, items });
+	return true;
+}
+
+struct SyntheticFile
+{
+	std::string Path;
+	std::vector<Byte> Data;
+};
+
+// creates files with a directory structure and compressibility roughly matching the game files
+static std::vector<SyntheticFile> MakeSyntheticFiles(const Options& options)
+{
+	static constexpr std::string_view roots[] = { "content", "gui", "scripts", "spaces" };
+	static constexpr std::string_view extensions[] = { ".xml", ".dds", ".json", ".bin", ".py" };
+
+	std::mt19937 rng(options.Seed);
+	std::uniform_int_distribution<size_t> size(options.FileSize / 2, options.FileSize + options.FileSize / 2);
+	std::uniform_int_distribution<int> word('a', 'h');
+
+	std::vector<SyntheticFile> files;
+	files.reserve(options.FileCount);
+	for (size_t i = 0; i < options.FileCount; i++)
+	{
+		SyntheticFile& file = files.emplace_back();
+		file.Path = fmt::format("{}/dir_{}/sub_{}/file_{}{}", roots[i % std::size(roots)], (i / 7) % 64, (i / 3) % 16, i, extensions[i % std::size(extensions)]);
+
+		// random bytes from a small alphabet of 'a' to 'h', which compress similar to text assets
+		file.Data.resize(size(rng));
+		for (Byte& b : file.Data)
+		{
+			b = static_cast<Byte>(word(rng));
+		}
+	}
+	return files;
+}
+
+template<typename T>
+static void Put(std::vector<Byte>& out, size_t offset, T value)
+{
+	if (out.size() < offset + sizeof(T))
+	{
+		out.resize(offset + sizeof(T));
+	}
+	std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+static std::vector<Byte> Deflate(std::span<const Byte> in)
+{
+	z_stream stream = {};
+	deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+	std::vector<Byte> out(deflateBound(&stream, static_cast<uLong>(in.size())));
+	stream.next_in = const_cast<Bytef*>(in.data());
+	stream.avail_in = static_cast<uInt>(in.size());
+	stream.next_out = out.data();
+	stream.avail_out = static_cast<uInt>(out.size());
+	deflate(&stream, Z_FINISH);
+	out.resize(stream.total_out);
+	deflateEnd(&stream);
+
+	return out;
+}
+
+static bool WriteFile(const fs::path& path, std::span<const Byte> data)
+{
+	const File file = File::Open(path, File::Flags::Write | File::Flags::Create | File::Flags::Truncate);
+	return file && file.Write(data);
+}
+
+// writes <dir>/idx/<name>.idx and <dir>/pkg/<name>_0001.pkg in the same layout as the game
+static bool WriteSyntheticIdxPkg(const fs::path& dir, std::string_view name, std::span<const SyntheticFile> files)
+{
+	using namespace PotatoAlert::GameFileUnpack;
+
+	struct SyntheticNode
+	{
+		std::string Name;
+		uint64_t Id;
+		uint64_t Parent;
+	};
+
+	static constexpr uint64_t rootId = 1;
+	uint64_t nextId = 1000;
+	std::vector<SyntheticNode> nodes;
+	std::map<std::string, uint64_t, std::less<>> nodeIds;
+	std::vector<uint64_t> fileNodes;
+	fileNodes.reserve(files.size());
+
+	for (const SyntheticFile& file : files)
+	{
+		uint64_t parent = rootId;
+		size_t pos = 0;
+		while (true)
+		{
+			const size_t end = file.Path.find('/', pos);
+			const std::string current = file.Path.substr(0, end);
+			const std::string part = file.Path.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+
+			auto it = nodeIds.find(current);
+			if (it == nodeIds.end())
+			{
+				it = nodeIds.emplace(current, nextId++).first;
+				nodes.emplace_back(SyntheticNode{ part, it->second, parent });
+			}
+			parent = it->second;
+
+			if (end == std::string::npos)
+				break;
+			pos = end + 1;
+		}
+		fileNodes.emplace_back(parent);
+	}
+
+	const std::string pkgName = fmt::format("{}_0001.pkg", name);
+	const size_t nodeTable = HeaderSize;
+	const size_t recordTable = nodeTable + nodes.size() * NodeSize;
+	const size_t volumeTable = recordTable + files.size() * FileRecordSize;
+
+	std::vector<Byte> idx(volumeTable + VolumeSize);
+	std::vector<Byte> pkg;
+
+	std::memcpy(idx.data(), "ISFP", 4);
+	Put<uint32_t>(idx, 0x04, 0x2000000);
+	Put<uint32_t>(idx, 0x08, 0x12345678u ^ static_cast<uint32_t>(files.size()));
+	Put<uint32_t>(idx, 0x0C, 0x40);
+	Put<uint32_t>(idx, 0x10, static_cast<uint32_t>(nodes.size()));
+	Put<uint32_t>(idx, 0x14, static_cast<uint32_t>(files.size()));
+	Put<uint32_t>(idx, 0x18, 1);
+	Put<uint32_t>(idx, 0x1C, 0);
+	Put<uint64_t>(idx, 0x20, nodeTable - HeaderDataOffset);
+	Put<uint64_t>(idx, 0x28, recordTable - HeaderDataOffset);
+	Put<uint64_t>(idx, 0x30, volumeTable - HeaderDataOffset);
+
+	// name pointers are relative to the start of the node/volume entry
+	auto putName = [&idx](size_t entryOffset, std::string_view str)
+	{
+		const size_t strOffset = idx.size();
+		idx.insert(idx.end(), reinterpret_cast<const Byte*>(str.data()), reinterpret_cast<const Byte*>(str.data() + str.size()));
+		idx.push_back(0);
+		Put<uint64_t>(idx, entryOffset, str.size() + 1);
+		Put<uint64_t>(idx, entryOffset + 8, strOffset - entryOffset);
+	};
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		const size_t offset = nodeTable + i * NodeSize;
+		putName(offset, nodes[i].Name);
+		Put<uint64_t>(idx, offset + 0x10, nodes[i].Id);
+		Put<uint64_t>(idx, offset + 0x18, nodes[i].Parent);
+	}
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		const std::vector<Byte> compressed = Deflate(files[i].Data);
+		const size_t offset = recordTable + i * FileRecordSize;
+		Put<uint64_t>(idx, offset + 0x00, fileNodes[i]);
+		Put<uint64_t>(idx, offset + 0x08, 1);
+		Put<uint64_t>(idx, offset + 0x10, pkg.size());
+		Put<uint64_t>(idx, offset + 0x18, 5);
+		Put<uint32_t>(idx, offset + 0x20, static_cast<uint32_t>(compressed.size()));
+		Put<uint32_t>(idx, offset + 0x24, Crc32(files[i].Data));
+		Put<uint64_t>(idx, offset + 0x28, files[i].Data.size());
+		pkg.insert(pkg.end(), compressed.begin(), compressed.end());
+	}
+
+	putName(volumeTable, pkgName);
+	Put<uint64_t>(idx, volumeTable + 0x10, 1);
+
+	std::error_code ec;
+	fs::create_directories(dir / "idx", ec);
+	fs::create_directories(dir / "pkg", ec);
+	if (ec)
+		return false;
+
+	return WriteFile(dir / "idx" / fmt::format("{}.idx", name), idx) && WriteFile(dir / "pkg" / pkgName, pkg);
+}
+
+static bool ReadFile(const fs::path& path, std::vector<Byte>& out)
+{
+	const File file = File::Open(path, File::Flags::Read | File::Flags::Open);
+	return file && file.ReadAll(out);
+}
+
+static std::optional<IdxFile> ParseIdx(std::span<const Byte> data)
+{
+	PA_TRY_OR_ELSE(idxFile, IdxFile::Parse(data),
+	{
+		fmt::println(stderr, "Failed to parse idx file: {}", error);
+		return {};
+	});
+	return idxFile;
+}
+
+// rebuilds the pkg name the same way the unpacker does, so records can be inserted into a tree
+static std::vector<FileRecord> RecordsOf(const IdxFile& idxFile)
+{
+	std::vector<FileRecord> records = idxFile.Files;
+	for (FileRecord& record : records)
+	{
+		record.PkgName = idxFile.PkgName;
+	}
+	return records;
+}
+
+static bool BenchIdxParse(std::string_view name, std::span<const Byte> data, const Options& options, std::vector<BenchResult>& results)
+{
+	const std::optional<IdxFile> idxFile = ParseIdx(data);
+	if (!idxFile)
+		return false;
+
+	return Measure(results, name, options.Iterations, data.size(), idxFile->Files.size(), [data]()
+	{
+		return ParseIdx(data).has_value();
+	});
+}
+
+static bool BenchSynthetic(const fs::path& dir, std::span<const SyntheticFile> files, const Options& options, std::vector<BenchResult>& results)
+{
+	std::vector<Byte> idxData;
+	std::vector<Byte> pkgData;
+	if (!ReadFile(dir / "idx" / "synthetic.idx", idxData) || !ReadFile(dir / "pkg" / "synthetic_0001.pkg", pkgData))
+	{
+		fmt::println(stderr, "Failed to read synthetic idx/pkg: {}", File::LastError());
+		return false;
+	}
+
+	if (!BenchIdxParse("IdxParse/Synthetic", idxData, options, results))
+		return false;
+
+	const std::optional<IdxFile> idxFile = ParseIdx(idxData);
+	if (!idxFile)
+		return false;
+	const std::vector<FileRecord> records = RecordsOf(*idxFile);
+
+	const bool treeBuilt = Measure(results, "TreeBuild/Synthetic", options.Iterations, 0, records.size(), [&records]()
+	{
+		DirectoryTree tree;
+		for (const FileRecord& record : records)
+		{
+			tree.Insert(record);
+		}
+		return true;
+	});
+	if (!treeBuilt)
+		return false;
+
+	DirectoryTree tree;
+	for (const FileRecord& record : records)
+	{
+		tree.Insert(record);
+	}
+
+	// a mix of full paths and directory prefixes, in random order
+	std::vector<std::string> lookups;
+	std::mt19937 rng(options.Seed);
+	std::uniform_int_distribution<size_t> pick(0, files.size() - 1);
+	for (size_t i = 0; i < std::min<size_t>(files.size(), 10000); i++)
+	{
+		const std::string& path = files[pick(rng)].Path;
+		lookups.emplace_back(i % 4 == 0 ? path.substr(0, path.rfind('/')) : path);
+	}
+
+	const bool lookedUp = Measure(results, "PrefixLookup/Synthetic", options.Iterations, 0, lookups.size(), [&tree, &lookups]()
+	{
+		for (const std::string& lookup : lookups)
+		{
+			if (!tree.Find(lookup))
+			{
+				fmt::println(stderr, "Lookup of '{}' failed", lookup);
+				return false;
+			}
+		}
+		return true;
+	});
+	if (!lookedUp)
+		return false;
+
+	uint64_t uncompressedSize = 0;
+	for (const FileRecord& record : records)
+	{
+		uncompressedSize += record.UncompressedSize;
+	}
+
+	const bool inflated = Measure(results, "Inflate/Synthetic", options.Iterations, uncompressedSize, records.size(), [&records, &pkgData]()
+	{
+		for (const FileRecord& record : records)
+		{
+			const std::span<const Byte> compressed(pkgData.data() + record.Offset, record.Size);
+			const bool success = PotatoAlert::Core::Zlib::InflateChunked(compressed, [](std::span<const Byte>)
+			{
+				return true;
+			}, false);
+			if (!success)
+			{
+				fmt::println(stderr, "Failed to inflate '{}'", record.Path);
+				return false;
+			}
+		}
+		return true;
+	});
+	if (!inflated)
+		return false;
+
+	const bool checksummed = Measure(results, "Crc32/Synthetic", options.Iterations, uncompressedSize, files.size(), [files]()
+	{
+		uint32_t crc = 0;
+		for (const SyntheticFile& file : files)
+		{
+			crc ^= Crc32(file.Data);
+		}
+		(void)crc;
+		return true;
+	});
+	if (!checksummed)
+		return false;
+
+	const bool parsed = Measure(results, "UnpackerParse/Synthetic", options.Iterations, idxData.size(), records.size(), [&dir]()
+	{
+		Unpacker unpacker(dir / "pkg", dir / "idx");
+		PA_TRYV_OR_ELSE(unpacker.Parse(),
+		{
+			fmt::println(stderr, "Failed to parse synthetic idx: {}", error);
+			return false;
+		});
+		return true;
+	});
+	if (!parsed)
+		return false;
+
+	Unpacker unpacker(dir / "pkg", dir / "idx");
+	PA_TRYV_OR_ELSE(unpacker.Parse(),
+	{
+		fmt::println(stderr, "Failed to parse synthetic idx: {}", error);
+		return false;
+	});
+
+	const fs::path extractDir = dir / "extracted";
+	auto extract = [&unpacker, &extractDir](bool verifyCrc)
+	{
+		for (std::string_view root : { "content", "gui", "scripts", "spaces" })
+		{
+			PA_TRYV_OR_ELSE(unpacker.Extract(root, extractDir, true, verifyCrc),
+			{
+				fmt::println(stderr, "Failed to extract '{}': {}", root, error);
+				return false;
+			});
+		}
+		return true;
+	};
+
+	return Measure(results, "Extract/Synthetic", options.Iterations, uncompressedSize, records.size(), [&extract]()
+		{
+			return extract(false);
+		}) &&
+		Measure(results, "ExtractVerifyCrc/Synthetic", options.Iterations, uncompressedSize, records.size(), [&extract]()
+		{
+			return extract(true);
+		});
+}
+
+static void PrintResults(std::span<const BenchResult> results)
+{
+	AsciiTable<std::string, size_t, std::string, std::string, std::string> table({ "Benchmark", "Iterations", "MB/s", "Items/s", "ns/Item" });
+	for (const BenchResult& result : results)
+	{
+		table.AddRow(
+			result.Name,
+			result.Iterations,
+			result.Bytes > 0 ? fmt::format("{:.1f}", result.MegaBytesPerSecond()) : "-",
+			fmt::format("{:.0f}", result.ItemsPerSecond()),
+			fmt::format("{:.1f}", result.NanosecondsPerItem()));
+	}
+	table.Print(std::cout);
+}
+
+static bool WriteJson(const fs::path& path, const Options& options, std::span<const BenchResult> results)
+{
+	rapidjson::StringBuffer buffer;
+	rapidjson::PrettyWriter writer(buffer);
+
+	writer.StartObject();
+	writer.Key("file_count");
+	writer.Uint64(options.FileCount);
+	writer.Key("file_size");
+	writer.Uint64(options.FileSize);
+	writer.Key("seed");
+	writer.Uint(options.Seed);
+	writer.Key("benchmarks");
+	writer.StartArray();
+	for (const BenchResult& result : results)
+	{
+		writer.StartObject();
+		writer.Key("name");
+		writer.String(result.Name);
+		writer.Key("iterations");
+		writer.Uint64(result.Iterations);
+		writer.Key("seconds");
+		writer.Double(result.Seconds);
+		writer.Key("bytes");
+		writer.Uint64(result.Bytes);
+		writer.Key("items");
+		writer.Uint64(result.Items);
+		writer.Key("mb_per_second");
+		writer.Double(result.Bytes > 0 ? result.MegaBytesPerSecond() : 0.0);
+		writer.Key("items_per_second");
+		writer.Double(result.ItemsPerSecond());
+		writer.Key("ns_per_item");
+		writer.Double(result.NanosecondsPerItem());
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	const File file = File::Open(path, File::Flags::Write | File::Flags::Create | File::Flags::Truncate);
+	return file && file.WriteString(std::string_view(buffer.GetString(), buffer.GetSize()));
+}
+
+static bool ParseOptions(int argc, char* argv[], Options& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			return false;
+		}
+		const std::string_view value = argv[++i];
+
+		if (arg == "--files")
+		{
+			options.FileCount = std::strtoull(value.data(), nullptr, 10);
+		}
+		else if (arg == "--size")
+		{
+			options.FileSize = std::strtoull(value.data(), nullptr, 10);
+		}
+		else if (arg == "--iterations")
+		{
+			options.Iterations = std::strtoull(value.data(), nullptr, 10);
+		}
+		else if (arg == "--seed")
+		{
+			options.Seed = static_cast<uint32_t>(std::strtoul(value.data(), nullptr, 10));
+		}
+		else if (arg == "--json")
+		{
+			options.JsonOutput = value;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return options.FileCount > 0 && options.FileSize > 0 && options.Iterations > 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		fmt::println(stderr, "Usage: {} [--files N] [--size BYTES] [--iterations N] [--seed N] [--json FILE]", argv[0]);
+		return 1;
+	}
+
+	std::vector<BenchResult> results;
+
+	// the idx bundled with the tests, this is what a real game update looks like
+	if (const auto rootPath = PotatoAlert::Core::GetModuleRootPath())
+	{
+		const fs::path bundledIdx = fs::path(rootPath.value()).remove_filename() / "GameFiles" / "vehicles_level6_usa.idx";
+		std::vector<Byte> data;
+		if (ReadFile(bundledIdx, data))
+		{
+			if (!BenchIdxParse("IdxParse/Bundled", data, options, results))
+				return 1;
+		}
+		else
+		{
+			fmt::println(stderr, "Bundled idx '{}' not found, skipping", bundledIdx.string());
+		}
+	}
+
+	const fs::path dir = fs::temp_directory_path() / "PotatoAlertGameFileUnpackBench";
+	std::error_code ec;
+	fs::remove_all(dir, ec);
+	PA_DEFER
+	{
+		fs::remove_all(dir, ec);
+	};
+
+	const std::vector<SyntheticFile> files = MakeSyntheticFiles(options);
+	if (!WriteSyntheticIdxPkg(dir, "synthetic", files))
+	{
+		fmt::println(stderr, "Failed to write synthetic idx/pkg to '{}'", dir.string());
+		return 1;
+	}
+	// failures return instead of exiting, so the deferred cleanup removes the generated files
+	if (!BenchSynthetic(dir, files, options, results))
+	{
+		return 1;
+	}
+
+	PrintResults(results);
+
+	if (!options.JsonOutput.empty() && !WriteJson(options.JsonOutput, options, results))
+	{
+		fmt::println(stderr, "Failed to write results to '{}'", options.JsonOutput.string());
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,18 +1,28 @@
 // Copyright 2022 <github.com/razaqq>
 
 #include "Core/Bytes.hpp"
+#include "Core/Crc32.hpp"
 #include "Core/Directory.hpp"
 #include "Core/File.hpp"
 #include "Core/Log.hpp"
 #include "Core/StandardPaths.hpp"
+#include "Core/Zlib.hpp"
 
 #include <GameFileUnpack/GameFileUnpack.hpp>
+#include <GameFileUnpack/IdxCache.hpp>
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/reporters/catch_reporter_event_listener.hpp>
 #include <catch2/reporters/catch_reporter_registrars.hpp>
 
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <QDir>
 #include <QStandardPaths>
@@ -20,6 +30,7 @@
 
 namespace fs = std::filesystem;
 using PotatoAlert::Core::Byte;
+using PotatoAlert::Core::Crc32;
 using PotatoAlert::Core::File;
 using namespace PotatoAlert::GameFileUnpack;
 typedef DirectoryTree::TreeNode TreeNode;
@@ -54,6 +65,109 @@ static fs::path GetGameFilePath(std::string_view fileName)
 	return GetGameFileRootPath() / fileName;
 }
 
+template<typename T>
+static void Put(std::vector<Byte>& out, size_t offset, T value)
+{
+	std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+// writes idx/synthetic.idx and pkg/synthetic_0001.pkg with a deflated content/a.txt and a stored content/sub/b.bin,
+// the crc of each record is the one of the given data
+static bool WriteSyntheticGameFiles(const fs::path& dir, std::span<const Byte> a, uint32_t aCrc, std::span<const Byte> b, uint32_t bCrc)
+{
+	// the pkg files contain raw deflate streams, so drop the zlib header and adler32 trailer
+	const std::vector<Byte> deflated = PotatoAlert::Core::Zlib::Deflate(a);
+	if (deflated.size() < 6)
+		return false;
+	const std::span<const Byte> compressed = std::span(deflated).subspan(2, deflated.size() - 6);
+
+	struct SyntheticNode
+	{
+		std::string_view Name;
+		uint64_t Id;
+		uint64_t Parent;
+	};
+	static constexpr std::array<SyntheticNode, 4> nodes =
+	{
+		SyntheticNode{ "content", 10, 1 },
+		SyntheticNode{ "a.txt", 11, 10 },
+		SyntheticNode{ "sub", 12, 10 },
+		SyntheticNode{ "b.bin", 13, 12 },
+	};
+	static constexpr std::string_view pkgName = "synthetic_0001.pkg";
+
+	const size_t nodeTable = HeaderSize;
+	const size_t recordTable = nodeTable + nodes.size() * NodeSize;
+	const size_t volumeTable = recordTable + 2 * FileRecordSize;
+
+	std::vector<Byte> idx(volumeTable + VolumeSize);
+	std::memcpy(idx.data(), "ISFP", 4);
+	Put<uint32_t>(idx, 0x04, 0x2000000);
+	Put<uint32_t>(idx, 0x08, 0x12345678);
+	Put<uint32_t>(idx, 0x0C, 0x40);
+	Put<uint32_t>(idx, 0x10, static_cast<uint32_t>(nodes.size()));
+	Put<uint32_t>(idx, 0x14, 2);
+	Put<uint32_t>(idx, 0x18, 1);
+	Put<uint64_t>(idx, 0x20, nodeTable - HeaderDataOffset);
+	Put<uint64_t>(idx, 0x28, recordTable - HeaderDataOffset);
+	Put<uint64_t>(idx, 0x30, volumeTable - HeaderDataOffset);
+
+	// name pointers are relative to the start of the node/volume entry
+	auto putName = [&idx](size_t entryOffset, std::string_view str)
+	{
+		const size_t strOffset = idx.size();
+		idx.insert(idx.end(), str.begin(), str.end());
+		idx.push_back(0);
+		Put<uint64_t>(idx, entryOffset, str.size() + 1);
+		Put<uint64_t>(idx, entryOffset + 8, strOffset - entryOffset);
+	};
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		putName(nodeTable + i * NodeSize, nodes[i].Name);
+		Put<uint64_t>(idx, nodeTable + i * NodeSize + 0x10, nodes[i].Id);
+		Put<uint64_t>(idx, nodeTable + i * NodeSize + 0x18, nodes[i].Parent);
+	}
+
+	std::vector<Byte> pkg;
+	auto putRecord = [&idx, &pkg](size_t offset, uint64_t nodeId, std::span<const Byte> stored, uint32_t crc, uint64_t uncompressedSize)
+	{
+		Put<uint64_t>(idx, offset + 0x00, nodeId);
+		Put<uint64_t>(idx, offset + 0x08, 1);
+		Put<uint64_t>(idx, offset + 0x10, pkg.size());
+		Put<uint64_t>(idx, offset + 0x18, stored.size() == uncompressedSize ? 0 : 5);
+		Put<uint32_t>(idx, offset + 0x20, static_cast<uint32_t>(stored.size()));
+		Put<uint32_t>(idx, offset + 0x24, crc);
+		Put<uint64_t>(idx, offset + 0x28, uncompressedSize);
+		pkg.insert(pkg.end(), stored.begin(), stored.end());
+	};
+	putRecord(recordTable, 11, compressed, aCrc, a.size());
+	putRecord(recordTable + FileRecordSize, 13, b, bCrc, b.size());
+
+	putName(volumeTable, pkgName);
+	Put<uint64_t>(idx, volumeTable + 0x10, 1);
+
+	std::error_code ec;
+	fs::create_directories(dir / "idx", ec);
+	fs::create_directories(dir / "pkg", ec);
+	if (ec)
+		return false;
+
+	const File idxFile = File::Open(dir / "idx" / "synthetic.idx", File::Flags::Write | File::Flags::Create | File::Flags::Truncate);
+	const File pkgFile = File::Open(dir / "pkg" / pkgName, File::Flags::Write | File::Flags::Create | File::Flags::Truncate);
+	return idxFile && idxFile.Write<Byte>(idx) && pkgFile && pkgFile.Write<Byte>(pkg);
+}
+
+static std::vector<Byte> ReadAll(const fs::path& path)
+{
+	std::vector<Byte> data;
+	if (const File file = File::Open(path, File::Flags::Open | File::Flags::Read))
+	{
+		file.ReadAll(data);
+	}
+	return data;
+}
+
 }
 
 class TestRunListener : public Catch::EventListenerBase
@@ -120,4 +234,128 @@ TEST_CASE("GameFileUnpackTest_UnpackerTest")
 			R"(content/gameplay/usa/gun/secondary/textures/AGS206_3in50_MK21_Sub_ao.dds)",
 			GetTempDirectory())
 	);
+
+	// the crc of the records is the one of the uncompressed data
+	const fs::path verifiedDir = GetTempDirectory() / "Verified";
+	REQUIRE(unpacker.Extract(
+			R"(content/gameplay/usa/gun/secondary/textures/AGS206_3in50_MK21_Sub_ao.dds)",
+			verifiedDir, false, true)
+	);
+	REQUIRE(fs::file_size(verifiedDir / "AGS206_3in50_MK21_Sub_ao.dds") == 2872);
+	REQUIRE(unpacker.Extract("content/gameplay/usa/", verifiedDir, true, true));
+}
+
+TEST_CASE("GameFileUnpackTest_VerifyCrcTest")
+{
+	std::vector<Byte> a(4096);
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		a[i] = static_cast<Byte>('a' + i * 7 % 13);
+	}
+	const std::vector<Byte> b = { 'P', 'A', 0, 1, 2, 3, 4, 5 };
+
+	const fs::path dir = GetTempDirectory() / "SyntheticGameFiles";
+	const fs::path dst = GetTempDirectory() / "SyntheticGameFilesOut";
+	fs::remove_all(dst);
+
+	// the crc of a record is the one of the uncompressed data, for stored and deflated files
+	REQUIRE(WriteSyntheticGameFiles(dir, a, Crc32(a), b, Crc32(b)));
+	{
+		Unpacker unpacker(dir / "pkg", dir / "idx");
+		REQUIRE(unpacker.Parse());
+		REQUIRE(unpacker.Extract("content/", dst, true, true));
+		REQUIRE(ReadAll(dst / "content" / "a.txt") == a);
+		REQUIRE(ReadAll(dst / "content" / "sub" / "b.bin") == b);
+	}
+
+	// the crc of the compressed data does not match what was inflated
+	const std::vector<Byte> deflated = PotatoAlert::Core::Zlib::Deflate(a);
+	REQUIRE(WriteSyntheticGameFiles(dir, a, Crc32(std::span(deflated).subspan(2, deflated.size() - 6)), b, Crc32(b)));
+	{
+		Unpacker unpacker(dir / "pkg", dir / "idx");
+		REQUIRE(unpacker.Parse());
+		REQUIRE_FALSE(unpacker.Extract("content/a.txt", dst, true, true));
+		REQUIRE(unpacker.Extract("content/a.txt", dst, true, false));
+		REQUIRE(unpacker.Extract("content/sub/", dst, true, true));
+	}
+
+	REQUIRE(WriteSyntheticGameFiles(dir, a, Crc32(a), b, Crc32(b) ^ 1));
+	{
+		Unpacker unpacker(dir / "pkg", dir / "idx");
+		REQUIRE(unpacker.Parse());
+		REQUIRE_FALSE(unpacker.Extract("content/", dst, true, true));
+	}
+}
+
+TEST_CASE("GameFileUnpackTest_IdxCacheTest")
+{
+	const fs::path idxFilePath = GetGameFilePath("vehicles_level6_usa.idx");
+	const fs::path cacheFilePath = GetTempDirectory() / "GameFileUnpackTest.idxcache";
+
+	UnpackResult<IdxSource> source = IdxSource::Read(GetGameFileRootPath(), idxFilePath);
+	REQUIRE(source);
+	REQUIRE(source->Name == "vehicles_level6_usa.idx");
+	REQUIRE(source->Size == 5016);
+
+	File file = File::Open(idxFilePath, File::Flags::Open | File::Flags::Read);
+	REQUIRE(file);
+	std::vector<Byte> data;
+	REQUIRE(file.ReadAll(data));
+	UnpackResult<IdxFile> idxFile = IdxFile::Parse(data);
+	REQUIRE(idxFile);
+	for (FileRecord& fileRecord : idxFile->Files)
+	{
+		fileRecord.PkgName = idxFile->PkgName;
+	}
+
+	const std::array sources = { *source };
+	REQUIRE(IdxCache::Write(cacheFilePath, sources, idxFile->Files));
+
+	{
+		UnpackResult<IdxCache> cache = IdxCache::Open(cacheFilePath, sources);
+		REQUIRE(cache);
+		REQUIRE(cache->RecordCount() == 39);
+
+		// records are sorted by path, so files and directories are found as ranges
+		const auto [first, last] = cache->Find("content/gameplay/usa/gun/secondary/textures/AGS206_3in50_MK21_Sub_ao.dds");
+		REQUIRE(last == first + 1);
+		const FileRecord record = cache->Record(first);
+		REQUIRE(record.Path == "content/gameplay/usa/gun/secondary/textures/AGS206_3in50_MK21_Sub_ao.dds");
+		REQUIRE(record.PkgName == "vehicles_level6_usa_0001.pkg");
+		REQUIRE(record.Offset == 0x6226F);
+		REQUIRE(record.Size == 1799);
+		REQUIRE(record.UncompressedSize == 2872);
+
+		const auto [dirFirst, dirLast] = cache->Find("content/gameplay/usa/gun/secondary/textures/");
+		REQUIRE(dirFirst <= first);
+		REQUIRE(dirLast > first);
+		for (size_t i = dirFirst; i < dirLast; i++)
+		{
+			REQUIRE(cache->Path(i).starts_with("content/gameplay/usa/gun/secondary/textures/"));
+		}
+		REQUIRE(cache->Find("") == std::pair<size_t, size_t>{ 0, 39 });
+		REQUIRE(cache->Find("content/gameplay/usa/gun/secondary/tex").first == cache->Find("content/gameplay/usa/gun/secondary/tex").second);
+	}
+
+	std::array changedSources = { *source };
+	changedSources[0].LastWriteTime++;
+	REQUIRE_FALSE(IdxCache::Open(cacheFilePath, changedSources));
+
+	// the path offset of the first record points past the string table
+	std::vector<Byte> cacheData;
+	{
+		File cacheFile = File::Open(cacheFilePath, File::Flags::Open | File::Flags::Read);
+		REQUIRE(cacheFile);
+		REQUIRE(cacheFile.ReadAll(cacheData));
+	}
+	constexpr size_t pathOffset = 0x18 + 0x28 + 0x10;
+	REQUIRE(cacheData.size() > pathOffset + sizeof(uint64_t));
+	const uint64_t corruptOffset = cacheData.size();
+	std::memcpy(cacheData.data() + pathOffset, &corruptOffset, sizeof(corruptOffset));
+	{
+		File cacheFile = File::Open(cacheFilePath, File::Flags::Write | File::Flags::Create | File::Flags::Truncate);
+		REQUIRE(cacheFile);
+		REQUIRE(cacheFile.Write<Byte>(cacheData));
+	}
+	REQUIRE_FALSE(IdxCache::Open(cacheFilePath, sources));
 }
@@ -0,0 +1,14 @@
+# log calls below the active level are compiled out, including the formatting of their arguments
+# the level is the same for every target, LOG_* in inline functions of shared headers would otherwise differ between them
+# without PA_LOG_LEVEL debug builds keep everything and release builds drop trace logging
+set(PA_LOG_LEVELS TRACE DEBUG INFO WARN ERROR CRITICAL OFF)
+set(PA_LOG_LEVEL "" CACHE STRING "Lowest log level compiled in (TRACE, DEBUG, INFO, WARN, ERROR, CRITICAL, OFF)")
+set_property(CACHE PA_LOG_LEVEL PROPERTY STRINGS "" ${PA_LOG_LEVELS})
+
+if(NOT "${PA_LOG_LEVEL}" STREQUAL "")
+    string(TOUPPER ${PA_LOG_LEVEL} PA_LOG_LEVEL_UPPER)
+    if(NOT PA_LOG_LEVEL_UPPER IN_LIST PA_LOG_LEVELS)
+        message(FATAL_ERROR "Invalid log level '${PA_LOG_LEVEL}', has to be one of ${PA_LOG_LEVELS}")
+    endif()
+    add_definitions(-DPA_LOG_ACTIVE_LEVEL=SPDLOG_LEVEL_${PA_LOG_LEVEL_UPPER})
+endif()
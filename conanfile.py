@@ -12,6 +12,8 @@ class PotatoAlert(ConanFile):
         "spdlog/*:no_exceptions": True,
         "spdlog/*:header_only": True,
         "spdlog/*:use_std_fmt": False,
+        "sqlite3/*:enable_dbstat_vtab": True,
+        "sqlite3/*:enable_fts5": True,
         "qt*:shared": "True",
     }
 